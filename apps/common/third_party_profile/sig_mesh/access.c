@@ -40,6 +40,54 @@
 static const struct bt_mesh_comp *dev_comp;
 static u16_t dev_primary_addr;
 
+#if CONFIG_BT_MESH_MODEL_OP_INDEX
+#define OP_INDEX_NONE               0xffff
+
+/* Opcodes take up to 24 bits. The element goes below them, where the
+ * hash spreads it over every bucket bit.
+ */
+#define OP_KEY(elem_idx, opcode)    (((u32_t)(opcode) << 8) | (elem_idx))
+
+/* One entry per (model, opcode) pair of the composition, hashed by
+ * element and opcode, so a lookup only meets the models of one element
+ * however often the same models repeat across elements. Entries sharing
+ * a hash bucket are chained in element and model order, which is the
+ * order bt_mesh_model_recv() has to deliver in.
+ */
+struct op_entry {
+    u32_t key;                      /* OP_KEY() */
+    const struct bt_mesh_model_op *op;
+    struct bt_mesh_model *model;
+    u16_t mod_bit;                  /* Bit of the model in group bitmaps */
+    u16_t next;
+};
+
+static struct op_entry *op_index;
+static u16_t *op_bucket;
+static u16_t op_bucket_mask;
+#endif /* CONFIG_BT_MESH_MODEL_OP_INDEX */
+
+#if CONFIG_BT_MESH_SUB_INDEX
+/* Node-wide subscription index. Every group or virtual address some model
+ * is subscribed to is hashed to the first element subscribing and to a
+ * bitmap of all subscribed models, numbered in composition order.
+ * Rebuilt lazily after bt_mesh_model_sub_changed().
+ */
+struct sub_entry {
+    u16_t addr;                     /* Unassigned marks a free slot */
+    u16_t bits_idx;
+    u8_t  elem_idx;
+};
+
+static struct sub_entry *sub_table;
+static u8_t *sub_bits;
+static u8_t *sub_bit_elem;          /* Element of each model bit */
+static u16_t sub_mask;
+static u16_t sub_count;
+static u8_t sub_bytes;
+static bool sub_dirty;
+#endif /* CONFIG_BT_MESH_SUB_INDEX */
+
 static const struct {
     const u16_t id;
     int (*const init)(struct bt_mesh_model *model, bool primary);
@@ -333,6 +381,258 @@ static void mod_init(struct bt_mesh_model *mod, struct bt_mesh_elem *elem,
     }
 }
 
+#if CONFIG_BT_MESH_MODEL_OP_INDEX || CONFIG_BT_MESH_SUB_INDEX
+#include "system/malloc.h"
+
+static u16_t hash_bucket(u32_t key, u16_t mask)
+{
+    u32_t h = key * 0x9e3779b1;
+
+    return (h >> 16) & mask;
+}
+
+static u16_t comp_model_count(const struct bt_mesh_comp *comp)
+{
+    u16_t count = 0;
+    int i;
+
+    for (i = 0; i < comp->elem_count; i++) {
+        count += comp->elem[i].model_count + comp->elem[i].vnd_model_count;
+    }
+
+    return count;
+}
+#endif /* CONFIG_BT_MESH_MODEL_OP_INDEX || CONFIG_BT_MESH_SUB_INDEX */
+
+#if CONFIG_BT_MESH_MODEL_OP_INDEX
+static void op_index_add(struct bt_mesh_model *mod, u16_t mod_bit,
+                         u16_t *count)
+{
+    const struct bt_mesh_model_op *op;
+    int i, n;
+
+    for (n = 0, op = mod->op; op->func; op++) {
+        n++;
+    }
+
+    /* Filled back to front so pushing on the chain head leaves every
+     * chain in ascending element and model order.
+     */
+    for (i = n - 1; i >= 0; i--) {
+        struct op_entry *entry = &op_index[--(*count)];
+        u32_t key = OP_KEY(mod->elem_idx, mod->op[i].opcode);
+        u16_t bucket = hash_bucket(key, op_bucket_mask);
+
+        entry->key = key;
+        entry->op = &mod->op[i];
+        entry->model = mod;
+        entry->mod_bit = mod_bit;
+        entry->next = op_bucket[bucket];
+        op_bucket[bucket] = entry - op_index;
+    }
+}
+
+static void op_index_build(const struct bt_mesh_comp *comp)
+{
+    const struct bt_mesh_model_op *op;
+    u16_t op_count = 0, mod_count, buckets;
+    u32 buf_size, bucket_p;
+    int i, j;
+
+    if (op_index) {
+        free(op_index);
+        op_index = NULL;
+    }
+
+    for (i = 0; i < comp->elem_count; i++) {
+        struct bt_mesh_elem *elem = &comp->elem[i];
+
+        for (j = 0; j < elem->model_count; j++) {
+            for (op = elem->models[j].op; op->func; op++) {
+                op_count++;
+            }
+        }
+
+        for (j = 0; j < elem->vnd_model_count; j++) {
+            for (op = elem->vnd_models[j].op; op->func; op++) {
+                op_count++;
+            }
+        }
+    }
+
+    if (!op_count) {
+        return;
+    }
+
+    /* Twice as many buckets as opcodes keeps the chains short */
+    buckets = 1;
+    while (buckets < 2 * op_count) {
+        buckets <<= 1;
+    }
+
+    op_bucket_mask = buckets - 1;
+
+    buf_size = ALIGN_4BYTE(sizeof(struct op_entry) * op_count);
+    bucket_p = buf_size;
+    buf_size += sizeof(u16_t) * buckets;
+
+    op_index = malloc(buf_size);
+    ASSERT(op_index);
+
+    op_bucket = (u16_t *)((u8_t *)op_index + bucket_p);
+    (void)memset(op_bucket, 0xff, sizeof(u16_t) * buckets);
+
+    mod_count = comp_model_count(comp);
+
+    for (i = comp->elem_count - 1; i >= 0; i--) {
+        struct bt_mesh_elem *elem = &comp->elem[i];
+
+        for (j = elem->vnd_model_count - 1; j >= 0; j--) {
+            op_index_add(&elem->vnd_models[j], --mod_count, &op_count);
+        }
+
+        for (j = elem->model_count - 1; j >= 0; j--) {
+            op_index_add(&elem->models[j], --mod_count, &op_count);
+        }
+    }
+
+    BT_DBG("op index %u buckets, size 0x%x", buckets, buf_size);
+}
+#endif /* CONFIG_BT_MESH_MODEL_OP_INDEX */
+
+#if CONFIG_BT_MESH_SUB_INDEX
+static void sub_index_alloc(const struct bt_mesh_comp *comp)
+{
+    u16_t mod_count, sub_max, slots, mod_bit;
+    u32 buf_size, bits_p, elem_p;
+    int i, j;
+
+    if (sub_table) {
+        free(sub_table);
+        sub_table = NULL;
+    }
+
+    mod_count = comp_model_count(comp);
+    sub_max = mod_count * CONFIG_BT_MESH_MODEL_GROUP_COUNT;
+    if (!sub_max) {
+        return;
+    }
+
+    /* At most half full, so probe sequences stay short */
+    slots = 1;
+    while (slots < 2 * sub_max) {
+        slots <<= 1;
+    }
+
+    sub_mask = slots - 1;
+    sub_bytes = (mod_count + 7) / 8;
+
+    buf_size = ALIGN_4BYTE(sizeof(struct sub_entry) * slots);
+    bits_p = buf_size;
+    buf_size += sub_bytes * sub_max;
+    elem_p = buf_size;
+    buf_size += mod_count;
+
+    sub_table = malloc(buf_size);
+    ASSERT(sub_table);
+
+    sub_bits = (u8_t *)sub_table + bits_p;
+    sub_bit_elem = (u8_t *)sub_table + elem_p;
+    sub_dirty = true;
+
+    for (mod_bit = 0, i = 0; i < comp->elem_count; i++) {
+        for (j = 0; j < comp->elem[i].model_count +
+             comp->elem[i].vnd_model_count; j++) {
+            sub_bit_elem[mod_bit++] = i;
+        }
+    }
+
+    BT_DBG("sub index %u slots, size 0x%x", slots, buf_size);
+}
+
+static void sub_index_add(u16_t addr, u8_t elem_idx, u16_t mod_bit)
+{
+    struct sub_entry *entry;
+    u16_t i = hash_bucket(addr, sub_mask);
+    u8_t *bits;
+
+    while (sub_table[i].addr != BT_MESH_ADDR_UNASSIGNED &&
+           sub_table[i].addr != addr) {
+        i = (i + 1) & sub_mask;
+    }
+
+    entry = &sub_table[i];
+    if (entry->addr == BT_MESH_ADDR_UNASSIGNED) {
+        entry->addr = addr;
+        entry->elem_idx = elem_idx;
+        entry->bits_idx = sub_count++;
+        (void)memset(&sub_bits[entry->bits_idx * sub_bytes], 0, sub_bytes);
+    }
+
+    bits = &sub_bits[entry->bits_idx * sub_bytes];
+    bits[mod_bit / 8] |= BIT(mod_bit % 8);
+}
+
+static void sub_index_rebuild(void)
+{
+    u16_t mod_bit = 0;
+    int i, j, k;
+
+    (void)memset(sub_table, 0, sizeof(struct sub_entry) * (sub_mask + 1));
+    sub_count = 0;
+
+    for (i = 0; i < dev_comp->elem_count; i++) {
+        struct bt_mesh_elem *elem = &dev_comp->elem[i];
+
+        for (j = 0; j < elem->model_count + elem->vnd_model_count; j++) {
+            struct bt_mesh_model *mod;
+
+            if (j < elem->model_count) {
+                mod = &elem->models[j];
+            } else {
+                mod = &elem->vnd_models[j - elem->model_count];
+            }
+
+            for (k = 0; k < ARRAY_SIZE(mod->groups); k++) {
+                if (mod->groups[k] != BT_MESH_ADDR_UNASSIGNED) {
+                    sub_index_add(mod->groups[k], i, mod_bit);
+                }
+            }
+
+            mod_bit++;
+        }
+    }
+
+    sub_dirty = false;
+}
+
+static struct sub_entry *sub_index_find(u16_t addr)
+{
+    u16_t i;
+
+    if (sub_dirty) {
+        sub_index_rebuild();
+    }
+
+    for (i = hash_bucket(addr, sub_mask);
+         sub_table[i].addr != BT_MESH_ADDR_UNASSIGNED;
+         i = (i + 1) & sub_mask) {
+        if (sub_table[i].addr == addr) {
+            return &sub_table[i];
+        }
+    }
+
+    return NULL;
+}
+#endif /* CONFIG_BT_MESH_SUB_INDEX */
+
+void bt_mesh_model_sub_changed(void)
+{
+#if CONFIG_BT_MESH_SUB_INDEX
+    sub_dirty = true;
+#endif /* CONFIG_BT_MESH_SUB_INDEX */
+}
+
 int bt_mesh_comp_register(const struct bt_mesh_comp *comp)
 {
     /* There must be at least one element */
@@ -344,6 +644,14 @@ int bt_mesh_comp_register(const struct bt_mesh_comp *comp)
 
     bt_mesh_model_foreach(mod_init, NULL);
 
+#if CONFIG_BT_MESH_MODEL_OP_INDEX
+    op_index_build(comp);
+#endif /* CONFIG_BT_MESH_MODEL_OP_INDEX */
+
+#if CONFIG_BT_MESH_SUB_INDEX
+    sub_index_alloc(comp);
+#endif /* CONFIG_BT_MESH_SUB_INDEX */
+
     return 0;
 }
 
@@ -424,6 +732,15 @@ struct bt_mesh_elem *bt_mesh_elem_find(u16_t addr)
 {
     int i;
 
+#if CONFIG_BT_MESH_SUB_INDEX
+    if (sub_table && (BT_MESH_ADDR_IS_GROUP(addr) ||
+                      BT_MESH_ADDR_IS_VIRTUAL(addr))) {
+        struct sub_entry *sub = sub_index_find(addr);
+
+        return sub ? &dev_comp->elem[sub->elem_idx] : NULL;
+    }
+#endif /* CONFIG_BT_MESH_SUB_INDEX */
+
     for (i = 0; i < dev_comp->elem_count; i++) {
         struct bt_mesh_elem *elem = &dev_comp->elem[i];
 
@@ -544,6 +861,116 @@ bool bt_mesh_fixed_group_match(u16_t addr)
     }
 }
 
+#if CONFIG_BT_MESH_MODEL_OP_INDEX
+/* Deliver to the first model of the element that has the opcode, is
+ * subscribed to a group destination and is bound to the AppKey
+ */
+static void op_index_elem_recv(struct bt_mesh_net_rx *rx,
+                               struct net_buf_simple *buf, u8_t elem_idx,
+                               u32_t opcode, bool group,
+                               const u8_t *group_bits)
+{
+    u32_t key = OP_KEY(elem_idx, opcode);
+    u16_t i;
+
+    for (i = op_bucket[hash_bucket(key, op_bucket_mask)];
+         i != OP_INDEX_NONE; i = op_index[i].next) {
+        struct op_entry *entry = &op_index[i];
+        struct bt_mesh_model *model = entry->model;
+        struct net_buf_simple_state state;
+
+        if (entry->key != key) {
+            continue;
+        }
+
+        if (group_bits) {
+            if (!(group_bits[entry->mod_bit / 8] & BIT(entry->mod_bit % 8))) {
+                continue;
+            }
+        } else if (group && !bt_mesh_model_find_group(model, rx->ctx.recv_dst)) {
+            continue;
+        }
+
+        if (!model_has_key(model, rx->ctx.app_idx)) {
+            continue;
+        }
+
+        if (buf->len < entry->op->min_len) {
+            BT_ERR("Too short message for OpCode 0x%08x", opcode);
+            return;
+        }
+
+        net_buf_simple_save(buf, &state);
+        entry->op->func(model, &rx->ctx, buf);
+        net_buf_simple_restore(buf, &state);
+        return;
+    }
+}
+
+static void op_index_recv(struct bt_mesh_net_rx *rx, struct net_buf_simple *buf,
+                          u32_t opcode)
+{
+    u16_t dst = rx->ctx.recv_dst;
+    int elem_idx;
+
+    if (BT_MESH_ADDR_IS_UNICAST(dst)) {
+        elem_idx = dst - dev_primary_addr;
+        if (dst < dev_primary_addr || elem_idx >= dev_comp->elem_count ||
+            dev_comp->elem[elem_idx].addr != dst) {
+            return;
+        }
+
+        op_index_elem_recv(rx, buf, elem_idx, opcode, false, NULL);
+        return;
+    }
+
+    if (!BT_MESH_ADDR_IS_GROUP(dst) && !BT_MESH_ADDR_IS_VIRTUAL(dst)) {
+        if (bt_mesh_fixed_group_match(dst)) {
+            op_index_elem_recv(rx, buf, 0, opcode, false, NULL);
+        }
+
+        return;
+    }
+
+#if CONFIG_BT_MESH_SUB_INDEX
+    if (sub_table) {
+        struct sub_entry *sub = sub_index_find(dst);
+        const u8_t *group_bits;
+        int last = -1;
+        u16_t bit;
+
+        if (!sub) {
+            BT_DBG("No model subscribed to 0x%04x", dst);
+            return;
+        }
+
+        /* Only the elements with a subscribed model, in element order */
+        group_bits = &sub_bits[sub->bits_idx * sub_bytes];
+        for (bit = 0; bit < sub_bytes * 8; bit++) {
+            if (!group_bits[bit / 8]) {
+                bit |= 7;
+                continue;
+            }
+
+            if (!(group_bits[bit / 8] & BIT(bit % 8)) ||
+                sub_bit_elem[bit] == last) {
+                continue;
+            }
+
+            last = sub_bit_elem[bit];
+            op_index_elem_recv(rx, buf, last, opcode, true, group_bits);
+        }
+
+        return;
+    }
+#endif /* CONFIG_BT_MESH_SUB_INDEX */
+
+    for (elem_idx = 0; elem_idx < dev_comp->elem_count; elem_idx++) {
+        op_index_elem_recv(rx, buf, elem_idx, opcode, true, NULL);
+    }
+}
+#endif /* CONFIG_BT_MESH_MODEL_OP_INDEX */
+
 void bt_mesh_model_recv(struct bt_mesh_net_rx *rx, struct net_buf_simple *buf)
 {
     struct bt_mesh_model *models, *model;
@@ -563,6 +990,13 @@ void bt_mesh_model_recv(struct bt_mesh_net_rx *rx, struct net_buf_simple *buf)
 
     BT_DBG("\n<Configuration messagees OpCode> 0x%08x", opcode);
 
+#if CONFIG_BT_MESH_MODEL_OP_INDEX
+    if (op_index) {
+        op_index_recv(rx, buf, opcode);
+        return;
+    }
+#endif /* CONFIG_BT_MESH_MODEL_OP_INDEX */
+
     for (i = 0; i < dev_comp->elem_count; i++) {
         struct bt_mesh_elem *elem = &dev_comp->elem[i];
 
@@ -6,6 +6,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+struct bt_mesh_net_rx;
+
 /* bt_mesh_model.flags */
 enum {
     BT_MESH_MOD_BIND_PENDING = BIT(0),
@@ -27,6 +29,9 @@ struct bt_mesh_model *bt_mesh_model_find(struct bt_mesh_elem *elem,
 
 u16_t *bt_mesh_model_find_group(struct bt_mesh_model *mod, u16_t addr);
 
+/* Call after changing any model's subscription list */
+void bt_mesh_model_sub_changed(void);
+
 bool bt_mesh_fixed_group_match(u16_t addr);
 
 void bt_mesh_model_foreach(void (*func)(struct bt_mesh_model *mod,
@@ -271,6 +271,22 @@ void k_delayed_work_cancel(struct k_delayed_work *timer);
 void k_work_submit(struct k_work *work);
 void k_delayed_work_init(struct k_delayed_work *timer, void *callback);
 
+/* Submitted work runs from one system timeout shared by all delayed work,
+ * never from within the submitting call.
+ */
+struct k_work_q_stats {
+    u32_t submitted;    /* Work queued to run */
+    u32_t ran;          /* Callbacks run */
+    u32_t coalesced;    /* Delayed work run by another work's expiry */
+    u32_t timer_arms;   /* System timeouts programmed */
+    u32_t latency_ms;   /* Sum of time from due to run */
+    u16_t latency_max;  /* Longest time from due to run */
+    u8_t  depth_max;    /* Deepest run queue seen */
+};
+
+void k_work_q_stats_get(struct k_work_q_stats *stats);
+void k_work_q_stats_reset(void);
+
 
 /*******************************************************************/
 /*
@@ -339,6 +355,7 @@ struct bt_conn {
     u16_t			handle;
     u16_t           mtu;
     atomic_tt		ref;
+    bool            connected;
 };
 
 struct bt_conn_cb {
@@ -390,6 +407,9 @@ void bt_conn_unref(struct bt_conn *conn);
 
 void bt_conn_cb_register(struct bt_conn_cb *cb);
 
+/* Connection with the given HCI handle, NULL if there is none */
+struct bt_conn *bt_conn_lookup_handle(u16_t handle);
+
 void hci_core_init(void);
 
 
@@ -425,6 +445,43 @@ int bt_le_scan_start(bt_le_scan_cb_t cb);
 
 int bt_le_scan_stop(void);
 
+/* With CONFIG_BT_MESH_SCAN_RX_RING_SIZE reports are queued by the scan
+ * callback and handed to the registered callback from a timer worker.
+ */
+struct bt_le_scan_rx_stats {
+    u32_t received;     /* Reports from the controller */
+    u32_t dup;          /* Dropped as copies of a report still queued */
+    u32_t overflow;     /* Dropped because the ring was full */
+    u32_t processed;    /* Handed to the scan callback */
+    u32_t batches;      /* Worker runs */
+    u8_t  depth_max;    /* Deepest ring occupancy seen */
+};
+
+void bt_le_scan_rx_stats_get(struct bt_le_scan_rx_stats *stats);
+void bt_le_scan_rx_stats_reset(void);
+
+enum bt_le_scan_profile {
+    BT_LE_SCAN_PROFILE_CONTINUOUS,  /* Always on, mains powered relays */
+    BT_LE_SCAN_PROFILE_INTERLEAVED, /* Always on, paused while advertising */
+    BT_LE_SCAN_PROFILE_LOW_DUTY,    /* Short windows, battery powered nodes */
+};
+
+int bt_le_scan_profile_set(enum bt_le_scan_profile profile);
+enum bt_le_scan_profile bt_le_scan_profile_get(void);
+
+/* Own advertising started and ended, lets the profile pause scanning */
+void bt_le_scan_adv_start(void);
+void bt_le_scan_adv_end(void);
+
+struct bt_le_scan_time_stats {
+    u32_t scan_ms;      /* Scanner on time, window share of enabled time */
+    u32_t adv_ms;       /* Time our own PDUs were being advertised */
+    u32_t pauses;       /* Scans paused for our own advertising */
+};
+
+void bt_le_scan_time_stats_get(struct bt_le_scan_time_stats *stats);
+void bt_le_scan_time_stats_reset(void);
+
 
 /*******************************************************************/
 /*
@@ -446,6 +503,14 @@ int bt_gatt_notify(struct bt_conn *conn, const void *data, u16_t len);
 
 u16 bt_gatt_get_mtu(struct bt_conn *conn);
 
+/* Notification bytes the ATT layer can take right now */
+u16 bt_gatt_notify_room(struct bt_conn *conn);
+
+/* Ask the ATT layer for an ATT_EVENT_CAN_SEND_NOW on conn, which ends up
+ * in bt_mesh_proxy_can_send_now() once it has room again.
+ */
+void bt_gatt_notify_request(struct bt_conn *conn);
+
 void bt_conn_disconnect(struct bt_conn *conn, u8 reason);
 
 void proxy_gatt_init(void);
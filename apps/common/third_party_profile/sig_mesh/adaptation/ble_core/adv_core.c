@@ -30,6 +30,14 @@ void bt_mesh_adv_send(struct net_buf *buf, const struct bt_mesh_send_cb *cb, voi
 
 void bt_mesh_adv_init(void) {}
 
+int bt_mesh_adv_queue_stats_get(enum bt_mesh_adv_queue queue,
+                                struct bt_mesh_adv_queue_stats *stats)
+{
+    return -EINVAL;
+}
+
+void bt_mesh_adv_queue_stats_reset(void) {}
+
 #else /* ADAPTATION_COMPILE_DEBUG */
 
 #define MESH_ADV_SEND_USE_HI_TIMER          1
@@ -59,6 +67,17 @@ void bt_mesh_adv_init(void) {}
 #define USER_ADV_SEND_DURATION \
     (bt_mesh_is_provisioned()? config_bt_mesh_node_msg_adv_duration : config_bt_mesh_pb_adv_duration)
 
+#if CONFIG_BT_MESH_ADV_XMIT_TIMING
+/* Each advertising event is followed by a random 0 ~ 10ms advDelay */
+#define ADV_EVENT_DELAY_MAX_MS  10
+
+#define ADV_SEND_INTERVAL(buf)  ADV_SCAN_UNIT(adv_xmit_interval(buf))
+#define ADV_SEND_DURATION(buf)  adv_xmit_duration(buf)
+#else
+#define ADV_SEND_INTERVAL(buf)  USER_ADV_SEND_INTERVAL
+#define ADV_SEND_DURATION(buf)  USER_ADV_SEND_DURATION
+#endif /* CONFIG_BT_MESH_ADV_XMIT_TIMING */
+
 static const u8_t adv_type[] = {
     [BT_MESH_ADV_PROV]   = BT_DATA_MESH_PROV,
     [BT_MESH_ADV_DATA]   = BT_DATA_MESH_MESSAGE,
@@ -68,11 +87,27 @@ static const u8_t adv_type[] = {
 
 static sys_timer mesh_AdvSend_timer;
 
-static sys_slist_t adv_list = {
-    .head = NULL,
-    .tail = NULL,
+/* One FIFO per scheduler queue, served in enum bt_mesh_adv_queue order.
+ * With CONFIG_BT_MESH_ADV_SCHED_WEIGHTED each queue may only send its
+ * weight worth of PDUs per round, so relays can't be starved completely
+ * by a busy local or provisioning queue.
+ */
+static sys_slist_t adv_queue[BT_MESH_ADV_QUEUE_NUM];
+
+static struct bt_mesh_adv_queue_stats adv_queue_stats[BT_MESH_ADV_QUEUE_NUM];
+
+#if CONFIG_BT_MESH_ADV_SCHED_WEIGHTED
+static const u8_t adv_queue_weight[BT_MESH_ADV_QUEUE_NUM] = {
+    [BT_MESH_ADV_QUEUE_LOCAL]  = 4,
+    [BT_MESH_ADV_QUEUE_PROV]   = 4,
+    [BT_MESH_ADV_QUEUE_FRIEND] = 2,
+    [BT_MESH_ADV_QUEUE_BEACON] = 1,
+    [BT_MESH_ADV_QUEUE_RELAY]  = 2,
 };
 
+static u8_t adv_queue_credit[BT_MESH_ADV_QUEUE_NUM];
+#endif /* CONFIG_BT_MESH_ADV_SCHED_WEIGHTED */
+
 static void ble_adv_enable(bool en);
 static bool adv_send(struct net_buf *buf);
 static void fresh_adv_info(struct net_buf *buf);
@@ -85,6 +120,186 @@ extern bool get_if_connecting(void);
 extern void bt_mesh_adv_buf_alloc(void);
 void ble_set_scan_enable(bool en);
 
+#if CONFIG_BT_MESH_ADV_XMIT_TIMING
+static u16 adv_xmit_interval(struct net_buf *buf)
+{
+    return max(ADV_INT_FAST_MS, BT_MESH_TRANSMIT_INT(BT_MESH_ADV(buf)->xmit));
+}
+
+/* Long enough for Transmit Count + 1 advertising events and no longer,
+ * so short PDUs with a small count go out back to back.
+ */
+static u16 adv_xmit_duration(struct net_buf *buf)
+{
+    return (BT_MESH_TRANSMIT_COUNT(BT_MESH_ADV(buf)->xmit) + 1) *
+           (adv_xmit_interval(buf) + ADV_EVENT_DELAY_MAX_MS);
+}
+#endif /* CONFIG_BT_MESH_ADV_XMIT_TIMING */
+
+static enum bt_mesh_adv_queue adv_queue_of(struct net_buf *buf)
+{
+    const struct bt_mesh_adv *adv = BT_MESH_ADV(buf);
+
+    switch (adv->type) {
+    case BT_MESH_ADV_PROV:
+        return BT_MESH_ADV_QUEUE_PROV;
+    case BT_MESH_ADV_BEACON:
+    case BT_MESH_ADV_URI:
+        return BT_MESH_ADV_QUEUE_BEACON;
+    default:
+        break;
+    }
+
+    if (adv->origin == BT_MESH_ADV_ORIGIN_RELAY) {
+        return BT_MESH_ADV_QUEUE_RELAY;
+    }
+
+    if (adv->origin == BT_MESH_ADV_ORIGIN_FRIEND) {
+        return BT_MESH_ADV_QUEUE_FRIEND;
+    }
+
+    return BT_MESH_ADV_QUEUE_LOCAL;
+}
+
+/* Caller must hold the critical section */
+static void adv_queue_put(struct net_buf *buf)
+{
+    enum bt_mesh_adv_queue q = adv_queue_of(buf);
+    struct bt_mesh_adv_queue_stats *stats = &adv_queue_stats[q];
+
+    net_buf_slist_simple_put(&adv_queue[q], &buf->entry_node);
+
+    if (++stats->depth > stats->depth_max) {
+        stats->depth_max = stats->depth;
+    }
+}
+
+/* Caller must hold the critical section */
+static int adv_queue_pick(void)
+{
+    int q;
+
+#if CONFIG_BT_MESH_ADV_SCHED_WEIGHTED
+    int round;
+
+    for (round = 0; round < 2; round++) {
+        for (q = 0; q < BT_MESH_ADV_QUEUE_NUM; q++) {
+            if (!sys_slist_is_empty(&adv_queue[q]) && adv_queue_credit[q]) {
+                adv_queue_credit[q]--;
+                return q;
+            }
+        }
+
+        memcpy(adv_queue_credit, adv_queue_weight, sizeof(adv_queue_credit));
+    }
+#else
+    for (q = 0; q < BT_MESH_ADV_QUEUE_NUM; q++) {
+        if (!sys_slist_is_empty(&adv_queue[q])) {
+            return q;
+        }
+    }
+#endif /* CONFIG_BT_MESH_ADV_SCHED_WEIGHTED */
+
+    return -1;
+}
+
+static void adv_queue_drop(enum bt_mesh_adv_queue q, struct net_buf *buf)
+{
+    const struct bt_mesh_send_cb *cb = BT_MESH_ADV(buf)->cb;
+    void *cb_data = BT_MESH_ADV(buf)->cb_data;
+
+    BT_WARN("drop stale adv buf 0x%x", buf);
+
+    adv_queue_stats[q].dropped++;
+    BT_MESH_ADV(buf)->busy = 0;
+
+    if (cb && cb->start) {
+        cb->start(0, -ETIMEDOUT, cb_data);
+    }
+
+    if (cb && cb->end) {
+        cb->end(-ETIMEDOUT, cb_data);
+    }
+
+    net_buf_unref(buf);
+}
+
+static struct net_buf *adv_queue_get(void)
+{
+    struct net_buf *buf;
+    int q;
+
+    for (;;) {
+        OS_ENTER_CRITICAL();
+
+        q = adv_queue_pick();
+        buf = (q < 0) ? NULL : net_buf_slist_simple_get(&adv_queue[q]);
+        if (buf) {
+            adv_queue_stats[q].depth--;
+        }
+
+        OS_EXIT_CRITICAL();
+
+#if CONFIG_BT_MESH_ADV_RELAY_DEADLINE
+        /* A relayed PDU that waited this long is most likely already
+         * delivered by other relays, sending it only adds to the storm.
+         */
+        if (buf && q == BT_MESH_ADV_QUEUE_RELAY &&
+            (k_uptime_get_32() - BT_MESH_ADV(buf)->queued) >
+            CONFIG_BT_MESH_ADV_RELAY_DEADLINE) {
+            adv_queue_drop(q, buf);
+            continue;
+        }
+#endif /* CONFIG_BT_MESH_ADV_RELAY_DEADLINE */
+
+        return buf;
+    }
+}
+
+static void adv_queue_sent(struct net_buf *buf)
+{
+    struct bt_mesh_adv_queue_stats *stats = &adv_queue_stats[adv_queue_of(buf)];
+    u32_t wait = k_uptime_get_32() - BT_MESH_ADV(buf)->queued;
+
+    stats->sent++;
+    stats->wait_total += wait;
+
+    if (wait > stats->wait_max) {
+        stats->wait_max = wait;
+    }
+}
+
+int bt_mesh_adv_queue_stats_get(enum bt_mesh_adv_queue queue,
+                                struct bt_mesh_adv_queue_stats *stats)
+{
+    if (queue >= BT_MESH_ADV_QUEUE_NUM) {
+        return -EINVAL;
+    }
+
+    OS_ENTER_CRITICAL();
+    *stats = adv_queue_stats[queue];
+    OS_EXIT_CRITICAL();
+
+    return 0;
+}
+
+void bt_mesh_adv_queue_stats_reset(void)
+{
+    int q;
+
+    OS_ENTER_CRITICAL();
+
+    for (q = 0; q < BT_MESH_ADV_QUEUE_NUM; q++) {
+        u16_t depth = adv_queue_stats[q].depth;
+
+        (void)memset(&adv_queue_stats[q], 0, sizeof(adv_queue_stats[q]));
+        adv_queue_stats[q].depth = depth;
+        adv_queue_stats[q].depth_max = depth;
+    }
+
+    OS_EXIT_CRITICAL();
+}
+
 static u16 mesh_adv_send_start(void *param)
 {
     struct net_buf *buf = param;
@@ -93,7 +308,7 @@ static u16 mesh_adv_send_start(void *param)
         BT_MESH_ADV(buf)->delay = 0;
         fresh_adv_info(buf);
 
-        return USER_ADV_SEND_DURATION;
+        return ADV_SEND_DURATION(buf);
     }
 
     return 0;
@@ -106,7 +321,7 @@ static void mesh_adv_send_end(void *param)
     void *cb_data = BT_MESH_ADV(buf)->cb_data;
 
     ble_adv_enable(0);
-    /* ble_set_scan_enable(1); */
+    bt_le_scan_adv_end();
 
     if (cb && cb->end) {
         cb->end(0, cb_data);
@@ -119,19 +334,11 @@ static void mesh_adv_send_end(void *param)
     BT_MESH_ADV(buf)->busy = 0;
     net_buf_unref(buf);
 
-    BT_INFO("adv_list.head=0x%x", adv_list.head);
-    BT_INFO("adv_list.tail=0x%x", adv_list.tail);
-
-    buf = net_buf_slist_simple_get(&adv_list);
-
-    BT_INFO("adv_list.head=0x%x", adv_list.head);
-    BT_INFO("adv_list.tail=0x%x", adv_list.tail);
+    buf = adv_queue_get();
 
     if (buf && BT_MESH_ADV(buf) && BT_MESH_ADV(buf)->busy) {
         bool send_busy = adv_send(buf);
 
-        BT_INFO("adv_list.head=0x%x", adv_list.head);
-        BT_INFO("adv_list.tail=0x%x", adv_list.tail);
         BT_DBG("adv_send %s", send_busy ? "busy" : "succ");
     } else {
         resume_mesh_gatt_proxy_adv_thread();
@@ -236,20 +443,14 @@ static void fresh_adv_info(struct net_buf *buf)
     struct advertising_data_header *adv_data_head;
     u16 total_adv_data_len;
 
-#if 0
-    const s32_t adv_int_min = ADV_INT_FAST_MS;
-    adv_interval = max(adv_int_min, BT_MESH_TRANSMIT_INT(BT_MESH_ADV(buf)->xmit));
-    adv_interval = ADV_SCAN_UNIT(adv_interval);
-#else
-    adv_interval = USER_ADV_SEND_INTERVAL;
-#endif
+    adv_interval = ADV_SEND_INTERVAL(buf);
 
     adv_data_head = buf->data - BT_MESH_ADV_DATA_HEAD_SIZE;
     adv_data_head->Len = buf->len + 1;
     adv_data_head->Type = adv_type[BT_MESH_ADV(buf)->type];
     total_adv_data_len = buf->len + BT_MESH_ADV_DATA_HEAD_SIZE;
 
-    /* ble_set_scan_enable(0); */
+    bt_le_scan_adv_start();
     ble_adv_enable(0);
     ble_set_adv_param(adv_interval, adv_interval, 0x03, 0, direct_addr, 0x07, 0x00);
     ble_set_adv_data(total_adv_data_len, adv_data_head);
@@ -267,7 +468,7 @@ static bool adv_send(struct net_buf *buf)
 
     if (TRUE == mesh_adv_send_timer_busy()) {
 
-        net_buf_slist_simple_put(&adv_list, &buf->entry_node);
+        adv_queue_put(buf);
 
         OS_EXIT_CRITICAL();
 
@@ -276,15 +477,14 @@ static bool adv_send(struct net_buf *buf)
 
     OS_EXIT_CRITICAL();
 
+    adv_queue_sent(buf);
+
     const struct bt_mesh_send_cb *cb = BT_MESH_ADV(buf)->cb;
     void *cb_data = BT_MESH_ADV(buf)->cb_data;
     u16 delay = 0;
     u16 duration;
 
-    /* duration = (MESH_SCAN_WINDOW_MS + */
-    /*             ((BT_MESH_TRANSMIT_COUNT(BT_MESH_ADV(buf)->xmit) + 1) * */
-    /*              (adv_int + 10))); */
-    duration = USER_ADV_SEND_DURATION;
+    duration = ADV_SEND_DURATION(buf);
 
     if (cb) {
         if (cb->start) {
@@ -354,14 +554,10 @@ void bt_mesh_adv_send(struct net_buf *buf, const struct bt_mesh_send_cb *cb,
     BT_MESH_ADV(buf)->cb = cb;
     BT_MESH_ADV(buf)->cb_data = cb_data;
     BT_MESH_ADV(buf)->busy = 1U;
-
-    BT_INFO("adv_list.head=0x%x", adv_list.head);
-    BT_INFO("adv_list.tail=0x%x", adv_list.tail);
+    BT_MESH_ADV(buf)->queued = k_uptime_get_32();
 
     bool send_busy =  adv_send(buf);
 
-    BT_INFO("adv_list.head=0x%x", adv_list.head);
-    BT_INFO("adv_list.tail=0x%x", adv_list.tail);
     BT_INFO("mesh_adv_send %s", send_busy ? "busy" : "succ");
 }
 
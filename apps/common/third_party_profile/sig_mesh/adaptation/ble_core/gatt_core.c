@@ -40,6 +40,13 @@ u16 bt_gatt_get_mtu(struct bt_conn *conn)
     return 0;
 }
 
+u16 bt_gatt_notify_room(struct bt_conn *conn)
+{
+    return 0xffff;
+}
+
+void bt_gatt_notify_request(struct bt_conn *conn) {}
+
 void bt_conn_disconnect(struct bt_conn *conn, u8 reason) {}
 
 void proxy_gatt_init(void) {}
@@ -203,8 +210,8 @@ static const uint8_t Proxy_Service(profile_data)[] = {
 
 static u8 mesh_gatt_buf[0x100];
 
-extern struct bt_conn conn;
 extern int mesh_gatt_notify(u16 conn_handle, u16 att_handle, const void *data, u16_t len);
+extern void att_server_request_can_send_now_event(u16 con_handle);
 extern void mesh_gatt_set_callback(void *read_cb, void *write_cb);
 extern void mesh_gatt_change_profile(void *data);
 extern void mesh_gatt_init(u8 *buf, u16 len);
@@ -281,13 +288,21 @@ static u16 gatt_read_callback(u16 conn_handle, u16 att_handle, u16 offset, u8 *b
 
 static int gatt_write_callback(u16 conn_handle, u16 att_handle, u16 mode, u16 offset, u8 *buf, u16 buf_len)
 {
+    struct bt_conn *conn;
+
     BT_INFO("write att_handle 0x%04x, mode %u", att_handle, mode);
     BT_INFO_HEXDUMP(buf, buf_len);
 
+    conn = bt_conn_lookup_handle(conn_handle);
+    if (!conn) {
+        BT_WARN("Write on unknown connection 0x%x", conn_handle);
+        return 0;
+    }
+
     if (FALSE == bt_mesh_is_provisioned()) {
         if (MESH_PROV_CONFIG_HANDLE == att_handle) {
             BT_INFO("MESH_PROV_CONFIG_HANDLE");
-            prov_ccc_write(&conn,
+            prov_ccc_write(conn,
                            buf, buf_len,
                            offset, 0);
             return 0;
@@ -297,13 +312,13 @@ static int gatt_write_callback(u16 conn_handle, u16 att_handle, u16 mode, u16 of
     switch (att_handle) {
     case MESH_PROXY_CONFIG_HANDLE:
         BT_INFO("MESH_PROXY_CONFIG_HANDLE");
-        proxy_ccc_write(&conn,
+        proxy_ccc_write(conn,
                         buf, buf_len,
                         offset, 0);
         break;
     case MESH_DATA_IN_HANDLE:
         BT_INFO("MESH_DATA_IN_HANDLE");
-        proxy_recv(&conn,
+        proxy_recv(conn,
                    buf,
                    buf_len, offset, 0);
         break;
@@ -353,6 +368,21 @@ u16 bt_gatt_get_mtu(struct bt_conn *conn)
     return conn->mtu;
 }
 
+u16 bt_gatt_notify_room(struct bt_conn *conn)
+{
+    u32 vaild_len = 0;
+
+    /* The ATT send buffer is shared by all connections */
+    ble_user_cmd_prepare(BLE_CMD_ATT_VAILD_LEN, 1, &vaild_len);
+
+    return MIN(vaild_len, 0xffff);
+}
+
+void bt_gatt_notify_request(struct bt_conn *conn)
+{
+    att_server_request_can_send_now_event(conn->handle);
+}
+
 static u8 ble_disconnect(u16 handle)
 {
 #if CMD_DIRECT_TO_BTCTRLER_TASK_EN
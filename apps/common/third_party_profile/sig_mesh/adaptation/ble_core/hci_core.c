@@ -9,6 +9,7 @@
 #include "adaptation.h"
 #include "bluetooth.h"
 #include "ble/hci_ll.h"
+#include "proxy.h"
 
 #define LOG_TAG             "[MESH-hci_core]"
 #define LOG_INFO_ENABLE
@@ -46,6 +47,11 @@ void bt_conn_unref(struct bt_conn *conn) {}
 
 void bt_conn_cb_register(struct bt_conn_cb *cb) {}
 
+struct bt_conn *bt_conn_lookup_handle(u16_t handle)
+{
+    return NULL;
+}
+
 void hci_core_init(void) {}
 
 #else
@@ -60,9 +66,16 @@ struct bt_hci_evt_le_generate_dhkey_complete {
     u8_t dhkey[32];
 } __packed;
 
-struct bt_conn conn;
-static bool is_connect;
+/* ATT_MTU until the client exchanges a larger one */
+#define BT_ATT_DEFAULT_LE_MTU                               23
+
+static struct bt_conn conns[CONFIG_BT_MAX_CONN];
+static u8_t conn_count;
+/* Newest connection, for callers that only know about a single one */
+static struct bt_conn *conn_last;
 static u8_t pub_key[64];
+static bool pub_key_valid;
+static bool pub_key_busy;
 static struct bt_pub_key_cb *pub_key_cb;
 static bt_dh_key_cb_t dh_key_cb;
 static struct bt_conn_cb *callback_list;
@@ -101,33 +114,45 @@ void ble_generate_dh_key(const u8 *remote_pk)
 }
 
 int bt_pub_key_gen(struct bt_pub_key_cb *new_cb)
-
 {
     struct bt_pub_key_cb *cb;
 
-    if (pub_key_cb) {
-        return 0;
+    for (cb = pub_key_cb; cb; cb = cb->_next) {
+        if (cb == new_cb) {
+            break;
+        }
+    }
+
+    if (!cb) {
+        new_cb->_next = pub_key_cb;
+        pub_key_cb = new_cb;
     }
 
-    new_cb->_next = pub_key_cb;
-    pub_key_cb = new_cb;
+    /* The result is reported to every registered callback */
+    if (pub_key_busy) {
+        return 0;
+    }
 
     BT_INFO("BT_HCI_OP_LE_P256_PUBLIC_KEY");
 
-    ble_read_local_p256_public_key();
+    pub_key_busy = true;
+    pub_key_valid = false;
 
+    /* Let other users know the previous key is gone */
     for (cb = pub_key_cb; cb; cb = cb->_next) {
         if (cb != new_cb) {
             cb->func(NULL);
         }
     }
 
+    ble_read_local_p256_public_key();
+
     return 0;
 }
 
 const u8_t *bt_pub_key_get(void)
 {
-    return pub_key;
+    return pub_key_valid ? pub_key : NULL;
 }
 
 int bt_dh_key_gen(const u8_t remote_pk[64], bt_dh_key_cb_t cb)
@@ -169,35 +194,131 @@ void bt_conn_cb_register(struct bt_conn_cb *cb)
     callback_list = cb;
 }
 
+struct bt_conn *bt_conn_lookup_handle(u16_t handle)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(conns); i++) {
+        if (conns[i].connected && conns[i].handle == handle) {
+            return &conns[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Connectable advertising stays on while another client fits */
 bool get_if_connecting(void)
 {
-    return is_connect;
+    return conn_count >= CONFIG_BT_MAX_CONN;
 }
 
+#if CONFIG_BT_MESH_PROXY_DLE
+/* Largest link layer payload */
+#define LL_DATA_LEN_MAX                                     251
+
+static void conn_data_length_set(struct bt_conn *conn)
+{
+    /* The value travels behind ATT (3 bytes) and L2CAP (4 bytes) headers */
+    u16 tx_octets = MIN(conn->mtu + 4, LL_DATA_LEN_MAX);
+    /* LE 1M: 14 bytes of framing, 8 us a byte */
+    u16 tx_time = (tx_octets + 14) * 8;
+
+    if (conn->mtu <= BT_ATT_DEFAULT_LE_MTU) {
+        return;
+    }
+
+    BT_DBG("handle 0x%x tx_octets %u", conn->handle, tx_octets);
+
+    ble_user_cmd_prepare(BLE_CMD_SET_DATA_LENGTH, 3, conn->handle,
+                         tx_octets, tx_time);
+}
+#endif /* CONFIG_BT_MESH_PROXY_DLE */
+
+static void conn_mtu_set(struct bt_conn *conn, u16 mtu)
+{
+    if (!conn || conn->mtu == mtu) {
+        return;
+    }
+
+    conn->mtu = mtu;
+
+#if CONFIG_BT_MESH_PROXY_DLE
+    conn_data_length_set(conn);
+#endif /* CONFIG_BT_MESH_PROXY_DLE */
+}
+
+/* The stack reports the MTU here without a handle, so it is only taken
+ * while a single link is up. ATT_EVENT_MTU_EXCHANGE_COMPLETE names the
+ * connection and sets it for every link.
+ */
 void hci_set_mtu_callback(u16 mtu)
 {
-    conn.mtu = mtu;
+    int i;
+
+    if (conn_count != 1) {
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(conns); i++) {
+        if (conns[i].connected) {
+            conn_mtu_set(&conns[i], mtu);
+        }
+    }
 }
 
 u16 hci_get_conn_handle(void)
 {
-    return conn.handle;
+    return conn_last ? conn_last->handle : 0;
 }
 
 static inline void hci_set_conn_run(u16 conn_handle)
 {
-    conn.handle = conn_handle;
+    struct bt_conn *conn = NULL;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(conns); i++) {
+        if (!conns[i].connected) {
+            conn = &conns[i];
+            break;
+        }
+    }
+
+    /* Nothing would serve or ever release the link */
+    if (!conn) {
+        BT_ERR("No free connection for handle 0x%x", conn_handle);
+#if CMD_DIRECT_TO_BTCTRLER_TASK_EN
+        ll_hci_disconnect(conn_handle, 0x13);
+#else
+        ble_user_cmd_prepare(BLE_CMD_DISCONNECT, 1, conn_handle);
+#endif /* CMD_DIRECT_TO_BTCTRLER_TASK_EN */
+        return;
+    }
 
-    callback_list->connected(&conn, 0);
+    conn->handle = conn_handle;
+    conn->mtu = BT_ATT_DEFAULT_LE_MTU;
+    conn->connected = true;
+    conn_last = conn;
+    conn_count++;
 
-    is_connect = TRUE;
+    callback_list->connected(conn, 0);
 }
 
-static inline void hci_set_disconn_run(void)
+static inline void hci_set_disconn_run(u16 conn_handle, u8 reason)
 {
-    callback_list->disconnected(&conn, 0);
+    struct bt_conn *conn = bt_conn_lookup_handle(conn_handle);
 
-    is_connect = FALSE;
+    if (!conn) {
+        return;
+    }
+
+    callback_list->disconnected(conn, reason);
+
+    conn->connected = false;
+    if (conn_last == conn) {
+        conn_last = NULL;
+    }
+    conn_count--;
 }
 
 static inline void le_pkey_complete(u8 *buf, u16 size)
@@ -213,6 +334,9 @@ static inline void le_pkey_complete(u8 *buf, u16 size)
         memcpy(pub_key, evt->key, 64);
     }
 
+    pub_key_busy = false;
+    pub_key_valid = !evt->status;
+
     for (cb = pub_key_cb; cb; cb = cb->_next) {
         cb->func(evt->status ? NULL : evt->key);
     }
@@ -245,9 +369,17 @@ void mesh_hci_event_callback(u8 packet_type, u8 channel, u8 *packet, u16 size)
         switch (packet[0]) {
         case HCI_DISCONNECTION_COMPLETE_EVENT:
             BT_INFO("HCI_DISCONNECTION_COMPLETE_EVENT");
-            hci_set_disconn_run();
+            hci_set_disconn_run(sys_get_le16(&packet[3]), packet[5]);
             resume_mesh_gatt_proxy_adv_thread();
             break;
+        case ATT_EVENT_MTU_EXCHANGE_COMPLETE:
+            conn_mtu_set(bt_conn_lookup_handle(
+                             att_event_mtu_exchange_complete_get_handle(packet)),
+                         att_event_mtu_exchange_complete_get_MTU(packet));
+            break;
+        case ATT_EVENT_CAN_SEND_NOW:
+            bt_mesh_proxy_can_send_now();
+            break;
         case HCI_LE_META_EVENT:
             switch (packet[2]) {
             case HCI_LE_CONNECTION_COMPLETE_EVENT:
@@ -9,6 +9,7 @@
 #include "adaptation.h"
 #include "ble/hci_ll.h"
 #include "btstack/bluetooth.h"
+#include "system/timer.h"
 
 #define LOG_TAG             "[MESH-scan_core]"
 #define LOG_INFO_ENABLE
@@ -31,13 +32,33 @@ int bt_le_scan_stop(void)
     return 0;
 }
 
+void bt_le_scan_rx_stats_get(struct bt_le_scan_rx_stats *stats) {}
+
+void bt_le_scan_rx_stats_reset(void) {}
+
+int bt_le_scan_profile_set(enum bt_le_scan_profile profile)
+{
+    return 0;
+}
+
+enum bt_le_scan_profile bt_le_scan_profile_get(void)
+{
+    return CONFIG_BT_MESH_SCAN_PROFILE;
+}
+
+void bt_le_scan_adv_start(void) {}
+
+void bt_le_scan_adv_end(void) {}
+
+void bt_le_scan_time_stats_get(struct bt_le_scan_time_stats *stats) {}
+
+void bt_le_scan_time_stats_reset(void) {}
+
 #else /* ADAPTATION_COMPILE_DEBUG */
 
 /* Window and Interval are equal for continuous scanning */
 #define MESH_SCAN_INTERVAL_MS 10
 #define MESH_SCAN_WINDOW_MS   10
-#define MESH_SCAN_INTERVAL    ADV_SCAN_UNIT(MESH_SCAN_INTERVAL_MS)
-#define MESH_SCAN_WINDOW      ADV_SCAN_UNIT(MESH_SCAN_WINDOW_MS)
 
 /* Scan types */
 #define BT_HCI_LE_SCAN_PASSIVE                  0x00
@@ -70,6 +91,60 @@ struct bt_le_scan_param {
 
 static bt_le_scan_cb_t *scan_dev_found_cb;
 
+static const struct {
+    u16_t interval_ms;
+    u16_t window_ms;
+    u8_t  adv_pause;    /* Stop scanning while our own PDU is on air */
+} scan_profile[] = {
+    [BT_LE_SCAN_PROFILE_CONTINUOUS] = {
+        MESH_SCAN_INTERVAL_MS, MESH_SCAN_WINDOW_MS, 0
+    },
+    [BT_LE_SCAN_PROFILE_INTERLEAVED] = {
+        MESH_SCAN_INTERVAL_MS, MESH_SCAN_WINDOW_MS, 1
+    },
+    [BT_LE_SCAN_PROFILE_LOW_DUTY] = {
+        CONFIG_BT_MESH_SCAN_LOW_DUTY_INTERVAL,
+        CONFIG_BT_MESH_SCAN_LOW_DUTY_WINDOW, 1
+    },
+};
+
+static u8_t scan_cur_profile = CONFIG_BT_MESH_SCAN_PROFILE;
+static bool scan_enabled;       /* Between bt_le_scan_start() and _stop() */
+static bool scan_radio_on;      /* Scanner actually running */
+static bool scan_adv_active;    /* Own advertising in progress */
+static u32_t scan_since;
+static u32_t adv_since;
+
+static struct bt_le_scan_time_stats scan_time_stats;
+
+#if CONFIG_BT_MESH_SCAN_RX_RING_SIZE
+#if (CONFIG_BT_MESH_SCAN_RX_RING_SIZE & (CONFIG_BT_MESH_SCAN_RX_RING_SIZE - 1)) || \
+    (CONFIG_BT_MESH_SCAN_RX_RING_SIZE > 128)
+#error "CONFIG_BT_MESH_SCAN_RX_RING_SIZE must be a power of 2 up to 128"
+#endif
+
+#define SCAN_RX_RING_MASK           (CONFIG_BT_MESH_SCAN_RX_RING_SIZE - 1)
+
+struct scan_report {
+    bt_addr_le_t addr;
+    s8_t  rssi;
+    u8_t  adv_type;
+    u8_t  len;
+    u8_t  data[31];
+};
+
+/* Single producer (handle_scan_callback) single consumer (scan_rx_worker)
+ * ring. Indices run freely and wrap at 256, head is only written by the
+ * producer and tail only by the consumer, so no lock is needed.
+ */
+static struct scan_report scan_rx_ring[CONFIG_BT_MESH_SCAN_RX_RING_SIZE];
+static volatile u8_t scan_rx_head;
+static volatile u8_t scan_rx_tail;
+static volatile u8_t scan_rx_pending;
+#endif /* CONFIG_BT_MESH_SCAN_RX_RING_SIZE */
+
+static struct bt_le_scan_rx_stats scan_rx_stats;
+
 
 static void ble_set_scan_param(u8 scan_type, u16 scan_interval, u16 scan_window)
 {
@@ -91,6 +166,125 @@ void ble_set_scan_enable(bool en)
 #endif /* CMD_DIRECT_TO_BTCTRLER_TASK_EN */
 }
 
+#if CONFIG_BT_MESH_SCAN_RX_RING_SIZE
+static void scan_rx_worker(void *priv);
+
+static void scan_rx_kick(void)
+{
+    if (scan_rx_pending) {
+        return;
+    }
+
+    /* Set first, the worker may run before sys_timeout_add() returns.
+     * Without a timer the reports stay queued and the next one kicks
+     * again.
+     */
+    scan_rx_pending = 1;
+    if (!sys_timeout_add(NULL, scan_rx_worker, 1)) {
+        BT_ERR("No timer for the scan ring");
+        scan_rx_pending = 0;
+    }
+}
+
+static void scan_rx_worker(void *priv)
+{
+    u8_t n;
+
+    scan_rx_pending = 0;
+    scan_rx_stats.batches++;
+
+    /* Bounded batches keep other timers of this task running during a
+     * burst, whatever is left gets another pass right after.
+     */
+    for (n = 0; n < CONFIG_BT_MESH_SCAN_RX_BATCH; n++) {
+        struct scan_report *report;
+        struct net_buf_simple buf;
+
+        if (scan_rx_tail == scan_rx_head) {
+            return;
+        }
+
+        report = &scan_rx_ring[scan_rx_tail & SCAN_RX_RING_MASK];
+
+        buf.data = report->data;
+        buf.len = report->len;
+        buf.__buf = report->data;
+
+        scan_dev_found_cb(&report->addr, report->rssi, report->adv_type,
+                          &buf);
+
+        /* Only now the slot may be reused by the producer */
+        scan_rx_tail++;
+        scan_rx_stats.processed++;
+    }
+
+    if (scan_rx_tail != scan_rx_head) {
+        scan_rx_kick();
+    }
+}
+
+/* Each mesh PDU is usually heard several times in a row, once per
+ * transmission. Copies still waiting in the ring are dropped here,
+ * before they cost any parsing or crypto.
+ */
+static bool scan_rx_queued(u8_t adv_type, const u8_t *data, u8_t len)
+{
+    u8_t i;
+
+    for (i = scan_rx_tail; i != scan_rx_head; i++) {
+        struct scan_report *report = &scan_rx_ring[i & SCAN_RX_RING_MASK];
+
+        if (report->adv_type == adv_type && report->len == len &&
+            !memcmp(report->data, data, len)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void handle_scan_callback(uint8_t *packet, uint16_t size)
+{
+    struct scan_report *report;
+    u8_t depth, len = packet[11];
+
+    scan_rx_stats.received++;
+
+    if (len > sizeof(report->data)) {
+        return;
+    }
+
+    if (scan_rx_queued(packet[2], &packet[12], len)) {
+        scan_rx_stats.dup++;
+        return;
+    }
+
+    depth = scan_rx_head - scan_rx_tail;
+    if (depth == CONFIG_BT_MESH_SCAN_RX_RING_SIZE) {
+        scan_rx_stats.overflow++;
+        scan_rx_kick();
+        return;
+    }
+
+    report = &scan_rx_ring[scan_rx_head & SCAN_RX_RING_MASK];
+
+    reverse_bytes(&packet[4], report->addr.a.val, 6);
+    report->addr.type = packet[3];
+    report->rssi = packet[10];
+    report->adv_type = packet[2];
+    report->len = len;
+    memcpy(report->data, &packet[12], len);
+
+    /* Publish the slot only once it's completely written */
+    scan_rx_head++;
+
+    if (++depth > scan_rx_stats.depth_max) {
+        scan_rx_stats.depth_max = depth;
+    }
+
+    scan_rx_kick();
+}
+#else
 void handle_scan_callback(uint8_t *packet, uint16_t size)
 {
     bt_addr_le_t addr;
@@ -113,25 +307,80 @@ void handle_scan_callback(uint8_t *packet, uint16_t size)
 
     adv_type = packet[2];
 
+    scan_rx_stats.received++;
+    scan_rx_stats.processed++;
+
     scan_dev_found_cb(&addr, rssi, adv_type, &buf);
 }
+#endif /* CONFIG_BT_MESH_SCAN_RX_RING_SIZE */
 
-int bt_le_scan_start(bt_le_scan_cb_t cb)
+void bt_le_scan_rx_stats_get(struct bt_le_scan_rx_stats *stats)
+{
+    *stats = scan_rx_stats;
+}
+
+void bt_le_scan_rx_stats_reset(void)
+{
+    (void)memset(&scan_rx_stats, 0, sizeof(scan_rx_stats));
+}
+
+/* Scanner on time, estimated as the window share of the time enabled */
+static void scan_time_update(void)
+{
+    u32_t now = k_uptime_get_32();
+
+    if (scan_radio_on) {
+        scan_time_stats.scan_ms +=
+            (u32_t)((u64_t)(now - scan_since) *
+                    scan_profile[scan_cur_profile].window_ms /
+                    scan_profile[scan_cur_profile].interval_ms);
+    }
+
+    scan_since = now;
+}
+
+static void scan_radio_set(bool on)
+{
+    if (on == scan_radio_on) {
+        return;
+    }
+
+    scan_time_update();
+    scan_radio_on = on;
+
+    ble_set_scan_enable(on);
+}
+
+static void scan_radio_update(void)
+{
+    scan_radio_set(scan_enabled &&
+                   !(scan_adv_active && scan_profile[scan_cur_profile].adv_pause));
+}
+
+static void scan_param_apply(void)
 {
     struct bt_le_scan_param scan_param = {
         .type       = BT_HCI_LE_SCAN_PASSIVE,
         .filter_dup = BT_HCI_LE_SCAN_FILTER_DUP_DISABLE,
-        .interval   = MESH_SCAN_INTERVAL,
-        .window     = MESH_SCAN_WINDOW
+        .interval   = ADV_SCAN_UNIT(scan_profile[scan_cur_profile].interval_ms),
+        .window     = ADV_SCAN_UNIT(scan_profile[scan_cur_profile].window_ms)
     };
 
+    ble_set_scan_param(scan_param.type, scan_param.interval, scan_param.window);
+}
+
+int bt_le_scan_start(bt_le_scan_cb_t cb)
+{
     scan_dev_found_cb = cb;
 
     BT_INFO("--func=%s", __FUNCTION__);
 
-    ble_set_scan_param(scan_param.type, scan_param.interval, scan_param.window);
+    /* Parameters can only change while the scanner is off */
+    scan_radio_set(0);
+    scan_param_apply();
 
-    ble_set_scan_enable(1);
+    scan_enabled = 1;
+    scan_radio_update();
 
     return 0;
 }
@@ -140,9 +389,90 @@ int bt_le_scan_stop(void)
 {
     BT_INFO("--func=%s", __FUNCTION__);
 
-    ble_set_scan_enable(0);
+    scan_enabled = 0;
+    scan_radio_set(0);
 
     return 0;
 }
 
+int bt_le_scan_profile_set(enum bt_le_scan_profile profile)
+{
+    if (profile >= ARRAY_SIZE(scan_profile)) {
+        return -EINVAL;
+    }
+
+    BT_INFO("scan profile %u -> %u", scan_cur_profile, profile);
+
+    if (profile == scan_cur_profile) {
+        return 0;
+    }
+
+    if (scan_radio_on) {
+        scan_radio_set(0);
+        scan_cur_profile = profile;
+        scan_param_apply();
+    } else {
+        scan_cur_profile = profile;
+        if (scan_enabled) {
+            scan_param_apply();
+        }
+    }
+
+    scan_radio_update();
+
+    return 0;
+}
+
+enum bt_le_scan_profile bt_le_scan_profile_get(void)
+{
+    return scan_cur_profile;
+}
+
+void bt_le_scan_adv_start(void)
+{
+    if (scan_adv_active) {
+        return;
+    }
+
+    scan_adv_active = 1;
+    adv_since = k_uptime_get_32();
+
+    if (scan_radio_on && scan_profile[scan_cur_profile].adv_pause) {
+        scan_time_stats.pauses++;
+    }
+
+    scan_radio_update();
+}
+
+void bt_le_scan_adv_end(void)
+{
+    if (!scan_adv_active) {
+        return;
+    }
+
+    scan_adv_active = 0;
+    scan_time_stats.adv_ms += k_uptime_get_32() - adv_since;
+
+    scan_radio_update();
+}
+
+void bt_le_scan_time_stats_get(struct bt_le_scan_time_stats *stats)
+{
+    scan_time_update();
+
+    *stats = scan_time_stats;
+
+    if (scan_adv_active) {
+        stats->adv_ms += k_uptime_get_32() - adv_since;
+    }
+}
+
+void bt_le_scan_time_stats_reset(void)
+{
+    scan_time_update();
+    adv_since = scan_since;
+
+    (void)memset(&scan_time_stats, 0, sizeof(scan_time_stats));
+}
+
 #endif /* ADAPTATION_COMPILE_DEBUG */
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Run NODES node processes on one loopback radio and sum up their reports.
+# Every other argument goes to all nodes, see mesh_node -h.
+#
+#   ./bench.sh 16 -r 2 -l 10 -T 16 -c 100 -i 100 -t 20000  relay storm to the group
+#   ./bench.sh 4 -a 4 -s 60 -c 20 -i 1000 -t 30000         segmented transfer 0 -> 3
+#
+# The stack has one node per image, so every node is its own process and
+# node n listens on UDP port + n. Runs of up to 128 nodes on a line
+# (-r 2) kept real time on a single core. The processes share the wall
+# clock, so past what the host can keep up with, the delays show up as
+# latency and misses. With -r 0 every frame goes to every node, N * N
+# datagrams per advertising round.
+
+NODES=${1:?usage: $0 NODES [mesh_node options]}
+shift
+
+NODE=${NODE:-$(dirname "$0")/build/mesh_node}
+LOG=${LOG:-/tmp/mesh_bench}
+
+mkdir -p "$LOG"
+rm -f "$LOG"/node*.out "$LOG"/node*.log
+
+i=0
+while [ $i -lt "$NODES" ]; do
+    "$NODE" -n $i -N "$NODES" "$@" > "$LOG/node$i.out" 2> "$LOG/node$i.log" &
+    i=$((i + 1))
+done
+wait
+
+cat "$LOG"/node*.out | sort -n -k2
+
+# Delivery ratio and mean latency over the receivers
+cat "$LOG"/node*.out | awk '
+/ rx / {
+    split($4, r, "/"); got += r[1]; want += r[2]
+    if ($5 == "latency") { split($6, l, "/"); lat += l[2] * r[1] }
+}
+/ cpu / { for (i = 1; i < NF; i++) if ($i == "cpu") { cpu += $(i + 1); n++ } }
+END {
+    if (want) printf "delivery %.1f%%", 100 * got / want
+    if (got) printf " latency %u ms", lat / got
+    if (n) printf " cpu %u ns/pdu", cpu / n
+    print ""
+}'
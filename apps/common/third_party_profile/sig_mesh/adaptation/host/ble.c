@@ -0,0 +1,86 @@
+/* Host stand-in for hci_core.c and gatt_core.c. There is neither a GATT
+ * bearer nor P-256 on the host: nodes are provisioned with
+ * bt_mesh_provision() and only talk over the advertising bearer.
+ */
+
+#include "host.h"
+
+#define LOG_TAG             "[MESH-host_ble]"
+#define LOG_WARN_ENABLE
+#define LOG_ERROR_ENABLE
+#include "mesh_log.h"
+
+/* The key never gets ready, like with ADAPTATION_COMPILE_DEBUG, so the
+ * provisioning code just keeps waiting for it.
+ */
+int bt_pub_key_gen(struct bt_pub_key_cb *new_cb)
+{
+    return 0;
+}
+
+const u8_t *bt_pub_key_get(void)
+{
+    return NULL;
+}
+
+int bt_dh_key_gen(const u8_t remote_pk[64], bt_dh_key_cb_t cb)
+{
+    return -ENOTSUP;
+}
+
+struct bt_conn *bt_conn_ref(struct bt_conn *conn)
+{
+    return conn;
+}
+
+void bt_conn_unref(struct bt_conn *conn) {}
+
+void bt_conn_cb_register(struct bt_conn_cb *cb) {}
+
+struct bt_conn *bt_conn_lookup_handle(u16_t handle)
+{
+    return NULL;
+}
+
+bool get_if_connecting(void)
+{
+    return false;
+}
+
+void hci_core_init(void) {}
+
+u8 *get_server_data_addr(void)
+{
+    return NULL;
+}
+
+void bt_gatt_service_register(u32 uuid) {}
+
+void bt_gatt_service_unregister(u32 uuid) {}
+
+int bt_gatt_notify(struct bt_conn *conn, const void *data, u16_t len)
+{
+    return -ENOTCONN;
+}
+
+u16 bt_gatt_get_mtu(struct bt_conn *conn)
+{
+    return 23;
+}
+
+u16 bt_gatt_notify_room(struct bt_conn *conn)
+{
+    return 0;
+}
+
+void bt_gatt_notify_request(struct bt_conn *conn) {}
+
+void bt_conn_disconnect(struct bt_conn *conn, u8 reason) {}
+
+void proxy_gatt_init(void) {}
+
+void unprovision_connectable_adv(void) {}
+
+void proxy_connectable_adv(void) {}
+
+void proxy_fast_connectable_adv(void) {}
@@ -0,0 +1,75 @@
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include "adaptation.h"
+
+/*******************************************************************/
+/*
+ *-------------------   timer.c
+ */
+#define HOST_TIMER_NONE         0xffffffff
+
+/* Time of the next timer, HOST_TIMER_NONE if none is armed */
+u32 host_timer_next(void);
+
+/* Run every timer that is due at the current time */
+void host_timer_run(void);
+
+/* Start the clock at ms, before any timer is armed */
+void host_clock_start(u32 ms);
+
+/* Move the clock forward, never back */
+void host_clock_set(u32 ms);
+
+/* CPU time spent in timer callbacks, radio reports included */
+u64 host_cpu_ns(void);
+void host_cpu_ns_reset(void);
+
+/*******************************************************************/
+/*
+ *-------------------   vm.c
+ */
+int host_vm_open(const char *path);
+void host_vm_close(void);
+
+/*******************************************************************/
+/*
+ *-------------------   radio.c
+ */
+struct host_radio_param {
+    u16 node;               /* This node, 0 .. nodes - 1 */
+    u16 nodes;              /* Nodes on the medium */
+    u16 port;               /* UDP port of node 0, node n uses port + n */
+    u16 range;              /* Hops a frame reaches on a line, 0: everyone */
+    u8  loss;               /* Percent of frames each receiver drops */
+    u16 delay;              /* ms from advertising event to report */
+};
+
+struct host_radio_stats {
+    u32 adv_events;         /* Advertising events sent */
+    u32 frames_rx;          /* Frames heard from the medium */
+    u32 frames_lost;        /* Dropped to the loss setting */
+    u32 frames_missed;      /* Arrived while the scanner was off */
+    u32 reports;            /* Handed to the scan callback */
+};
+
+int host_radio_open(const struct host_radio_param *param);
+void host_radio_close(void);
+
+/* Wait up to timeout_ms for frames from other nodes */
+void host_radio_wait(u32 timeout_ms);
+
+/* Take the frames that arrived, their reports are due after the delay */
+void host_radio_rx(void);
+
+void host_radio_stats_get(struct host_radio_stats *stats);
+void host_radio_stats_reset(void);
+
+/*******************************************************************/
+/*
+ *-------------------   micro.c
+ */
+/* Run the micro-benchmark name and print its results */
+int host_micro_run(const char *name);
+
+#endif /* __HOST_H__ */
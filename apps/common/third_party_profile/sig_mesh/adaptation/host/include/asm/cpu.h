@@ -0,0 +1,101 @@
+#ifndef ASM_CPU_H
+#define ASM_CPU_H
+
+/* Host stand-in for include_lib/driver/cpu/<cpu>/asm/cpu.h. The stack runs
+ * single threaded on the host, so critical sections are no-ops.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#ifndef __ASSEMBLY__
+
+typedef unsigned char   		u8, bool, BOOL;
+typedef char            		s8;
+typedef unsigned short  		u16;
+typedef signed short    		s16;
+typedef unsigned int    		u32;
+typedef signed int      		s32;
+typedef unsigned long long 		u64;
+typedef u32						FOURCC;
+typedef long long               s64;
+
+#endif
+
+#define __packed        __attribute__((packed))
+#define __aligned(x)    __attribute__((aligned(x)))
+
+#ifndef BIG_ENDIAN
+#define BIG_ENDIAN 			0x3021
+#endif
+#ifndef LITTLE_ENDIAN
+#define LITTLE_ENDIAN 		0x4576
+#endif
+#define CPU_ENDIAN 			LITTLE_ENDIAN
+
+#define CPU_CORE_NUM     1
+
+#ifndef __ASSEMBLY__
+
+static inline int current_cpu_id()
+{
+    return 0;
+}
+
+static inline int cpu_in_irq()
+{
+    return 0;
+}
+
+static inline int cpu_irq_disabled()
+{
+    return 0;
+}
+
+static inline u32 reverse_u32(u32 data32)
+{
+    return __builtin_bswap32(data32);
+}
+
+static inline u32 reverse_u16(u16 data16)
+{
+    return __builtin_bswap16(data16);
+}
+
+static inline u32 rand32()
+{
+    return ((u32)random() << 16) ^ (u32)random();
+}
+
+static inline void cpu_reset(void)
+{
+    abort();
+}
+
+#include "generic/printf.h"
+#include "system/generic/log.h"
+
+extern void local_irq_disable();
+extern void local_irq_enable();
+
+#define	CPU_SR_ALLOC()
+
+#define CPU_CRITICAL_ENTER()    local_irq_disable()
+
+#define CPU_CRITICAL_EXIT()     local_irq_enable()
+
+#define ASSERT(a,...)   \
+		do { \
+			if(!(a)){ \
+				log_e("file:%s, line:%d", __FILE__, __LINE__); \
+				log_e("ASSERT-FAILD: "#a" "__VA_ARGS__); \
+				cpu_reset(); \
+			} \
+		}while(0);
+
+#endif //__ASSEMBLY__
+
+#endif
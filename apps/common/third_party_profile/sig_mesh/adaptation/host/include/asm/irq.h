@@ -0,0 +1,6 @@
+#ifndef CPU_IRQ_H
+#define CPU_IRQ_H
+
+/* No interrupts on the host */
+
+#endif
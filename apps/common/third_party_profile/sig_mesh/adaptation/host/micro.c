@@ -0,0 +1,475 @@
+/* Micro-benchmarks of single stack paths, run with mesh_node -b name.
+ * They use the stack functions directly and need no radio and no
+ * provisioned node.
+ *
+ *   crypto  network and access PDU encryption with the cached AES key
+ *           schedule, and with the key expanded again for every block
+ *           as bt_encrypt_be() did before the schedules were cached
+ *   access  bt_mesh_model_recv() and bt_mesh_elem_find() on a composition
+ *           of MICRO_ELEMS elements, with whatever dispatch the build has
+ *           (CONFIG_BT_MESH_MODEL_OP_INDEX, CONFIG_BT_MESH_SUB_INDEX)
+ */
+
+#include <time.h>
+#include "adaptation.h"
+#include <tinycrypt/constants.h>
+#include <tinycrypt/aes.h>
+#include "crypto.h"
+#include "net.h"
+#include "access.h"
+#include "net/buf.h"
+#include "host.h"
+
+#define LOG_TAG             "[MESH-host_micro]"
+#define LOG_WARN_ENABLE
+#define LOG_ERROR_ENABLE
+#include "mesh_log.h"
+
+#define MICRO_CRYPTO_ROUNDS         20000
+#define MICRO_PASSES                5   /* Best of, the modes alternate */
+#define MICRO_ACCESS_ROUNDS         100000
+
+#define MICRO_ELEMS                 32
+#define MICRO_ADDR                  0x0100  /* Of the first element */
+#define MICRO_GROUP                 0xc100  /* One model on every 8th element */
+#define MICRO_GROUP_NONE            0xc200  /* Nobody subscribed */
+
+/* Linked with --wrap=tc_aes_encrypt, see the Makefile */
+int __real_tc_aes_encrypt(uint8_t *out, const uint8_t *in,
+                          const TCAesKeySched_t s);
+
+static bool micro_reexpand;
+static u32 micro_blocks;
+
+/* Every AES block of the stack comes through here. The first round key
+ * of the schedule is the key itself, big endian, so the schedule can be
+ * expanded again from it.
+ */
+int __wrap_tc_aes_encrypt(uint8_t *out, const uint8_t *in,
+                          const TCAesKeySched_t s)
+{
+    micro_blocks++;
+
+    if (micro_reexpand) {
+        struct tc_aes_key_sched_struct sched;
+        u8_t key[16];
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            sys_put_be32(s->words[i], &key[i * 4]);
+        }
+
+        tc_aes128_set_encrypt_key(&sched, key);
+
+        return __real_tc_aes_encrypt(out, in, &sched);
+    }
+
+    return __real_tc_aes_encrypt(out, in, s);
+}
+
+static u64 micro_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return (u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static const u8_t micro_key[16] = {
+    0x7d, 0xd7, 0x36, 0x4c, 0xd8, 0x42, 0xad, 0x18,
+    0xc1, 0x7c, 0x2b, 0x82, 0x0c, 0x84, 0xc3, 0xd6,
+};
+
+static struct tc_aes_key_sched_struct micro_enc;
+static struct tc_aes_key_sched_struct micro_privacy;
+static struct tc_aes_key_sched_struct micro_app;
+
+/* Unsegmented access PDU with the largest payload: network header,
+ * lower transport header and 11 bytes of payload with the TransMIC
+ */
+static const u8_t micro_net_pdu[] = {
+    0x68, 0x03, 0x00, 0x00, 0x07, 0x12, 0x01, 0xff, 0xfd,
+    0x66, 0x1e, 0x67, 0x1c, 0x72, 0xc6, 0x85, 0x06,
+    0x44, 0x34, 0xe3, 0x9c, 0x84, 0x9b, 0x5f, 0x33,
+};
+
+static u8_t micro_net_enc[sizeof(micro_net_pdu) + 4];
+
+static int micro_net_tx(void)
+{
+    struct net_buf_simple *buf = NET_BUF_SIMPLE(32);
+    int err;
+
+    net_buf_simple_init(buf, 0);
+    net_buf_simple_add_mem(buf, micro_net_pdu, sizeof(micro_net_pdu));
+
+    err = bt_mesh_net_encrypt(&micro_enc, buf, 0x12345678, false);
+    if (err) {
+        return err;
+    }
+
+    err = bt_mesh_net_obfuscate(buf->data, 0x12345678, &micro_privacy);
+    if (err) {
+        return err;
+    }
+
+    memcpy(micro_net_enc, buf->data, sizeof(micro_net_enc));
+
+    return 0;
+}
+
+static int micro_net_rx(void)
+{
+    struct net_buf_simple *buf = NET_BUF_SIMPLE(32);
+    int err;
+
+    net_buf_simple_init(buf, 0);
+    net_buf_simple_add_mem(buf, micro_net_enc, sizeof(micro_net_enc));
+
+    err = bt_mesh_net_obfuscate(buf->data, 0x12345678, &micro_privacy);
+    if (err) {
+        return err;
+    }
+
+    return bt_mesh_net_decrypt(&micro_enc, buf, 0x12345678, false);
+}
+
+static u8_t micro_app_enc[11 + 4];
+
+static int micro_app_tx(void)
+{
+    struct net_buf_simple *buf = NET_BUF_SIMPLE(16);
+    int err;
+
+    net_buf_simple_init(buf, 0);
+    net_buf_simple_add_mem(buf, &micro_net_pdu[10], 11);
+
+    err = bt_mesh_app_encrypt(&micro_app, false, 0, buf, NULL, 0x1201,
+                              0xfffd, 0x000007, 0x12345678);
+    if (!err) {
+        memcpy(micro_app_enc, buf->data, sizeof(micro_app_enc));
+    }
+
+    return err;
+}
+
+static int micro_app_rx(void)
+{
+    struct net_buf_simple *buf = NET_BUF_SIMPLE(16);
+    struct net_buf_simple *out = NET_BUF_SIMPLE(16);
+
+    net_buf_simple_init(buf, 0);
+    net_buf_simple_init(out, 0);
+    net_buf_simple_add_mem(buf, micro_app_enc, sizeof(micro_app_enc));
+
+    /* The TransMIC follows the payload */
+    buf->len -= 4;
+
+    return bt_mesh_app_decrypt(&micro_app, false, 0, buf, out, NULL, 0x1201,
+                               0xfffd, 0x000007, 0x12345678);
+}
+
+static int micro_key_expand(void)
+{
+    struct tc_aes_key_sched_struct sched;
+
+    return bt_mesh_aes_key_expand(micro_key, &sched);
+}
+
+static int micro_aes_block(void)
+{
+    u8_t out[16];
+
+    return tc_aes_encrypt(out, micro_key, &micro_enc) == TC_CRYPTO_FAIL;
+}
+
+/* ns per call, 0 if the call failed */
+static u32 micro_time(int (*func)(void), u32 rounds, u32 *blocks)
+{
+    u64 start;
+    u32 i;
+
+    micro_blocks = 0;
+    start = micro_ns();
+
+    for (i = 0; i < rounds; i++) {
+        if (func()) {
+            BT_ERR("Call failed in round %u", i);
+            return 0;
+        }
+    }
+
+    *blocks = micro_blocks / rounds;
+
+    return max((micro_ns() - start) / rounds, 1);
+}
+
+/* Fastest pass in each mode, with the passes of both modes interleaved
+ * so that a slow spell of the host does not hit only one of them
+ */
+static int micro_compare(int (*func)(void), u32 *cached, u32 *reexpand,
+                         u32 *blocks)
+{
+    u32 ns;
+    int i;
+
+    *cached = *reexpand = 0xffffffff;
+
+    for (i = 0; i < MICRO_PASSES; i++) {
+        micro_reexpand = false;
+        ns = micro_time(func, MICRO_CRYPTO_ROUNDS, blocks);
+        *cached = min(*cached, ns);
+
+        micro_reexpand = true;
+        ns = micro_time(func, MICRO_CRYPTO_ROUNDS, blocks);
+        *reexpand = min(*reexpand, ns);
+        micro_reexpand = false;
+
+        if (!ns || !*cached) {
+            return -EIO;
+        }
+    }
+
+    return 0;
+}
+
+static int micro_crypto(void)
+{
+    static const struct {
+        const char *name;
+        int (*func)(void);
+    } cases[] = {
+        { "net tx", micro_net_tx },
+        { "net rx", micro_net_rx },
+        { "app tx", micro_app_tx },
+        { "app rx", micro_app_rx },
+    };
+    u32 cached, reexpand, blocks;
+    int err, i;
+
+    if (bt_mesh_aes_key_expand(micro_key, &micro_enc) ||
+        bt_mesh_aes_key_expand(micro_key, &micro_privacy) ||
+        bt_mesh_aes_key_expand(micro_key, &micro_app)) {
+        return -EINVAL;
+    }
+
+    printf("crypto, best of %u x %u rounds\n", MICRO_PASSES,
+           MICRO_CRYPTO_ROUNDS);
+    printf("  key expansion %u ns, AES block %u ns\n",
+           micro_time(micro_key_expand, MICRO_CRYPTO_ROUNDS, &blocks),
+           micro_time(micro_aes_block, MICRO_CRYPTO_ROUNDS, &blocks));
+
+    for (i = 0; i < ARRAY_SIZE(cases); i++) {
+        err = micro_compare(cases[i].func, &cached, &reexpand, &blocks);
+        if (err) {
+            return err;
+        }
+
+        printf("  %-8s %u blocks, cached %u ns, expanded per block %u ns "
+               "(+%u%%)\n", cases[i].name, blocks, cached, reexpand,
+               (reexpand - min(cached, reexpand)) * 100 / cached);
+    }
+
+    return 0;
+}
+
+static u32 micro_delivered;
+
+static void micro_msg(struct bt_mesh_model *model,
+                      struct bt_mesh_msg_ctx *ctx,
+                      struct net_buf_simple *buf)
+{
+    micro_delivered++;
+}
+
+/* Each element has four SIG models with 8 opcodes each and two vendor
+ * models with 16 each, the same set on every element: 64 opcodes per
+ * element, and every opcode on every element.
+ */
+#define MICRO_SIG_OP(m, k)  { BT_MESH_MODEL_OP_2(0x82, (m) * 8 + (k)), 0, micro_msg }
+#define MICRO_VND_OP(m, k)  { BT_MESH_MODEL_OP_3((m) * 16 + (k), 0x05d6), 0, micro_msg }
+
+#define MICRO_SIG_OPS(m)                                                    \
+    {                                                                       \
+        MICRO_SIG_OP(m, 0), MICRO_SIG_OP(m, 1), MICRO_SIG_OP(m, 2),         \
+        MICRO_SIG_OP(m, 3), MICRO_SIG_OP(m, 4), MICRO_SIG_OP(m, 5),         \
+        MICRO_SIG_OP(m, 6), MICRO_SIG_OP(m, 7), BT_MESH_MODEL_OP_END,       \
+    }
+
+#define MICRO_VND_OPS(m)                                                    \
+    {                                                                       \
+        MICRO_VND_OP(m, 0), MICRO_VND_OP(m, 1), MICRO_VND_OP(m, 2),         \
+        MICRO_VND_OP(m, 3), MICRO_VND_OP(m, 4), MICRO_VND_OP(m, 5),         \
+        MICRO_VND_OP(m, 6), MICRO_VND_OP(m, 7), MICRO_VND_OP(m, 8),         \
+        MICRO_VND_OP(m, 9), MICRO_VND_OP(m, 10), MICRO_VND_OP(m, 11),       \
+        MICRO_VND_OP(m, 12), MICRO_VND_OP(m, 13), MICRO_VND_OP(m, 14),      \
+        MICRO_VND_OP(m, 15), BT_MESH_MODEL_OP_END,                          \
+    }
+
+static const struct bt_mesh_model_op micro_sig_op[4][9] = {
+    MICRO_SIG_OPS(0), MICRO_SIG_OPS(1), MICRO_SIG_OPS(2), MICRO_SIG_OPS(3),
+};
+
+static const struct bt_mesh_model_op micro_vnd_op[2][17] = {
+    MICRO_VND_OPS(0), MICRO_VND_OPS(1),
+};
+
+static struct bt_mesh_model micro_sig_models[MICRO_ELEMS][4] = {
+    [0 ... MICRO_ELEMS - 1] = {
+        BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_ONOFF_SRV, micro_sig_op[0], NULL, NULL),
+        BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_LEVEL_SRV, micro_sig_op[1], NULL, NULL),
+        BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_ONOFF_CLI, micro_sig_op[2], NULL, NULL),
+        BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_LEVEL_CLI, micro_sig_op[3], NULL, NULL),
+    },
+};
+
+static struct bt_mesh_model micro_vnd_models[MICRO_ELEMS][2] = {
+    [0 ... MICRO_ELEMS - 1] = {
+        BT_MESH_MODEL_VND(0x05d6, 0x0010, micro_vnd_op[0], NULL, NULL),
+        BT_MESH_MODEL_VND(0x05d6, 0x0011, micro_vnd_op[1], NULL, NULL),
+    },
+};
+
+#define MICRO_ELEM(e)       BT_MESH_ELEM(0, micro_sig_models[e], micro_vnd_models[e])
+#define MICRO_ELEM4(e)      MICRO_ELEM(e), MICRO_ELEM(e + 1), MICRO_ELEM(e + 2), MICRO_ELEM(e + 3)
+
+static struct bt_mesh_elem micro_elems[MICRO_ELEMS] = {
+    MICRO_ELEM4(0), MICRO_ELEM4(4), MICRO_ELEM4(8), MICRO_ELEM4(12),
+    MICRO_ELEM4(16), MICRO_ELEM4(20), MICRO_ELEM4(24), MICRO_ELEM4(28),
+};
+
+static const struct bt_mesh_comp micro_comp = {
+    .cid = 0x05d6,
+    .elem = micro_elems,
+    .elem_count = ARRAY_SIZE(micro_elems),
+};
+
+static struct bt_mesh_net_rx micro_rx;
+static u8_t micro_access_pdu[8];
+static u8_t micro_access_len;
+
+static int micro_recv(void)
+{
+    struct net_buf_simple buf = {
+        .data = micro_access_pdu,
+        .len = micro_access_len,
+        .size = sizeof(micro_access_pdu),
+        .__buf = micro_access_pdu,
+    };
+
+    bt_mesh_model_recv(&micro_rx, &buf);
+
+    return 0;
+}
+
+static int micro_elem_find(void)
+{
+    (void)bt_mesh_elem_find(micro_rx.ctx.recv_dst);
+
+    return 0;
+}
+
+static int micro_access(void)
+{
+    static const struct {
+        const char *name;
+        u16_t dst;
+        u32_t opcode;
+    } cases[] = {
+        { "unicast, last element, SIG opcode", MICRO_ADDR + MICRO_ELEMS - 1,
+          BT_MESH_MODEL_OP_2(0x82, 31) },
+        { "unicast, last element, vendor opcode", MICRO_ADDR + MICRO_ELEMS - 1,
+          BT_MESH_MODEL_OP_3(31, 0x05d6) },
+        { "group, 4 models subscribed", MICRO_GROUP,
+          BT_MESH_MODEL_OP_2(0x82, 31) },
+        { "group, nobody subscribed", MICRO_GROUP_NONE,
+          BT_MESH_MODEL_OP_2(0x82, 31) },
+    };
+    u32 ns, delivered, blocks;
+    int e, i, m;
+
+    if (bt_mesh_comp_register(&micro_comp)) {
+        return -EINVAL;
+    }
+
+    bt_mesh_comp_provision(MICRO_ADDR);
+
+    for (e = 0; e < MICRO_ELEMS; e++) {
+        for (m = 0; m < 4; m++) {
+            micro_sig_models[e][m].keys[0] = 0;
+        }
+
+        for (m = 0; m < 2; m++) {
+            micro_vnd_models[e][m].keys[0] = 0;
+        }
+
+        if (!(e % 8)) {
+            micro_sig_models[e][3].groups[0] = MICRO_GROUP;
+        }
+    }
+
+    bt_mesh_model_sub_changed();
+
+    printf("access, %u elements with %u models and %u opcodes each, "
+           "best of %u x %u rounds\n", MICRO_ELEMS, 6, 64, MICRO_PASSES,
+           MICRO_ACCESS_ROUNDS);
+
+    micro_rx.ctx.app_idx = 0;
+    micro_rx.ctx.addr = 0x0001;
+
+    for (i = 0; i < ARRAY_SIZE(cases); i++) {
+        micro_rx.ctx.recv_dst = cases[i].dst;
+
+        if (cases[i].opcode > 0xffff) {
+            micro_access_len = 3;
+            micro_access_pdu[0] = cases[i].opcode >> 16;
+            sys_put_le16(cases[i].opcode, &micro_access_pdu[1]);
+        } else {
+            micro_access_len = 2;
+            sys_put_be16(cases[i].opcode, micro_access_pdu);
+        }
+
+        micro_delivered = 0;
+        micro_recv();
+        delivered = micro_delivered;
+
+        ns = 0xffffffff;
+        for (m = 0; m < MICRO_PASSES; m++) {
+            ns = min(ns, micro_time(micro_recv, MICRO_ACCESS_ROUNDS,
+                                    &blocks));
+        }
+
+        printf("  %-38s model_recv %4u ns, %u delivered", cases[i].name, ns,
+               delivered);
+
+        if (BT_MESH_ADDR_IS_GROUP(cases[i].dst)) {
+            ns = 0xffffffff;
+            for (m = 0; m < MICRO_PASSES; m++) {
+                ns = min(ns, micro_time(micro_elem_find, MICRO_ACCESS_ROUNDS,
+                                        &blocks));
+            }
+
+            printf(", elem_find %u ns", ns);
+        }
+
+        printf("\n");
+    }
+
+    return 0;
+}
+
+int host_micro_run(const char *name)
+{
+    if (!strcmp(name, "crypto")) {
+        return micro_crypto();
+    }
+
+    if (!strcmp(name, "access")) {
+        return micro_access();
+    }
+
+    BT_ERR("No micro-benchmark %s", name);
+
+    return -EINVAL;
+}
@@ -0,0 +1,522 @@
+/* A relay node for host test runs. The node provisions itself with fixed
+ * keys and address node + 1, binds a test model and subscribes it to one
+ * group. The origin node sends numbered messages, every node counts what
+ * arrives and reports delivery, latency, goodput and CPU time at exit.
+ *
+ * A single node runs in simulated time. Several node processes share the
+ * loopback radio and follow the monotonic clock, which they all agree on.
+ */
+
+#include <getopt.h>
+#include <time.h>
+#include "adaptation.h"
+#include "net.h"
+#include "transport.h"
+#include "net/buf.h"
+#include "system/timer.h"
+#include "api/sig_mesh_api.h"
+#include "host.h"
+
+#define LOG_TAG             "[MESH-host_node]"
+#define LOG_WARN_ENABLE
+#define LOG_ERROR_ENABLE
+#include "mesh_log.h"
+
+#define BT_COMP_ID_LF               0x05D6 // Zhuhai Jieli technology Co.,Ltd
+#define TEST_MODEL_ID               0x0002
+#define OP_TEST_MSG                 BT_MESH_MODEL_OP_3(0x03, BT_COMP_ID_LF)
+
+#define TEST_GROUP_ADDR             0xc000
+#define TEST_HDR_LEN                8 // seq and send time, fits one segment
+#define TEST_MSG_MAX                4096
+#define TEST_PAYLOAD_MAX            (BT_MESH_TX_SDU_MAX - 4 - 3)
+
+const int config_bt_mesh_features = BT_MESH_FEAT_RELAY;
+
+/* Room for a relay storm */
+const u8 config_bt_mesh_adv_buf_count = 32;
+
+struct test_opt {
+    struct host_radio_param radio;
+    u32 duration;           /* ms the node runs */
+    u32 warmup;             /* ms before the first message, lets the
+                             * self-configuration traffic die down
+                             */
+    u16 origin;             /* Node that sends */
+    u16 dst;                /* Address the origin sends to */
+    u16 count;              /* Messages the origin sends */
+    u16 period;             /* ms between messages */
+    u16 size;               /* Access payload bytes, segmented above 8 */
+    u8  ttl;
+    u8  xmit;               /* Network and relay transmissions */
+    const char *vm_path;
+    const char *micro;      /* Micro-benchmark to run instead */
+    u32 seed;
+};
+
+struct test_rx {
+    u32 msgs;
+    u32 latency_ms;
+    u32 latency_min;
+    u32 latency_max;
+    u8  seen[TEST_MSG_MAX / 8];
+};
+
+static struct test_opt opt = {
+    .radio = {
+        .nodes = 1,
+        .port = 47000,
+        .range = 1,
+    },
+    .duration = 10000,
+    .warmup = 3000,
+    .dst = TEST_GROUP_ADDR,
+    .count = 50,
+    .period = 200,
+    .size = TEST_HDR_LEN,
+    .ttl = 7,
+    .xmit = 2,
+};
+
+static struct test_rx test_rx;
+static u32 test_seq;
+static u32 test_sent;
+static u16 test_timer;
+
+static const u8_t net_key[16] = {
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+};
+
+static const u8_t dev_key[16] = {
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+};
+
+static const u8_t app_key[16] = {
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+};
+
+static const u16_t net_idx;
+static const u16_t app_idx;
+
+static void test_msg(struct bt_mesh_model *model,
+                     struct bt_mesh_msg_ctx *ctx,
+                     struct net_buf_simple *buf);
+
+static const struct bt_mesh_model_op test_op[] = {
+    { OP_TEST_MSG, TEST_HDR_LEN, test_msg },
+    BT_MESH_MODEL_OP_END,
+};
+
+static struct bt_mesh_cfg_srv cfg_srv = {
+    .relay          = BT_MESH_RELAY_ENABLED,
+    .beacon         = BT_MESH_BEACON_DISABLED,
+    .default_ttl    = 7,
+};
+
+static struct bt_mesh_cfg_cli cfg_cli;
+
+static struct bt_mesh_model root_models[] = {
+    BT_MESH_MODEL_CFG_SRV(&cfg_srv),
+    BT_MESH_MODEL_CFG_CLI(&cfg_cli),
+};
+
+static struct bt_mesh_model test_models[] = {
+    BT_MESH_MODEL_VND(BT_COMP_ID_LF, TEST_MODEL_ID, test_op, NULL, NULL),
+};
+
+static struct bt_mesh_elem elements[] = {
+    BT_MESH_ELEM(0, root_models, test_models),
+};
+
+static const struct bt_mesh_comp composition = {
+    .cid = BT_COMP_ID_LF,
+    .elem = elements,
+    .elem_count = ARRAY_SIZE(elements),
+};
+
+static u8_t dev_uuid[16] = { 0xdd, 0xdd };
+
+static const struct bt_mesh_prov prov = {
+    .uuid = dev_uuid,
+};
+
+static u16 node_addr(u16 node)
+{
+    return node + 1;
+}
+
+static u32 wall_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * MSEC_PER_SEC + ts.tv_nsec / NSEC_PER_MSEC;
+}
+
+static bool test_expected(void)
+{
+    if (opt.radio.node == opt.origin) {
+        return false;
+    }
+
+    return opt.dst == TEST_GROUP_ADDR || opt.dst == node_addr(opt.radio.node);
+}
+
+static void test_msg(struct bt_mesh_model *model,
+                     struct bt_mesh_msg_ctx *ctx,
+                     struct net_buf_simple *buf)
+{
+    u32 seq = net_buf_simple_pull_le32(buf);
+    u32 sent = net_buf_simple_pull_le32(buf);
+    u32 latency = k_uptime_get_32() - sent;
+
+    if (seq >= TEST_MSG_MAX || (test_rx.seen[seq / 8] & BIT(seq % 8))) {
+        return;
+    }
+
+    test_rx.seen[seq / 8] |= BIT(seq % 8);
+    test_rx.msgs++;
+    test_rx.latency_ms += latency;
+
+    if (test_rx.msgs == 1 || latency < test_rx.latency_min) {
+        test_rx.latency_min = latency;
+    }
+
+    if (latency > test_rx.latency_max) {
+        test_rx.latency_max = latency;
+    }
+}
+
+static void test_send(void *priv)
+{
+    NET_BUF_SIMPLE_DEFINE(msg, 3 + TEST_PAYLOAD_MAX + 4);
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = net_idx,
+        .app_idx = app_idx,
+        .addr = opt.dst,
+        .send_ttl = opt.ttl,
+    };
+    int err;
+
+    if (test_seq == opt.count) {
+        sys_timer_del(test_timer);
+        test_timer = 0;
+        return;
+    }
+
+    bt_mesh_model_msg_init(&msg, OP_TEST_MSG);
+    net_buf_simple_add_le32(&msg, test_seq);
+    net_buf_simple_add_le32(&msg, k_uptime_get_32());
+    memset(net_buf_simple_add(&msg, opt.size - TEST_HDR_LEN), 0xa5,
+           opt.size - TEST_HDR_LEN);
+
+    err = bt_mesh_model_send(&test_models[0], &ctx, &msg, NULL, NULL);
+    if (err) {
+        BT_ERR("Message %u not sent (err %d)", test_seq, err);
+    } else {
+        test_sent++;
+    }
+
+    test_seq++;
+}
+
+static void test_start(void *priv)
+{
+    bt_mesh_stats_reset();
+    host_radio_stats_reset();
+    host_cpu_ns_reset();
+
+    if (opt.radio.node == opt.origin && opt.count) {
+        test_timer = sys_timer_add(NULL, test_send, opt.period);
+        test_send(NULL);
+    }
+}
+
+static void configure(void)
+{
+    u16 addr = node_addr(opt.radio.node);
+
+    bt_mesh_cfg_app_key_add(net_idx, addr, net_idx, app_idx, app_key, NULL);
+
+    bt_mesh_cfg_mod_app_bind_vnd(net_idx, addr, addr, app_idx,
+                                 TEST_MODEL_ID, BT_COMP_ID_LF, NULL);
+
+    bt_mesh_cfg_mod_sub_add_vnd(net_idx, addr, addr, TEST_GROUP_ADDR,
+                                TEST_MODEL_ID, BT_COMP_ID_LF, NULL);
+}
+
+static int mesh_start(void)
+{
+    int err;
+
+    cfg_srv.net_transmit = BT_MESH_TRANSMIT(opt.xmit, 20);
+    cfg_srv.relay_retransmit = BT_MESH_TRANSMIT(opt.xmit, 20);
+
+    hci_core_init();
+
+    err = bt_mesh_init(&prov, &composition);
+    if (err) {
+        BT_ERR("Initializing mesh failed (err %d)", err);
+        return err;
+    }
+
+    settings_load();
+
+    err = bt_mesh_provision(net_key, net_idx, 0, 0, node_addr(opt.radio.node),
+                            dev_key);
+    if (!err) {
+        configure();
+    } else if (err != -EALREADY) {
+        BT_ERR("Provisioning failed (err %d)", err);
+        return err;
+    }
+
+    return 0;
+}
+
+/* Jump from one timer to the next, the run takes no real time */
+static void run_simulated(u32 end)
+{
+    u32 next;
+
+    while ((next = host_timer_next()) != HOST_TIMER_NONE &&
+           (s32)(end - next) > 0) {
+        host_clock_set(next);
+        host_timer_run();
+    }
+
+    host_clock_set(end);
+}
+
+/* Follow the wall clock and take frames from the other nodes as they come */
+static void run_realtime(u32 end)
+{
+    u32 now;
+
+    while ((s32)(end - (now = wall_ms())) > 0) {
+        u32 next = host_timer_next();
+        u32 wait = end - now;
+
+        if (next != HOST_TIMER_NONE) {
+            wait = (s32)(next - now) > 0 ? min(wait, next - now) : 0;
+        }
+
+        host_radio_wait(wait);
+
+        host_clock_set(wall_ms());
+        host_radio_rx();
+        host_timer_run();
+    }
+}
+
+static void report(void)
+{
+    struct bt_mesh_net_pdu_stats pdu;
+    struct bt_mesh_seg_tx_stats tx;
+    struct bt_mesh_seg_rx_stats rx;
+    struct host_radio_stats radio;
+    u64 cpu_ns = host_cpu_ns();
+
+    bt_mesh_net_pdu_stats_get(&pdu);
+    bt_mesh_seg_tx_stats_get(&tx);
+    bt_mesh_seg_rx_stats_get(&rx);
+    host_radio_stats_get(&radio);
+
+    printf("node %u", opt.radio.node);
+
+    if (test_expected()) {
+        printf(" rx %u/%u", test_rx.msgs, opt.count);
+        if (test_rx.msgs) {
+            printf(" latency %u/%u/%u ms", test_rx.latency_min,
+                   test_rx.latency_ms / test_rx.msgs, test_rx.latency_max);
+        }
+    } else if (opt.radio.node == opt.origin) {
+        printf(" tx %u/%u", test_sent, opt.count);
+    }
+
+    printf(" net sent %u rcvd %u relayed %u relay_drop %u",
+           pdu.sent, pdu.received, pdu.relayed, pdu.relay_dropped);
+
+    if (tx.sdu_acked || tx.sdu_failed) {
+        printf(" seg_tx %u/%u %u B/s", tx.sdu_acked, tx.sdu_acked + tx.sdu_failed,
+               tx.sdu_ms ? (u32)((u64)tx.sdu_bytes * 1000 / tx.sdu_ms) : 0);
+    }
+
+    if (rx.sdu_complete || rx.incomplete) {
+        printf(" seg_rx %u/%u %u B/s", rx.sdu_complete,
+               rx.sdu_complete + rx.incomplete,
+               rx.sdu_ms ? (u32)((u64)rx.sdu_bytes * 1000 / rx.sdu_ms) : 0);
+    }
+
+    printf(" adv %u heard %u lost %u missed %u", radio.adv_events,
+           radio.frames_rx, radio.frames_lost, radio.frames_missed);
+
+    printf(" cpu %llu ns/pdu\n",
+           (pdu.sent + pdu.received) ?
+           (unsigned long long)(cpu_ns / (pdu.sent + pdu.received)) : 0ULL);
+
+    fflush(stdout);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n node       this node, 0 .. nodes - 1 (0)\n"
+            "  -N nodes      node processes on the radio (1)\n"
+            "  -p port       UDP port of node 0 (47000)\n"
+            "  -r range      hops a frame reaches on the line, 0: all (1)\n"
+            "  -l loss       percent of frames each receiver drops (0)\n"
+            "  -d delay      ms from advertising event to report (0)\n"
+            "  -t duration   ms the node runs (10000)\n"
+            "  -w warmup     ms before the first message (3000)\n"
+            "  -o origin     node that sends (0)\n"
+            "  -a dst        destination address, group 0xc000 by default\n"
+            "  -c count      messages the origin sends (50)\n"
+            "  -i period     ms between messages (200)\n"
+            "  -s size       access payload bytes, 8 .. %u (8)\n"
+            "  -T ttl        TTL of the messages (7)\n"
+            "  -x xmit       network and relay transmissions (2)\n"
+            "  -f file       keep the VM items in this file\n"
+            "  -S seed       random seed (node)\n"
+            "  -b bench      run a micro-benchmark and exit: crypto, access\n",
+            name, TEST_PAYLOAD_MAX);
+}
+
+static int parse_opt(int argc, char **argv)
+{
+    bool seeded = false;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:N:p:r:l:d:t:w:o:a:c:i:s:T:x:f:S:b:h")) != -1) {
+        u32 val = optarg ? strtoul(optarg, NULL, 0) : 0;
+
+        switch (c) {
+        case 'n':
+            opt.radio.node = val;
+            break;
+        case 'N':
+            opt.radio.nodes = val;
+            break;
+        case 'p':
+            opt.radio.port = val;
+            break;
+        case 'r':
+            opt.radio.range = val;
+            break;
+        case 'l':
+            opt.radio.loss = min(val, 100);
+            break;
+        case 'd':
+            opt.radio.delay = val;
+            break;
+        case 't':
+            opt.duration = val;
+            break;
+        case 'w':
+            opt.warmup = val;
+            break;
+        case 'o':
+            opt.origin = val;
+            break;
+        case 'a':
+            opt.dst = val;
+            break;
+        case 'c':
+            opt.count = min(val, TEST_MSG_MAX);
+            break;
+        case 'i':
+            opt.period = max(val, 1);
+            break;
+        case 's':
+            opt.size = val;
+            break;
+        case 'T':
+            opt.ttl = val;
+            break;
+        case 'x':
+            opt.xmit = val;
+            break;
+        case 'f':
+            opt.vm_path = optarg;
+            break;
+        case 'S':
+            opt.seed = val;
+            seeded = true;
+            break;
+        case 'b':
+            opt.micro = optarg;
+            break;
+        default:
+            return -EINVAL;
+        }
+    }
+
+    if (!opt.radio.nodes || opt.radio.node >= opt.radio.nodes ||
+        opt.size < TEST_HDR_LEN || opt.size > TEST_PAYLOAD_MAX ||
+        opt.xmit < 1 || opt.xmit > 8 ||
+        !(BT_MESH_ADDR_IS_UNICAST(opt.dst) || opt.dst == TEST_GROUP_ADDR)) {
+        return -EINVAL;
+    }
+
+    /* Transmit count is stored minus one */
+    opt.xmit--;
+
+    if (!seeded) {
+        opt.seed = opt.radio.node + 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool realtime;
+    u32 start;
+
+    if (parse_opt(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    srand(opt.seed);
+    srandom(opt.seed);
+
+    if (opt.micro) {
+        return host_micro_run(opt.micro) ? 1 : 0;
+    }
+
+    realtime = opt.radio.nodes > 1;
+    if (realtime) {
+        host_clock_start(wall_ms());
+    }
+
+    start = k_uptime_get_32();
+
+    if (opt.vm_path && host_vm_open(opt.vm_path)) {
+        return 1;
+    }
+
+    if (host_radio_open(&opt.radio) || mesh_start()) {
+        return 1;
+    }
+
+    sys_timeout_add(NULL, test_start, opt.warmup);
+
+    if (realtime) {
+        run_realtime(start + opt.duration);
+    } else {
+        run_simulated(start + opt.duration);
+    }
+
+    report();
+
+    host_radio_close();
+    host_vm_close();
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+/* System library calls the stack expects from the firmware image */
+
+#include <stdarg.h>
+#include "host.h"
+
+static u8 irq_lock_cnt;
+
+/* One thread, nothing to mask. The count only catches unbalanced use. */
+void local_irq_disable()
+{
+    irq_lock_cnt++;
+}
+
+void local_irq_enable()
+{
+    if (!irq_lock_cnt) {
+        fprintf(stderr, "local_irq_enable() without local_irq_disable()\n");
+        abort();
+    }
+
+    irq_lock_cnt--;
+}
+
+void log_print(int level, const char *tag, const char *format, ...)
+{
+    va_list args;
+
+    fprintf(stderr, "%8u ", k_uptime_get_32());
+
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+void printf_buf(u8 *buf, u32 len)
+{
+    u32 i;
+
+    for (i = 0; i < len; i++) {
+        fprintf(stderr, "%02x%c", buf[i], (i % 16 == 15 || i + 1 == len) ? '\n' : ' ');
+    }
+}
+
+void reverse_bytes(const u8 *src, u8 *dst, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        dst[len - 1 - i] = src[i];
+    }
+}
@@ -0,0 +1,316 @@
+/* Advertising and scanning over UDP on the loopback interface, standing
+ * in for the ll_hci_* controller calls of adv_core.c and scan_core.c.
+ * Node n owns port + n. Every advertising event goes to the nodes in
+ * range, which drop a share of the frames and report the rest to
+ * handle_scan_callback() after a fixed delay, if their scanner is on.
+ */
+
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "host.h"
+#include "system/timer.h"
+#include "ble/hci_ll.h"
+
+#define LOG_TAG             "[MESH-host_radio]"
+#define LOG_WARN_ENABLE
+#define LOG_ERROR_ENABLE
+#include "mesh_log.h"
+
+/* Each advertising event is followed by a random 0 ~ 10ms advDelay */
+#define ADV_DELAY_MAX_MS        10
+#define ADV_DATA_MAX            31
+#define RX_QUEUE_SIZE           64
+#define RSSI_BASE               (-40)
+#define RSSI_PER_HOP            6
+
+struct radio_frame {
+    u16 src;
+    u8  adv_type;
+    u8  len;
+    u8  data[ADV_DATA_MAX];
+} __packed;
+
+struct rx_frame {
+    u32 at;
+    struct radio_frame frame;
+};
+
+extern void handle_scan_callback(uint8_t *packet, uint16_t size);
+
+static struct host_radio_param radio;
+static struct host_radio_stats radio_stats;
+static int radio_fd = -1;
+
+static struct radio_frame adv_frame;
+static u16 adv_interval_ms;
+static bool adv_on;
+static u16 adv_timer;
+
+static bool scan_on;
+static u16 scan_interval_ms;
+static u16 scan_window_ms;
+
+/* Frames heard but not reported yet, in order of arrival */
+static struct rx_frame rx_queue[RX_QUEUE_SIZE];
+static u8 rx_head;
+static u8 rx_tail;
+static u16 rx_timer;
+
+static u16 unit_to_ms(u16 unit)
+{
+    return max(1, unit * 5 / 8);
+}
+
+static bool in_range(u16 node)
+{
+    u16 hops = node > radio.node ? node - radio.node : radio.node - node;
+
+    return node != radio.node && (!radio.range || hops <= radio.range);
+}
+
+static void radio_send(const struct radio_frame *frame)
+{
+    struct sockaddr_in to = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    u16 node;
+
+    for (node = 0; node < radio.nodes; node++) {
+        if (!in_range(node)) {
+            continue;
+        }
+
+        to.sin_port = htons(radio.port + node);
+        sendto(radio_fd, frame, offsetof(struct radio_frame, data) + frame->len,
+               0, (struct sockaddr *)&to, sizeof(to));
+    }
+}
+
+static void adv_event(void *priv)
+{
+    adv_timer = 0;
+
+    if (!adv_on) {
+        return;
+    }
+
+    radio_stats.adv_events++;
+
+    if (radio_fd >= 0) {
+        radio_send(&adv_frame);
+    }
+
+    adv_timer = sys_timeout_add(NULL, adv_event,
+                                adv_interval_ms + rand() % (ADV_DELAY_MAX_MS + 1));
+}
+
+void ll_hci_adv_set_params(uint16_t adv_int_min, uint16_t adv_int_max, uint8_t adv_type,
+                           uint8_t direct_addr_type, uint8_t *direct_addr,
+                           uint8_t channel_map, uint8_t filter_policy)
+{
+    adv_interval_ms = unit_to_ms(adv_int_min);
+    adv_frame.adv_type = adv_type;
+}
+
+void ll_hci_adv_set_data(uint8_t advertising_data_length, uint8_t *advertising_data)
+{
+    adv_frame.len = min(advertising_data_length, ADV_DATA_MAX);
+    memcpy(adv_frame.data, advertising_data, adv_frame.len);
+}
+
+void ll_hci_adv_scan_response_set_data(uint8_t scan_response_data_length,
+                                       uint8_t *scan_response_data)
+{
+}
+
+int ll_hci_adv_enable(bool enable)
+{
+    if (enable == adv_on) {
+        return 0;
+    }
+
+    adv_on = enable;
+
+    if (adv_on) {
+        /* The first event goes out as soon as the caller returns */
+        adv_timer = sys_timeout_add(NULL, adv_event, 0);
+    } else if (adv_timer) {
+        sys_timeout_del(adv_timer);
+        adv_timer = 0;
+    }
+
+    return 0;
+}
+
+void ll_hci_scan_set_params(uint8_t scan_type, uint16_t scan_interval, uint16_t scan_window)
+{
+    scan_interval_ms = unit_to_ms(scan_interval);
+    scan_window_ms = unit_to_ms(scan_window);
+}
+
+int ll_hci_scan_enable(bool enable)
+{
+    scan_on = enable;
+
+    return 0;
+}
+
+/* Scan windows start on multiples of the interval */
+static bool scan_hears(u32 now)
+{
+    return scan_on && (!scan_interval_ms || now % scan_interval_ms < scan_window_ms);
+}
+
+static void rx_report(const struct radio_frame *frame)
+{
+    u8 packet[12 + ADV_DATA_MAX] = { 0 };
+    u16 hops = frame->src > radio.node ? frame->src - radio.node :
+               radio.node - frame->src;
+
+    packet[2] = frame->adv_type;
+    packet[3] = 0;
+    /* Address in controller byte order, node number at the end */
+    packet[4] = frame->src & 0xff;
+    packet[5] = frame->src >> 8;
+    packet[9] = 0xc0;
+    packet[10] = (u8)(RSSI_BASE - RSSI_PER_HOP * min(hops, 8));
+    packet[11] = frame->len;
+    memcpy(&packet[12], frame->data, frame->len);
+
+    radio_stats.reports++;
+
+    handle_scan_callback(packet, 12 + frame->len);
+}
+
+static void rx_deliver(void *priv)
+{
+    u32 now = sys_timer_get_ms();
+
+    rx_timer = 0;
+
+    while (rx_tail != rx_head) {
+        struct rx_frame *rx = &rx_queue[rx_tail % RX_QUEUE_SIZE];
+
+        if ((s32)(rx->at - now) > 0) {
+            rx_timer = sys_timeout_add(NULL, rx_deliver, rx->at - now);
+            return;
+        }
+
+        if (scan_hears(now)) {
+            rx_report(&rx->frame);
+        } else {
+            radio_stats.frames_missed++;
+        }
+
+        rx_tail++;
+    }
+}
+
+int host_radio_open(const struct host_radio_param *param)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    radio = *param;
+    adv_frame.src = radio.node;
+
+    if (radio.nodes < 2) {
+        return 0;
+    }
+
+    radio_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (radio_fd < 0) {
+        BT_ERR("No UDP socket");
+        return -EIO;
+    }
+
+    addr.sin_port = htons(radio.port + radio.node);
+    if (bind(radio_fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        BT_ERR("Port %u is taken", radio.port + radio.node);
+        close(radio_fd);
+        radio_fd = -1;
+        return -EIO;
+    }
+
+    return 0;
+}
+
+void host_radio_close(void)
+{
+    if (radio_fd >= 0) {
+        close(radio_fd);
+        radio_fd = -1;
+    }
+}
+
+void host_radio_wait(u32 timeout_ms)
+{
+    struct pollfd pfd = {
+        .fd = radio_fd,
+        .events = POLLIN,
+    };
+
+    if (radio_fd < 0) {
+        if (timeout_ms) {
+            usleep(timeout_ms * USEC_PER_MSEC);
+        }
+        return;
+    }
+
+    poll(&pfd, 1, timeout_ms);
+}
+
+void host_radio_rx(void)
+{
+    struct radio_frame frame;
+    ssize_t len;
+
+    if (radio_fd < 0) {
+        return;
+    }
+
+    while ((len = recv(radio_fd, &frame, sizeof(frame), MSG_DONTWAIT)) > 0) {
+        struct rx_frame *rx;
+
+        if (len < offsetof(struct radio_frame, data) ||
+            len != offsetof(struct radio_frame, data) + frame.len) {
+            continue;
+        }
+
+        radio_stats.frames_rx++;
+
+        if (rand() % 100 < radio.loss) {
+            radio_stats.frames_lost++;
+            continue;
+        }
+
+        if ((u8)(rx_head - rx_tail) == RX_QUEUE_SIZE) {
+            radio_stats.frames_missed++;
+            continue;
+        }
+
+        rx = &rx_queue[rx_head++ % RX_QUEUE_SIZE];
+        rx->at = sys_timer_get_ms() + radio.delay;
+        rx->frame = frame;
+    }
+
+    if (rx_tail != rx_head && !rx_timer) {
+        rx_timer = sys_timeout_add(NULL, rx_deliver, radio.delay);
+    }
+}
+
+void host_radio_stats_get(struct host_radio_stats *stats)
+{
+    *stats = radio_stats;
+}
+
+void host_radio_stats_reset(void)
+{
+    (void)memset(&radio_stats, 0, sizeof(radio_stats));
+}
@@ -0,0 +1,235 @@
+/* Discrete-event stand-in for the system and usr timers. Time only moves
+ * when the main loop sets the clock, either straight to the next timer
+ * (simulated time) or to the wall clock (several node processes).
+ */
+
+#include <time.h>
+#include "host.h"
+#include "system/timer.h"
+
+#define LOG_TAG             "[MESH-host_timer]"
+#define LOG_WARN_ENABLE
+#define LOG_ERROR_ENABLE
+#include "mesh_log.h"
+
+#define HOST_TIMER_COUNT    64
+
+struct host_timer {
+    void *priv;
+    void (*func)(void *priv);
+    u32 period;             /* 0 for a timeout */
+    u32 at;
+    u32 seq;                /* Arming order, breaks ties on at */
+    u8  used;
+};
+
+static struct host_timer timers[HOST_TIMER_COUNT];
+static u32 now_ms;
+static u32 arm_seq;
+static u64 cpu_ns;
+
+static u64 thread_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return (u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static struct host_timer *timer_get(u16 id)
+{
+    if (!id || id > HOST_TIMER_COUNT || !timers[id - 1].used) {
+        return NULL;
+    }
+
+    return &timers[id - 1];
+}
+
+static u16 timer_add(void *priv, void (*func)(void *priv), u32 msec,
+                     u32 period)
+{
+    int i;
+
+    for (i = 0; i < HOST_TIMER_COUNT; i++) {
+        if (!timers[i].used) {
+            timers[i].priv = priv;
+            timers[i].func = func;
+            timers[i].period = period;
+            timers[i].at = now_ms + msec;
+            timers[i].seq = arm_seq++;
+            timers[i].used = 1;
+
+            return i + 1;
+        }
+    }
+
+    BT_ERR("Out of timers");
+
+    return 0;
+}
+
+static int timer_modify(u16 id, u32 msec)
+{
+    struct host_timer *t = timer_get(id);
+
+    if (!t) {
+        return -EINVAL;
+    }
+
+    if (t->period) {
+        t->period = msec;
+    }
+
+    t->at = now_ms + msec;
+    t->seq = arm_seq++;
+
+    return 0;
+}
+
+static void timer_del(u16 id)
+{
+    struct host_timer *t = timer_get(id);
+
+    if (t) {
+        t->used = 0;
+    }
+}
+
+u16 sys_timer_add(void *priv, void (*func)(void *priv), u32 msec)
+{
+    return timer_add(priv, func, msec, msec ? msec : 1);
+}
+
+void sys_timer_del(u16 id)
+{
+    timer_del(id);
+}
+
+u16 sys_timeout_add(void *priv, void (*func)(void *priv), u32 msec)
+{
+    return timer_add(priv, func, msec, 0);
+}
+
+void sys_timeout_del(u16 id)
+{
+    timer_del(id);
+}
+
+int sys_timer_modify(u16 id, u32 msec)
+{
+    return timer_modify(id, msec);
+}
+
+u16 usr_timer_add(void *priv, void (*func)(void *priv), u32 msec, u8 priority)
+{
+    return timer_add(priv, func, msec, msec ? msec : 1);
+}
+
+u16 usr_timeout_add(void *priv, void (*func)(void *priv), u32 msec, u8 priority)
+{
+    return timer_add(priv, func, msec, 0);
+}
+
+int usr_timer_modify(u16 id, u32 msec)
+{
+    return timer_modify(id, msec);
+}
+
+int usr_timeout_modify(u16 id, u32 msec)
+{
+    return timer_modify(id, msec);
+}
+
+void usr_timer_del(u16 id)
+{
+    timer_del(id);
+}
+
+void usr_timeout_del(u16 id)
+{
+    timer_del(id);
+}
+
+u32 sys_timer_get_ms(void)
+{
+    return now_ms;
+}
+
+static struct host_timer *timer_first(void)
+{
+    struct host_timer *first = NULL;
+    int i;
+
+    for (i = 0; i < HOST_TIMER_COUNT; i++) {
+        struct host_timer *t = &timers[i];
+
+        if (!t->used) {
+            continue;
+        }
+
+        if (!first || (s32)(t->at - first->at) < 0 ||
+            (t->at == first->at && (s32)(t->seq - first->seq) < 0)) {
+            first = t;
+        }
+    }
+
+    return first;
+}
+
+u32 host_timer_next(void)
+{
+    struct host_timer *t = timer_first();
+
+    if (!t) {
+        return HOST_TIMER_NONE;
+    }
+
+    /* Overdue timers run now */
+    return (s32)(t->at - now_ms) < 0 ? now_ms : t->at;
+}
+
+void host_timer_run(void)
+{
+    struct host_timer *t;
+
+    while ((t = timer_first()) && (s32)(t->at - now_ms) <= 0) {
+        void (*func)(void *priv) = t->func;
+        void *priv = t->priv;
+        u64 start;
+
+        /* Re-armed before the callback, which may delete or modify it */
+        if (t->period) {
+            t->at = now_ms + t->period;
+            t->seq = arm_seq++;
+        } else {
+            t->used = 0;
+        }
+
+        start = thread_ns();
+        func(priv);
+        cpu_ns += thread_ns() - start;
+    }
+}
+
+void host_clock_start(u32 ms)
+{
+    now_ms = ms;
+}
+
+void host_clock_set(u32 ms)
+{
+    if ((s32)(ms - now_ms) > 0) {
+        now_ms = ms;
+    }
+}
+
+u64 host_cpu_ns(void)
+{
+    return cpu_ns;
+}
+
+void host_cpu_ns_reset(void)
+{
+    cpu_ns = 0;
+}
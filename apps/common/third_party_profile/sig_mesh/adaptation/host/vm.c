@@ -0,0 +1,132 @@
+/* VM items kept in a file, one fixed size slot per index, so settings
+ * survive a restart of the node process.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "host.h"
+#include "vm.h"
+#include "asm/crc16.h"
+
+#define LOG_TAG             "[MESH-host_vm]"
+#define LOG_WARN_ENABLE
+#define LOG_ERROR_ENABLE
+#include "mesh_log.h"
+
+#define VM_ITEM_COUNT       256
+/* The largest store log page */
+#define VM_ITEM_SIZE        4096
+
+struct vm_item {
+    u16 len;
+    u8  data[VM_ITEM_SIZE];
+};
+
+static struct vm_item items[VM_ITEM_COUNT];
+static int vm_fd = -1;
+
+int host_vm_open(const char *path)
+{
+    ssize_t ret;
+
+    vm_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (vm_fd < 0) {
+        BT_ERR("Unable to open %s", path);
+        return -EIO;
+    }
+
+    ret = pread(vm_fd, items, sizeof(items), 0);
+    if (ret != sizeof(items)) {
+        /* New or truncated file, start out empty */
+        memset(items, 0, sizeof(items));
+        if (pwrite(vm_fd, items, sizeof(items), 0) != sizeof(items)) {
+            BT_ERR("Unable to write %s", path);
+            return -EIO;
+        }
+    }
+
+    return 0;
+}
+
+void host_vm_close(void)
+{
+    if (vm_fd >= 0) {
+        close(vm_fd);
+        vm_fd = -1;
+    }
+}
+
+s32 vm_open(u16 index)
+{
+    return index;
+}
+
+s32 vm_read(vm_hdl hdl, u8 *data_buf, u16 len)
+{
+    struct vm_item *item;
+
+    if (hdl >= VM_ITEM_COUNT) {
+        return VM_INDEX_ERR;
+    }
+
+    item = &items[hdl];
+    if (!item->len) {
+        return VM_READ_NO_INDEX;
+    }
+
+    len = min(len, item->len);
+    memcpy(data_buf, item->data, len);
+
+    return len;
+}
+
+s32 vm_write(vm_hdl hdl, u8 *data_buf, u16 len)
+{
+    struct vm_item *item;
+
+    if (hdl >= VM_ITEM_COUNT) {
+        return VM_INDEX_ERR;
+    }
+
+    if (!len || len > sizeof(item->data)) {
+        return VM_DATA_LEN_ERR;
+    }
+
+    item = &items[hdl];
+    item->len = len;
+    memcpy(item->data, data_buf, len);
+
+    if (vm_fd >= 0 &&
+        pwrite(vm_fd, item, sizeof(*item), hdl * sizeof(*item)) !=
+        sizeof(*item)) {
+        BT_ERR("VM item %u not written", hdl);
+        return VM_WRITE_OVERFLOW;
+    }
+
+    return len;
+}
+
+void vm_check_all(u8 level) {}
+
+/* CRC-16/CCITT, the records only have to agree with themselves here */
+u16 CRC16_with_initval(const void *ptr, u32 len, u16 i_val)
+{
+    const u8 *p = ptr;
+    u16 crc = i_val;
+    int i;
+
+    while (len--) {
+        crc ^= (u16)*p++ << 8;
+
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+u16 CRC16(const void *ptr, u32 len)
+{
+    return CRC16_with_initval(ptr, len, 0);
+}
@@ -35,10 +35,37 @@ void k_work_submit(struct k_work *work) {}
 
 void k_delayed_work_init(struct k_delayed_work *timer, void *callback) {}
 
+void k_work_q_stats_get(struct k_work_q_stats *stats) {}
+
+void k_work_q_stats_reset(void) {}
+
 #else
 
 #define WORK_CALLBACK(_func, _param)   ((void (*)(struct k_work *))_func)(_param)
 
+enum {
+    WORK_IDLE,
+    WORK_TIMER,             /* On the timer list, waiting for end_time */
+    WORK_QUEUED,            /* On the run queue */
+};
+
+/* All delayed work sits on one list sorted by end_time, and a single
+ * system timeout is armed for the head. Expired and submitted work moves
+ * to a FIFO run queue that the same timeout drains, so callbacks never
+ * run inside k_work_submit() or within another callback.
+ */
+static struct k_work *timer_list;
+static struct k_work *run_head;
+static struct k_work *run_tail;
+static u8_t run_depth;
+
+static u16 work_timeout;
+static u32 work_timeout_at;
+
+static struct k_work_q_stats work_q_stats;
+
+static void work_q_handler(void *priv);
+
 u32 k_uptime_get(void)
 {
     return sys_timer_get_ms();
@@ -49,63 +76,307 @@ u32 k_uptime_get_32(void)
     return sys_timer_get_ms();
 }
 
-u32 k_delayed_work_remaining_get(struct k_delayed_work *timer)
+static inline s32 time_left(u32 at, u32 now)
 {
-    return timer->end_time - k_uptime_get_32();
+    return (s32)(at - now);
 }
 
-void k_delayed_work_cancel(struct k_delayed_work *timer)
+static void timer_list_remove(struct k_work *work)
 {
-    BT_INFO("--func=%s", __FUNCTION__);
+    struct k_work **p;
 
-    if (timer->work.systimer) {
-        sys_timeout_del(timer->work.systimer);
-        BT_INFO("timer remove id = %u, 0x%x", timer->work.systimer, timer);
+    for (p = &timer_list; *p; p = &(*p)->next) {
+        if (*p == work) {
+            *p = work->next;
+            break;
+        }
     }
 
-    timer->work.systimer = 0;
+    work->next = NULL;
 }
 
-static void k_delayed_work_cb_entry(struct k_delayed_work *timer)
+static void timer_list_insert(struct k_delayed_work *timer)
 {
-    BT_INFO("--func=%s, 0x%x", __FUNCTION__, timer);
+    struct k_work **p;
+
+    /* Equal deadlines keep submission order */
+    for (p = &timer_list; *p; p = &(*p)->next) {
+        struct k_delayed_work *cur = CONTAINER_OF(*p, struct k_delayed_work,
+                                     work);
 
-    k_delayed_work_cancel(timer);
+        if (time_left(timer->end_time, cur->end_time) < 0) {
+            break;
+        }
+    }
+
+    timer->work.next = *p;
+    *p = &timer->work;
+}
 
-    WORK_CALLBACK(timer->work.callback, &timer->work);
+static void run_queue_remove(struct k_work *work)
+{
+    struct k_work **p;
+    struct k_work *prev = NULL;
+
+    for (p = &run_head; *p; prev = *p, p = &(*p)->next) {
+        if (*p == work) {
+            *p = work->next;
+            if (run_tail == work) {
+                run_tail = prev;
+            }
+            run_depth--;
+            break;
+        }
+    }
+
+    work->next = NULL;
+}
+
+static void run_queue_append(struct k_work *work, u32 due)
+{
+    work->next = NULL;
+    work->state = WORK_QUEUED;
+    work->queued_at = due;
+
+    if (run_tail) {
+        run_tail->next = work;
+    } else {
+        run_head = work;
+    }
+
+    run_tail = work;
+
+    if (++run_depth > work_q_stats.depth_max) {
+        work_q_stats.depth_max = run_depth;
+    }
+}
+
+static void work_unlink(struct k_work *work)
+{
+    if (work->state == WORK_TIMER) {
+        timer_list_remove(work);
+    } else if (work->state == WORK_QUEUED) {
+        run_queue_remove(work);
+    }
+
+    work->state = WORK_IDLE;
+}
+
+/* Called with interrupts locked */
+static void work_q_rearm(void)
+{
+    u32 now = k_uptime_get_32();
+    u32 at;
+
+    if (run_head) {
+        at = now;
+    } else if (timer_list) {
+        at = CONTAINER_OF(timer_list, struct k_delayed_work, work)->end_time;
+    } else {
+        if (work_timeout) {
+            sys_timeout_del(work_timeout);
+            work_timeout = 0;
+        }
+        return;
+    }
+
+    if (time_left(at, now) < 1) {
+        at = now + 1;
+    }
+
+    if (work_timeout) {
+        if (at == work_timeout_at) {
+            return;
+        }
+
+        sys_timeout_del(work_timeout);
+    }
+
+    work_timeout = sys_timeout_add(NULL, work_q_handler, at - now);
+    work_timeout_at = at;
+    work_q_stats.timer_arms++;
+
+    ASSERT(work_timeout);
+}
+
+static void work_q_expire(u32 now)
+{
+    struct k_delayed_work *first = NULL;
+
+    /* Whatever falls due within the slack of the first expiry runs in
+     * the same pass instead of arming the timer once more.
+     */
+    while (timer_list) {
+        struct k_delayed_work *timer = CONTAINER_OF(timer_list,
+                                       struct k_delayed_work, work);
+
+        if (time_left(timer->end_time, now) > 0 &&
+            (!first ||
+             time_left(timer->end_time, first->end_time) >
+             CONFIG_BT_MESH_WORK_SLACK_MS)) {
+            break;
+        }
+
+        if (!first) {
+            first = timer;
+        } else if (time_left(timer->end_time, now) > 0) {
+            work_q_stats.coalesced++;
+        }
+
+        timer_list = timer->work.next;
+        run_queue_append(&timer->work, timer->end_time);
+    }
+}
+
+static void work_q_handler(void *priv)
+{
+    struct k_work *work, *last;
+    void *callback;
+    u32 now;
+    s32 late;
+    u8_t n;
+    int key;
+
+    key = irq_lock();
+
+    work_timeout = 0;
+    now = k_uptime_get_32();
+    work_q_expire(now);
+
+    /* Work submitted by the callbacks below waits for the next pass */
+    last = run_tail;
+
+    irq_unlock(key);
+
+    for (n = 0; n < CONFIG_BT_MESH_WORK_BATCH; n++) {
+        key = irq_lock();
+
+        work = run_head;
+        if (!work) {
+            irq_unlock(key);
+            break;
+        }
+
+        run_head = work->next;
+        if (!run_head) {
+            run_tail = NULL;
+        }
+        run_depth--;
+
+        work->next = NULL;
+        work->state = WORK_IDLE;
+        callback = work->callback;
+
+        late = time_left(k_uptime_get_32(), work->queued_at);
+        if (late > 0) {
+            work_q_stats.latency_ms += late;
+            if (late > work_q_stats.latency_max) {
+                work_q_stats.latency_max = min(late, 0xffff);
+            }
+        }
+
+        work_q_stats.ran++;
+
+        irq_unlock(key);
+
+        WORK_CALLBACK(callback, work);
+
+        if (work == last) {
+            break;
+        }
+    }
+
+    key = irq_lock();
+    work_q_rearm();
+    irq_unlock(key);
+}
+
+u32 k_delayed_work_remaining_get(struct k_delayed_work *timer)
+{
+    s32 remaining;
+
+    if (timer->work.state != WORK_TIMER) {
+        return 0;
+    }
+
+    remaining = timer->end_time - k_uptime_get_32();
+
+    return (remaining > 0) ? remaining : 0;
+}
+
+void k_delayed_work_cancel(struct k_delayed_work *timer)
+{
+    int key;
+
+    BT_INFO("--func=%s", __FUNCTION__);
+
+    key = irq_lock();
+
+    if (timer->work.state != WORK_IDLE) {
+        work_unlink(&timer->work);
+        work_q_rearm();
+    }
+
+    irq_unlock(key);
 }
 
 void k_delayed_work_submit(struct k_delayed_work *timer, u32 timeout)
 {
+    int key;
+
     BT_INFO("--func=%s", __FUNCTION__);
     BT_INFO("timeout= %d ms", timeout);
 
-    /* k_delayed_work_cancel(timer); */
+    key = irq_lock();
 
-    if (0 == timer->work.systimer) {
-        /* timer->work.systimer = sys_timer_register(timeout, k_delayed_work_cb_entry); */
-        /* sys_timer_set_context(timer->work.systimer, timer); */
-        timer->work.systimer = sys_timer_add(timer, k_delayed_work_cb_entry, timeout);
-        BT_INFO("reg new id = %u, 0x%x", timer->work.systimer, timer);
-    } else {
-        sys_timer_modify(timer->work.systimer, timeout);
-        BT_INFO("only change");
-    }
+    work_unlink(&timer->work);
 
     timer->end_time = k_uptime_get_32() + timeout;
 
-    ASSERT(timer->work.systimer);
+    if (timeout) {
+        timer->work.state = WORK_TIMER;
+        timer_list_insert(timer);
+    } else {
+        run_queue_append(&timer->work, timer->end_time);
+    }
 
+    work_q_stats.submitted++;
+    work_q_rearm();
+
+    irq_unlock(key);
 }
 
 void k_work_submit(struct k_work *work)
 {
-    WORK_CALLBACK(work->callback, work);
+    int key;
+
+    key = irq_lock();
+
+    if (work->state != WORK_QUEUED) {
+        /* Also takes the work of a pending k_delayed_work off its timer */
+        work_unlink(work);
+        run_queue_append(work, k_uptime_get_32());
+        work_q_stats.submitted++;
+        work_q_rearm();
+    }
+
+    irq_unlock(key);
 }
 
 void k_delayed_work_init(struct k_delayed_work *timer, void *callback)
 {
+    /* Re-initialising pending work only swaps its handler */
     timer->work.callback = callback;
 }
 
+void k_work_q_stats_get(struct k_work_q_stats *stats)
+{
+    *stats = work_q_stats;
+}
+
+void k_work_q_stats_reset(void)
+{
+    (void)memset(&work_q_stats, 0, sizeof(work_q_stats));
+}
+
 #endif /* ADAPTATION_COMPILE_DEBUG */
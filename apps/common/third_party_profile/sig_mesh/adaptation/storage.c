@@ -1,5 +1,7 @@
 #include "adaptation.h"
 #include "vm.h"
+#include "asm/crc16.h"
+#include "system/malloc.h"
 
 #define LOG_TAG                 "[MESH-storage]"
 /* #define LOG_INFO_ENABLE */
@@ -16,13 +18,23 @@ extern s32 vm_open(u16 index);
 extern s32 vm_write(vm_hdl hdl, u8 *data_buf, u16 len);
 extern s32 vm_read(vm_hdl hdl, u8 *data_buf, u16 len);
 
-void node_info_store(int index, void *buf, u16 len)
+static u32 write_count;
+
+u32 node_info_write_count(void)
+{
+    return write_count;
+}
+
+#if !CONFIG_BT_MESH_STORE_LOG
+static void vm_item_store(int index, void *buf, u16 len)
 {
     u32 ret = 0;
     u16 w_len = len + 1;
 
     BT_INFO("--func=%s", __FUNCTION__);
 
+    write_count++;
+
     vm_check_all(0);
 
 #if NODE_INFO_CLEAR_DEBUG_EN
@@ -55,13 +67,9 @@ void node_info_store(int index, void *buf, u16 len)
 #endif /* NODE_INFO_CLEAR_DEBUG_EN */
 }
 
-void node_info_clear(int index, u16 len)
-{
-    BT_INFO("--func=%s", __FUNCTION__);
-    node_info_store(index, NULL, len);
-}
+#endif /* !CONFIG_BT_MESH_STORE_LOG */
 
-bool node_info_load(int index, void *buf, u16 len)
+static bool vm_item_load(int index, void *buf, u16 len)
 {
     u32 ret = 0;
     u16 r_len = len + 1;
@@ -104,3 +112,525 @@ bool node_info_load(int index, void *buf, u16 len)
 #endif /* NODE_INFO_CLEAR_DEBUG_EN */
 }
 
+
+#if CONFIG_BT_MESH_STORE_LOG
+
+/* Records are appended to a small ring of VM items ("pages"):
+ *
+ *   page:   | magic | rfu | seq | rec | rec | ... | 0xff ... |
+ *   rec:    | id16 | len | crc16 | data[len] |
+ *
+ * len == 0 is a tombstone left by node_info_clear(). The newest record of
+ * an id wins: a higher page seq, or a later offset within the same page.
+ * Only the active page is rewritten, and only once per store pass
+ * (node_info_commit()), so one flash write carries every record changed
+ * in that pass. A page whose records are all superseded is reused as is;
+ * when no such page is left the oldest page's live records are moved to
+ * the new active page first.
+ */
+#define STORE_PAGES         CONFIG_BT_MESH_STORE_LOG_PAGES
+#define STORE_PAGE_SIZE     CONFIG_BT_MESH_STORE_LOG_PAGE_SIZE
+#define STORE_ID_MAX        CONFIG_BT_MESH_STORE_LOG_ID_MAX
+/* 0x4d53 pages had 8-bit record ids */
+#define STORE_PAGE_MAGIC    0x4d54
+#define STORE_PAGE_NONE     0xff
+#define STORE_LOC_NONE      0xffff
+
+#if (STORE_PAGES < 2) || (STORE_PAGES > 15) || (STORE_PAGE_SIZE > 4096)
+#error "CONFIG_BT_MESH_STORE_LOG_PAGES must be 2..15, PAGE_SIZE <= 4096"
+#endif
+
+/* An erased record header reads as id 0xffff, which ends the page scan */
+#if (STORE_ID_MAX < CONFIG_BT_MESH_STORE_LOG_INDEX) || (STORE_ID_MAX >= 0xffff)
+#error "CONFIG_BT_MESH_STORE_LOG_ID_MAX must be STORE_LOG_INDEX..65534"
+#endif
+
+struct store_page_hdr {
+    u16 magic;
+    u16 rfu;
+    u32 seq;
+} __packed;
+
+struct store_rec_hdr {
+    u16 id;
+    u8  len;
+    u16 crc;
+} __packed;
+
+#define REC_SIZE(len)       (sizeof(struct store_rec_hdr) + (len))
+#define LOC(page, off)      (((page) << 12) | (off))
+#define LOC_PAGE(loc)       ((loc) >> 12)
+#define LOC_OFF(loc)        ((loc) & 0xfff)
+
+/* RAM index, rebuilt from the pages at boot */
+static u16 rec_loc[STORE_ID_MAX];
+static u8 rec_len[STORE_ID_MAX];
+
+static struct {
+    u32 seq;        /* 0: never written */
+    u16 used;       /* End of the last valid record */
+    u16 live;       /* Bytes of records still referenced by rec_loc */
+} pages[STORE_PAGES];
+
+static u8 active_buf[STORE_PAGE_SIZE];
+static u8 cache_buf[STORE_PAGE_SIZE];
+/* Every page, held only between node_info_load_begin() and _end() */
+static u8 *load_buf;
+static u8 active_page;
+static u8 cache_page = STORE_PAGE_NONE;
+static bool active_dirty;
+static bool store_ready;
+
+static u16 rec_crc(const struct store_rec_hdr *hdr, const u8 *data)
+{
+    return CRC16_with_initval(data, hdr->len, CRC16(hdr, offsetof(struct store_rec_hdr, crc)));
+}
+
+static bool page_read(u8 page, u8 *buf)
+{
+    vm_hdl hdl = vm_open(CONFIG_BT_MESH_STORE_LOG_INDEX + page);
+
+    return (vm_read(hdl, buf, STORE_PAGE_SIZE) == STORE_PAGE_SIZE);
+}
+
+static void page_write(u8 page, u8 *buf)
+{
+    vm_hdl hdl;
+    s32 ret;
+
+    write_count++;
+
+    vm_check_all(0);
+
+    hdl = vm_open(CONFIG_BT_MESH_STORE_LOG_INDEX + page);
+    ret = vm_write(hdl, buf, STORE_PAGE_SIZE);
+    if (ret != STORE_PAGE_SIZE) {
+        BT_ERR("vm_write err");
+        BT_ERR("ret = %d", ret);
+    }
+}
+
+static void store_commit(void)
+{
+    if (!active_dirty) {
+        return;
+    }
+
+    active_dirty = false;
+
+    page_write(active_page, active_buf);
+}
+
+static const u8 *page_get(u8 page)
+{
+    if (page == active_page) {
+        return active_buf;
+    }
+
+    if (load_buf) {
+        return &load_buf[page * STORE_PAGE_SIZE];
+    }
+
+    if (page != cache_page) {
+        if (!page_read(page, cache_buf)) {
+            cache_page = STORE_PAGE_NONE;
+            return NULL;
+        }
+        cache_page = page;
+    }
+
+    return cache_buf;
+}
+
+static void rec_drop(u16 id)
+{
+    if (rec_loc[id] != STORE_LOC_NONE) {
+        pages[LOC_PAGE(rec_loc[id])].live -= REC_SIZE(rec_len[id]);
+    }
+}
+
+static void rec_index(u8 page, u16 off, const struct store_rec_hdr *hdr)
+{
+    rec_drop(hdr->id);
+
+    rec_loc[hdr->id] = LOC(page, off);
+    rec_len[hdr->id] = hdr->len;
+    pages[page].live += REC_SIZE(hdr->len);
+}
+
+/* Walk one page, stopping at the free tail or at a damaged record */
+static void page_index(u8 page, const u8 *buf)
+{
+    const struct store_rec_hdr *hdr;
+    u16 off = sizeof(struct store_page_hdr);
+    u16 loc;
+
+    while (off + sizeof(*hdr) <= STORE_PAGE_SIZE) {
+        hdr = (const struct store_rec_hdr *)&buf[off];
+
+        if (hdr->id >= STORE_ID_MAX ||
+            off + REC_SIZE(hdr->len) > STORE_PAGE_SIZE ||
+            rec_crc(hdr, (const u8 *)(hdr + 1)) != hdr->crc) {
+            break;
+        }
+
+        loc = rec_loc[hdr->id];
+        if (loc == STORE_LOC_NONE ||
+            pages[LOC_PAGE(loc)].seq <= pages[page].seq) {
+            rec_index(page, off, hdr);
+        }
+
+        off += REC_SIZE(hdr->len);
+    }
+
+    pages[page].used = off;
+}
+
+static void page_init(u8 page, u32 seq)
+{
+    struct store_page_hdr hdr = {
+        .magic = STORE_PAGE_MAGIC,
+        .seq = seq,
+    };
+
+    if (cache_page == page) {
+        cache_page = STORE_PAGE_NONE;
+    }
+
+    if (load_buf) {
+        /* Keep the copy of the page being retired current */
+        memcpy(&load_buf[active_page * STORE_PAGE_SIZE], active_buf,
+               STORE_PAGE_SIZE);
+    }
+
+    active_page = page;
+    memset(active_buf, 0xff, sizeof(active_buf));
+    memcpy(active_buf, &hdr, sizeof(hdr));
+
+    pages[page].seq = seq;
+    pages[page].used = sizeof(hdr);
+    pages[page].live = 0;
+}
+
+static void store_init(void)
+{
+    struct store_page_hdr *hdr;
+    u8 newest = STORE_PAGE_NONE;
+    u8 *buf;
+    u8 i;
+
+    BT_INFO("--func=%s", __FUNCTION__);
+
+    store_ready = true;
+
+    memset(rec_loc, 0xff, sizeof(rec_loc));
+    memset(pages, 0, sizeof(pages));
+
+    for (i = 0; i < STORE_PAGES; i++) {
+        buf = load_buf ? &load_buf[i * STORE_PAGE_SIZE] : cache_buf;
+        hdr = (struct store_page_hdr *)buf;
+
+        if (!page_read(i, buf)) {
+            memset(buf, 0xff, STORE_PAGE_SIZE);
+            continue;
+        }
+
+        if (hdr->magic != STORE_PAGE_MAGIC || !hdr->seq) {
+            continue;
+        }
+
+        pages[i].seq = hdr->seq;
+        page_index(i, buf);
+
+        if (newest == STORE_PAGE_NONE || hdr->seq > pages[newest].seq) {
+            newest = i;
+        }
+    }
+
+    cache_page = STORE_PAGE_NONE;
+
+    if (newest == STORE_PAGE_NONE) {
+        page_init(0, 1);
+        return;
+    }
+
+    active_page = newest;
+    if (load_buf) {
+        memcpy(active_buf, &load_buf[newest * STORE_PAGE_SIZE],
+               STORE_PAGE_SIZE);
+    } else if (!page_read(newest, active_buf)) {
+        BT_ERR("Unable to reload page %u", newest);
+        page_init(newest, pages[newest].seq + 1);
+    }
+}
+
+static int store_append(u16 id, const u8 *data, u8 len)
+{
+    struct store_rec_hdr hdr;
+    u16 off = pages[active_page].used;
+
+    if (off + REC_SIZE(len) > STORE_PAGE_SIZE) {
+        return -ENOSPC;
+    }
+
+    hdr.id = id;
+    hdr.len = len;
+    hdr.crc = rec_crc(&hdr, data);
+
+    memcpy(&active_buf[off], &hdr, sizeof(hdr));
+    memcpy(&active_buf[off + sizeof(hdr)], data, len);
+
+    rec_index(active_page, off, &hdr);
+    pages[active_page].used += REC_SIZE(len);
+    active_dirty = true;
+
+    return 0;
+}
+
+static u8 page_free_find(void)
+{
+    u8 i;
+
+    for (i = 0; i < STORE_PAGES; i++) {
+        if (i != active_page && !pages[i].live) {
+            return i;
+        }
+    }
+
+    return STORE_PAGE_NONE;
+}
+
+static u8 page_oldest_find(void)
+{
+    u8 oldest = STORE_PAGE_NONE;
+    u8 i;
+
+    for (i = 0; i < STORE_PAGES; i++) {
+        if (i == active_page || !pages[i].live) {
+            continue;
+        }
+
+        if (oldest == STORE_PAGE_NONE || pages[i].seq < pages[oldest].seq) {
+            oldest = i;
+        }
+    }
+
+    return oldest;
+}
+
+/* Move the live records of the oldest page into the (fresh) active page,
+ * so that a free page is left for the next roll.
+ */
+static void store_compact(void)
+{
+    const struct store_rec_hdr *hdr;
+    const u8 *buf;
+    u16 off;
+    u8 victim;
+
+    victim = page_oldest_find();
+    if (victim == STORE_PAGE_NONE) {
+        return;
+    }
+
+    buf = page_get(victim);
+    if (!buf) {
+        BT_ERR("Unable to read page %u", victim);
+        return;
+    }
+
+    BT_DBG("Compact page %u, %u live bytes", victim, pages[victim].live);
+
+    for (off = sizeof(struct store_page_hdr); off < pages[victim].used;
+         off += REC_SIZE(hdr->len)) {
+        hdr = (const struct store_rec_hdr *)&buf[off];
+
+        if (rec_loc[hdr->id] != LOC(victim, off)) {
+            continue;
+        }
+
+        if (store_append(hdr->id, (const u8 *)(hdr + 1), hdr->len)) {
+            break;
+        }
+    }
+
+    /* The copies must be on flash before the victim can be reused */
+    store_commit();
+}
+
+static int store_roll(void)
+{
+    u8 next;
+
+    store_commit();
+
+    next = page_free_find();
+    if (next == STORE_PAGE_NONE) {
+        return -ENOSPC;
+    }
+
+    page_init(next, pages[active_page].seq + 1);
+
+    if (page_free_find() == STORE_PAGE_NONE) {
+        store_compact();
+    }
+
+    return 0;
+}
+
+void node_info_store(int index, void *buf, u16 len)
+{
+    const u8 *page;
+    u16 loc;
+    u8 i;
+
+    BT_INFO("--func=%s", __FUNCTION__);
+
+    if (index < 0 || index >= STORE_ID_MAX || len > 0xff) {
+        BT_ERR("Invalid record %d len %u", index, len);
+        return;
+    }
+
+    if (!store_ready) {
+        store_init();
+    }
+
+    if (!buf) {
+        len = 0;
+    }
+
+    /* Rewriting an unchanged record only costs flash */
+    loc = rec_loc[index];
+    if (loc != STORE_LOC_NONE && rec_len[index] == len) {
+        page = page_get(LOC_PAGE(loc));
+        if (page && (!len ||
+                     !memcmp(&page[LOC_OFF(loc) + sizeof(struct store_rec_hdr)],
+                             buf, len))) {
+            return;
+        }
+    }
+
+    for (i = 0; i < STORE_PAGES; i++) {
+        if (!store_append(index, buf, len)) {
+            return;
+        }
+
+        if (store_roll()) {
+            break;
+        }
+    }
+
+    BT_ERR("Store log full, record %d dropped", index);
+}
+
+void node_info_clear(int index, u16 len)
+{
+    BT_INFO("--func=%s", __FUNCTION__);
+    node_info_store(index, NULL, len);
+}
+
+bool node_info_load(int index, void *buf, u16 len)
+{
+    const u8 *page;
+    u16 loc;
+
+    BT_INFO("--func=%s", __FUNCTION__);
+
+    if (index < 0 || index >= STORE_ID_MAX) {
+        return 1;
+    }
+
+    if (!store_ready) {
+        store_init();
+    }
+
+    loc = rec_loc[index];
+    if (loc == STORE_LOC_NONE) {
+        if (index >= CONFIG_BT_MESH_STORE_LOG_INDEX) {
+            return 1;
+        }
+
+        /* Never written since the log was introduced */
+        return vm_item_load(index, buf, len);
+    }
+
+    if (rec_len[index] != len) {
+        if (rec_len[index]) {
+            BT_WARN("Record %d size %u, expected %u", index,
+                    rec_len[index], len);
+        }
+        return 1;
+    }
+
+    page = page_get(LOC_PAGE(loc));
+    if (!page) {
+        return 1;
+    }
+
+    memcpy(buf, &page[LOC_OFF(loc) + sizeof(struct store_rec_hdr)], len);
+
+    return 0;
+}
+
+void node_info_commit(void)
+{
+    store_commit();
+}
+
+/* Restore at boot reads each page once: the index scan fills load_buf and
+ * every node_info_load() until node_info_load_end() is served from it.
+ * Without the memory it falls back to the one-page cache.
+ */
+void node_info_load_begin(void)
+{
+    if (store_ready) {
+        return;
+    }
+
+    load_buf = malloc(STORE_PAGES * STORE_PAGE_SIZE);
+    if (!load_buf) {
+        BT_WARN("No memory for single pass restore");
+    }
+
+    store_init();
+}
+
+void node_info_load_end(void)
+{
+    if (load_buf) {
+        free(load_buf);
+        load_buf = NULL;
+    }
+}
+
+#else /* CONFIG_BT_MESH_STORE_LOG */
+
+void node_info_store(int index, void *buf, u16 len)
+{
+    vm_item_store(index, buf, len);
+}
+
+void node_info_clear(int index, u16 len)
+{
+    BT_INFO("--func=%s", __FUNCTION__);
+    node_info_store(index, NULL, len);
+}
+
+bool node_info_load(int index, void *buf, u16 len)
+{
+    return vm_item_load(index, buf, len);
+}
+
+void node_info_commit(void)
+{
+}
+
+void node_info_load_begin(void)
+{
+}
+
+void node_info_load_end(void)
+{
+}
+
+#endif /* CONFIG_BT_MESH_STORE_LOG */
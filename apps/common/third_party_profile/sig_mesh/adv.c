@@ -107,6 +107,16 @@ struct net_buf *bt_mesh_adv_create(enum bt_mesh_adv_type type, u8_t xmit,
                                         xmit, timeout);
 }
 
+void bt_mesh_adv_buf_stats_get(struct net_buf_pool_stats *stats)
+{
+    net_buf_pool_stats_get(&adv_buf_pool, stats);
+}
+
+void bt_mesh_adv_buf_stats_reset(void)
+{
+    net_buf_pool_stats_reset(&adv_buf_pool);
+}
+
 static void bt_mesh_scan_cb(const bt_addr_le_t *addr, s8_t rssi,
                             u8_t adv_type, struct net_buf_simple *buf)
 {
@@ -6,6 +6,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+struct net_buf;
+struct net_buf_pool;
+
 /* Maximum advertising data payload for a single data type */
 #if NET_BUF_FREE_EN
 struct advertising_data_header {
@@ -31,6 +34,35 @@ enum bt_mesh_adv_type {
     BT_MESH_ADV_URI,
 };
 
+/* Who queued the PDU, lets the bearer scheduler tell relayed and
+ * Friend Queue traffic apart from locally originated messages.
+ */
+enum bt_mesh_adv_origin {
+    BT_MESH_ADV_ORIGIN_LOCAL,
+    BT_MESH_ADV_ORIGIN_RELAY,
+    BT_MESH_ADV_ORIGIN_FRIEND,
+};
+
+/* Bearer scheduler queues, in strict priority order */
+enum bt_mesh_adv_queue {
+    BT_MESH_ADV_QUEUE_LOCAL,
+    BT_MESH_ADV_QUEUE_PROV,
+    BT_MESH_ADV_QUEUE_FRIEND,
+    BT_MESH_ADV_QUEUE_BEACON,
+    BT_MESH_ADV_QUEUE_RELAY,
+
+    BT_MESH_ADV_QUEUE_NUM,
+};
+
+struct bt_mesh_adv_queue_stats {
+    u16_t depth;        /* PDUs currently waiting */
+    u16_t depth_max;    /* Highest depth seen */
+    u32_t sent;         /* PDUs handed to the controller */
+    u32_t dropped;      /* Stale PDUs dropped past their deadline */
+    u32_t wait_total;   /* Sum of queueing delays, unit: ms */
+    u32_t wait_max;     /* Worst queueing delay, unit: ms */
+};
+
 typedef void (*bt_mesh_adv_func_t)(struct net_buf *buf, u16_t duration,
                                    int err, void *user_data);
 
@@ -40,9 +72,13 @@ struct bt_mesh_adv {
 
     u8_t      type: 2,
               busy: 1,
-              delay: 1;
+              delay: 1,
+              origin: 2;
     u8_t      xmit;
 
+    /* Uptime when queued to the bearer, unit: ms */
+    u32_t     queued;
+
     union {
         /* Address, used e.g. for Friend Queue messages */
         u16_t addr;
@@ -70,6 +106,16 @@ void bt_mesh_adv_send(struct net_buf *buf, const struct bt_mesh_send_cb *cb,
 
 void bt_mesh_adv_update(void);
 
+int bt_mesh_adv_queue_stats_get(enum bt_mesh_adv_queue queue,
+                                struct bt_mesh_adv_queue_stats *stats);
+
+void bt_mesh_adv_queue_stats_reset(void);
+
+struct net_buf_pool_stats;
+
+void bt_mesh_adv_buf_stats_get(struct net_buf_pool_stats *stats);
+void bt_mesh_adv_buf_stats_reset(void);
+
 int bt_mesh_scan_enable(void);
 
 int bt_mesh_scan_disable(void);
@@ -25,8 +25,10 @@ typedef signed long long    s64_t;
 // typedef int             sys_timer;
 
 struct k_work {
-    sys_timer   systimer;
+    struct k_work *next;        /* Run queue or timer list link */
     void        *callback;
+    u32         queued_at;
+    u8          state;
 };
 
 struct k_delayed_work {
@@ -0,0 +1,138 @@
+/** @file
+ *  @brief Bluetooth Mesh Configuration Database APIs.
+ */
+
+#ifndef ZEPHYR_INCLUDE_BLUETOOTH_MESH_CDB_H_
+#define ZEPHYR_INCLUDE_BLUETOOTH_MESH_CDB_H_
+
+/**
+ * @brief Bluetooth Mesh Configuration Database
+ * @defgroup bt_mesh_cdb Bluetooth Mesh Configuration Database
+ * @ingroup bt_mesh
+ * @{
+ *
+ * The database a provisioner keeps about the network it builds: the
+ * subnets it hands out and every node it provisioned, with the node's
+ * device key so the Configuration Client can talk to it. It lives in
+ * RAM; applications that need it across reboots persist the nodes
+ * reported through the bt_mesh_prov node_added callback.
+ */
+
+#if CONFIG_BT_MESH_PROVISIONER
+
+/** A node provisioned by this device. An unused entry has addr 0. */
+struct bt_mesh_cdb_node {
+    u8_t  uuid[16];
+    u16_t addr;
+    u16_t net_idx;
+    u8_t  num_elem;
+    u8_t  dev_key[16];
+};
+
+/** A subnet this device provisions nodes into. */
+struct bt_mesh_cdb_subnet {
+    u16_t net_idx;
+
+    bool  kr_flag;
+    u8_t  kr_phase;
+
+    struct {
+        u8_t net_key[16];
+    } keys[2];
+};
+
+struct bt_mesh_cdb {
+    bool  valid;
+    u32_t iv_index;
+    bool  iv_update;
+
+    /* Where the search for a free unicast range starts */
+    u16_t lowest_avail_addr;
+
+    struct bt_mesh_cdb_node nodes[CONFIG_BT_MESH_CDB_NODE_COUNT];
+    struct bt_mesh_cdb_subnet subnets[CONFIG_BT_MESH_CDB_SUBNET_COUNT];
+};
+
+extern struct bt_mesh_cdb bt_mesh_cdb;
+
+/** @brief Create the database with a primary subnet.
+ *
+ *  @param key Network key of the primary subnet.
+ *
+ *  @return 0 on success, -EALREADY if the database already exists.
+ */
+int bt_mesh_cdb_create(const u8_t key[16]);
+
+/** @brief Clear the database. */
+void bt_mesh_cdb_clear(void);
+
+/** @brief Set the IV Index handed to newly provisioned nodes.
+ *
+ *  @param iv_index Current IV Index.
+ *  @param iv_update Whether an IV Update procedure is in progress.
+ */
+void bt_mesh_cdb_iv_update(u32_t iv_index, bool iv_update);
+
+/** @brief Allocate a node.
+ *
+ *  With an address of 0 the lowest free unicast range that fits
+ *  @p num_elem elements is assigned, skipping this device's own
+ *  elements.
+ *
+ *  @param uuid UUID of the node.
+ *  @param addr Primary element address, or 0 to allocate one.
+ *  @param num_elem Number of elements of the node.
+ *  @param net_idx NetKey Index the node is provisioned into.
+ *
+ *  @return The new node, or NULL if the database or the address space
+ *          is full, or the address range is taken.
+ */
+struct bt_mesh_cdb_node *bt_mesh_cdb_node_alloc(const u8_t uuid[16], u16_t addr,
+        u8_t num_elem, u16_t net_idx);
+
+/** @brief Delete a node.
+ *
+ *  @param node Node to delete.
+ *  @param store Unused, the database is not persisted.
+ */
+void bt_mesh_cdb_node_del(struct bt_mesh_cdb_node *node, bool store);
+
+/** @brief Get the node owning an element address.
+ *
+ *  @param addr Address of any element of the node.
+ *
+ *  @return The node, or NULL if no node owns the address.
+ */
+struct bt_mesh_cdb_node *bt_mesh_cdb_node_get(u16_t addr);
+
+/** @brief Get a node by UUID.
+ *
+ *  @param uuid UUID of the node.
+ *
+ *  @return The node, or NULL if it has not been provisioned.
+ */
+struct bt_mesh_cdb_node *bt_mesh_cdb_node_get_by_uuid(const u8_t uuid[16]);
+
+/** @brief Get a subnet.
+ *
+ *  @param net_idx NetKey Index of the subnet.
+ *
+ *  @return The subnet, or NULL if there is none with that index.
+ */
+struct bt_mesh_cdb_subnet *bt_mesh_cdb_subnet_get(u16_t net_idx);
+
+/** @brief Get the provisioning flags of a subnet.
+ *
+ *  @param sub Subnet.
+ *
+ *  @return Key Refresh and IV Update flags as sent in Provisioning Data.
+ */
+u8_t bt_mesh_cdb_subnet_flags(const struct bt_mesh_cdb_subnet *sub);
+
+#endif /* CONFIG_BT_MESH_PROVISIONER */
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_BLUETOOTH_MESH_CDB_H_ */
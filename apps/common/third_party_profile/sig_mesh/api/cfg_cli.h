@@ -213,6 +213,71 @@ int bt_mesh_cfg_hb_pub_get(u16_t net_idx, u16_t addr,
 s32_t bt_mesh_cfg_cli_timeout_get(void);
 void bt_mesh_cfg_cli_timeout_set(s32_t timeout);
 
+/** Company ID of a SIG model in a configuration step. */
+#define BT_MESH_CFG_CID_NVAL 0xffff
+
+/** Configuration step types. */
+enum {
+    BT_MESH_CFG_STEP_APP_KEY_ADD,
+    BT_MESH_CFG_STEP_MOD_APP_BIND,
+    BT_MESH_CFG_STEP_MOD_SUB_ADD,
+    BT_MESH_CFG_STEP_MOD_PUB_SET,
+};
+
+/** One request of a configuration plan. */
+struct bt_mesh_cfg_step {
+    u8_t  type;       /**< BT_MESH_CFG_STEP_* */
+    u8_t  elem;       /**< Element index within the node */
+    u16_t mod_id;     /**< Model ID */
+    u16_t cid;        /**< Company ID, or BT_MESH_CFG_CID_NVAL */
+    u16_t app_idx;    /**< AppKey Index to add or bind */
+    u16_t sub_addr;   /**< Address to subscribe the model to */
+    const u8_t *app_key;                   /**< AppKey to add */
+    const struct bt_mesh_cfg_mod_pub *pub; /**< Publication to set */
+};
+
+/** Configuration applied to any number of nodes. */
+struct bt_mesh_cfg_plan {
+    /** Subnet the nodes are configured over, also the NetKey Index the
+     *  added AppKeys are bound to.
+     */
+    u16_t net_idx;
+
+    u8_t step_count;
+    const struct bt_mesh_cfg_step *steps;
+
+    /** @brief A node has been configured or given up on.
+     *
+     *  @param addr Primary element address of the node.
+     *  @param err 0 on success, -EIO if the node refused a step,
+     *             -ETIMEDOUT if it stopped answering, or the error a
+     *             request could not be sent with (e.g. -ENOENT without
+     *             a DevKey for the node).
+     *  @param step Failed step, or step_count on success.
+     *  @param status Status code the node refused the step with,
+     *               STATUS_SUCCESS on success and Unspecified Error
+     *               (0x10) on timeout.
+     *  @param elapsed_ms Time since bt_mesh_cfg_plan_add().
+     */
+    void (*complete)(u16_t addr, int err, u8_t step, u8_t status,
+                     u32_t elapsed_ms);
+};
+
+/** @brief Queue a node for configuration.
+ *
+ *  The steps run in order, each retried up to
+ *  CONFIG_BT_MESH_CFG_CLI_PLAN_RETRIES times when its status does not
+ *  arrive within the client timeout. A request the transport has no
+ *  buffer or segmentation context for waits without using up a retry. Several nodes are configured in
+ *  parallel. The plan must stay valid until the node completes.
+ *
+ *  @param addr Primary element address of the node.
+ *  @param plan Configuration to apply.
+ *
+ *  @return Zero on success, -ENOMEM if the queue is full.
+ */
+int bt_mesh_cfg_plan_add(u16_t addr, const struct bt_mesh_cfg_plan *plan);
+
 /**
  * @}
  */
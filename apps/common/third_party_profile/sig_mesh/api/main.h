@@ -165,6 +165,29 @@ struct bt_mesh_prov {
      *  unprovisioned advertising on one or more provisioning bearers.
      */
     void (*reset)(void);
+
+    /** @brief An unprovisioned device has been discovered.
+     *
+     *  Called by a provisioner the first time it hears the
+     *  Unprovisioned Device beacon of a device it has not provisioned.
+     *
+     *  @param uuid UUID of the device.
+     *  @param oob_info OOB Information field of the beacon.
+     *  @param uri_hash URI Hash of the beacon, or NULL if absent.
+     */
+    void (*unprovisioned_beacon)(const u8_t uuid[16],
+                                 bt_mesh_prov_oob_info_t oob_info,
+                                 const u32_t *uri_hash);
+
+    /** @brief A node has been provisioned by this device.
+     *
+     *  @param net_idx NetKeyIndex given to the node.
+     *  @param uuid UUID of the node.
+     *  @param addr Primary element address of the node.
+     *  @param num_elem Number of elements of the node.
+     */
+    void (*node_added)(u16_t net_idx, u8_t uuid[16], u16_t addr,
+                       u8_t num_elem);
 };
 
 /** @brief Provide provisioning input OOB string.
@@ -189,6 +212,76 @@ int bt_mesh_input_string(const char *str);
  */
 int bt_mesh_input_number(u32_t num);
 
+/** Where the time of the last provisioning went, in milliseconds. */
+struct bt_mesh_prov_timing {
+    u32_t total_ms;    /**< Link open to the last PDU received */
+    u32_t key_gen_ms;  /**< Last generation of the local key pair */
+    u32_t key_wait_ms; /**< Link stalled waiting for the local key */
+    u32_t dh_ms;       /**< Shared secret computation */
+    u32_t pdu_ms[10];  /**< Per PDU type, time since the previous PDU */
+};
+
+/** @brief Get the time breakdown of the last provisioning.
+ *
+ *  @param stats Filled with the timing of the current or last link.
+ */
+void bt_mesh_prov_timing_get(struct bt_mesh_prov_timing *stats);
+
+/** @brief Provision a device over PB-ADV.
+ *
+ *  Requires CONFIG_BT_MESH_PROVISIONER and a database created with
+ *  bt_mesh_cdb_create().
+ *
+ *  @param uuid UUID of the unprovisioned device.
+ *  @param net_idx NetKey Index to provision the device into.
+ *  @param addr Primary element address, or 0 to allocate one.
+ *  @param attention_duration Attention Timer for the device, seconds.
+ *
+ *  @return Zero on success, -EBUSY if a link is already open.
+ */
+int bt_mesh_provision_adv(const u8_t uuid[16], u16_t net_idx, u16_t addr,
+                          u8_t attention_duration);
+
+/** @brief Provision every unprovisioned device that is heard.
+ *
+ *  Devices are taken one link at a time from a table fed by their
+ *  Unprovisioned Device beacons, in the order they were heard, each with
+ *  the next free unicast addresses. Failed devices are retried
+ *  CONFIG_BT_MESH_PROV_ATTEMPTS times.
+ *
+ *  @param net_idx NetKey Index to provision the devices into.
+ *  @param attention_duration Attention Timer for the devices, seconds.
+ *
+ *  @return Zero on success or (negative) error code otherwise.
+ */
+int bt_mesh_provisioner_enable(u16_t net_idx, u8_t attention_duration);
+
+/** @brief Stop provisioning discovered devices.
+ *
+ *  A link already open is completed.
+ */
+void bt_mesh_provisioner_disable(void);
+
+/** Provisioner throughput. */
+struct bt_mesh_provisioner_stats {
+    u32_t seen;        /**< Unprovisioned devices discovered */
+    u32_t started;     /**< Links opened, retries included */
+    u32_t provisioned; /**< Devices provisioned */
+    u32_t failed;      /**< Links closed without a new node */
+    u32_t active_ms;   /**< Time since the first link was opened */
+    u32_t avg_ms;      /**< Mean link time of provisioned devices */
+    u32_t per_min_x10; /**< Devices provisioned per minute, x10 */
+};
+
+/** @brief Get the provisioner throughput counters.
+ *
+ *  @param stats Filled with the counters since the last reset.
+ */
+void bt_mesh_provisioner_stats_get(struct bt_mesh_provisioner_stats *stats);
+
+/** @brief Reset the provisioner throughput counters. */
+void bt_mesh_provisioner_stats_reset(void);
+
 /** @brief Enable specific provisioning bearers
  *
  *  Enable one or more provisioning bearers.
@@ -298,6 +391,19 @@ int bt_mesh_provision(const u8_t net_key[16], u16_t net_idx,
  */
 bool bt_mesh_is_provisioned(void);
 
+/** @brief Log the network and transport counters.
+ *
+ *  Prints PDUs sent, received, delivered and relayed, duplicate and
+ *  decryption drops, segmented transfer times and goodput in both
+ *  directions, and advertising and Friend buffer pool occupancy. Reset
+ *  them on every node before a test run, then compare the logs to get
+ *  the delivery ratio and latency across the network.
+ */
+void bt_mesh_stats_log(void);
+
+/** @brief Reset the counters printed by bt_mesh_stats_log(). */
+void bt_mesh_stats_reset(void);
+
 /** @brief Toggle the IV Update test mode
  *
  *  This API is only available if the IV Update test mode has been enabled
@@ -340,6 +446,38 @@ int bt_mesh_lpn_set(bool enable);
  */
 int bt_mesh_lpn_poll(void);
 
+/** @brief Tell the Low Power node how often it expects messages.
+ *
+ *  The poll interval normally follows the traffic observed through the
+ *  Friend, backing off while nothing arrives. With a hint it never backs
+ *  off beyond the given period, e.g. the publish period of the models
+ *  this node listens to.
+ *
+ *  @param period_ms Expected message period in milliseconds, 0 for none.
+ */
+void bt_mesh_lpn_traffic_hint(u32_t period_ms);
+
+/** Low Power node activity, for estimating average current. */
+struct bt_mesh_lpn_stats {
+    u32_t polls;              /**< Friend Polls sent, retries included */
+    u32_t batched;            /**< Polls sent along with own messages */
+    u32_t delivered;          /**< Messages received from the Friend */
+    u32_t empty;              /**< Poll cycles that brought no message */
+    u32_t radio_ms;           /**< Scanning plus advertising time */
+    u32_t elapsed_ms;         /**< Time since the counters were reset */
+    u32_t radio_ms_per_hour;  /**< radio_ms scaled to one hour */
+    u32_t polls_per_msg_x100; /**< Polls per delivered message, x100 */
+};
+
+/** @brief Get the Low Power node activity counters.
+ *
+ *  @param stats Filled with the counters since the last reset.
+ */
+void bt_mesh_lpn_stats_get(struct bt_mesh_lpn_stats *stats);
+
+/** @brief Reset the Low Power node activity counters. */
+void bt_mesh_lpn_stats_reset(void);
+
 /** @brief Register a callback for Friendship changes.
  *
  *  Registers a callback that will be called whenever Friendship gets
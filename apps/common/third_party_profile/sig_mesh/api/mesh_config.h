@@ -50,11 +50,27 @@
 #define CONFIG_BT_MESH_FRIEND_LPN_COUNT         2
 #endif /* NET_BUF_USE_MALLOC */
 #define CONFIG_BT_MESH_FRIEND_SEG_RX            1
+/* Friend Queue buffers each LPN keeps even when another LPN runs the
+ * shared pool dry; the pool holds (QUEUE_SIZE + 1) per LPN.
+ */
+#define CONFIG_BT_MESH_FRIEND_QUEUE_MIN         (CONFIG_BT_MESH_FRIEND_QUEUE_SIZE / 2)
 #define CONFIG_BT_MESH_FRIEND_RECV_WIN          config_bt_mesh_friend_recv_win // 255
 
 /* Proxy config */
+/* Proxy Clients served at once; the controller has to be set up for as
+ * many slave links.
+ */
 #define CONFIG_BT_MAX_CONN                      1
-#define CONFIG_BT_MESH_PROXY_FILTER_SIZE        3
+#define CONFIG_BT_MESH_PROXY_FILTER_SIZE        128
+#define CONFIG_BT_MESH_PROXY_FILTER_HASH_SIZE   256 // power of 2, >= 2 * FILTER_SIZE
+/* Notification bytes held per client while the ATT layer is out of
+ * buffers. A message that does not fit is dropped whole, never split.
+ */
+#define CONFIG_BT_MESH_PROXY_TX_QUEUE_SIZE      256
+/* Ask for a link layer data length that fits the negotiated ATT_MTU, so
+ * each notification goes out as a single PDU.
+ */
+#define CONFIG_BT_MESH_PROXY_DLE                1
 
 /* Net buffer config */
 #define NET_BUF_TEST_EN                         0
@@ -65,26 +81,67 @@
 #define CONFIG_BT_MESH_ADV_BUF_COUNT 		    4
 #endif /* NET_BUF_USE_MALLOC */
 
+/* Adv bearer scheduler config */
+#define CONFIG_BT_MESH_ADV_XMIT_TIMING          1 // 0: fixed adv interval/duration
+#define CONFIG_BT_MESH_ADV_SCHED_WEIGHTED       0
+#define CONFIG_BT_MESH_ADV_RELAY_DEADLINE       500 // unit: ms, 0 disables
+
+/* Work queue config */
+#define CONFIG_BT_MESH_WORK_SLACK_MS            4 // delayed work due this much after the first one runs with it
+#define CONFIG_BT_MESH_WORK_BATCH               8
+
+/* Scan config */
+#define CONFIG_BT_MESH_SCAN_PROFILE             BT_LE_SCAN_PROFILE_CONTINUOUS
+#define CONFIG_BT_MESH_SCAN_LOW_DUTY_INTERVAL   100 // unit: ms
+#define CONFIG_BT_MESH_SCAN_LOW_DUTY_WINDOW     10 // unit: ms
+#define CONFIG_BT_MESH_SCAN_RX_RING_SIZE        8 // power of 2, 0: handle reports in scan callback
+#define CONFIG_BT_MESH_SCAN_RX_BATCH            4
+
 /* Net config */
 #define CONFIG_BT_MESH_SUBNET_COUNT             2
 #define CONFIG_BT_MESH_MSG_CACHE_SIZE 		    10
+#define CONFIG_BT_MESH_DUP_CACHE_SIZE           4
 #define CONFIG_BT_MESH_IVU_DIVIDER              4
 
 /* Transport config */
 #define CONFIG_BT_MESH_TX_SEG_MAX 			    6
+#if NET_BUF_USE_MALLOC
+#define CONFIG_BT_MESH_TX_SEG_MSG_COUNT         config_bt_mesh_tx_seg_msg_count
+#define CONFIG_BT_MESH_RX_SEG_MSG_COUNT         config_bt_mesh_rx_seg_msg_count
+#define CONFIG_BT_MESH_RX_SEG_ARENA_SIZE        config_bt_mesh_rx_seg_arena_size
+#else
 #define CONFIG_BT_MESH_TX_SEG_MSG_COUNT 	    1
 #define CONFIG_BT_MESH_RX_SEG_MSG_COUNT 	    1
+#define CONFIG_BT_MESH_RX_SEG_ARENA_SIZE        (CONFIG_BT_MESH_RX_SEG_MSG_COUNT * CONFIG_BT_MESH_RX_SDU_MAX)
+#endif /* NET_BUF_USE_MALLOC */
+#define CONFIG_BT_MESH_RX_SEG_SRC_MAX           1
+#define CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE       4 // 0: fixed retransmit timer
+#define CONFIG_BT_MESH_SEG_BACKOFF_MAX          3
 #define CONFIG_BT_MESH_RX_SDU_MAX 			    72
 
 /* Element models config */
 #define CONFIG_BT_MESH_CFG_CLI                  1
+/* Nodes bt_mesh_cfg_plan_add() can queue, how many of them have a request
+ * in flight at once, and how often an unanswered request is resent.
+ * Segmented requests (AppKey Add, Publication Set) take one of the
+ * CONFIG_BT_MESH_TX_SEG_MSG_COUNT contexts each and wait for a free one.
+ */
+#define CONFIG_BT_MESH_CFG_CLI_PLAN_QUEUE       16
+#define CONFIG_BT_MESH_CFG_CLI_PLAN_INFLIGHT    4
+#define CONFIG_BT_MESH_CFG_CLI_PLAN_RETRIES     3
 // #define CONFIG_BT_MESH_HEALTH_SRV               1
 #define CONFIG_BT_MESH_APP_KEY_COUNT            2
 #define CONFIG_BT_MESH_MODEL_KEY_COUNT          2
 #define CONFIG_BT_MESH_MODEL_GROUP_COUNT        2
-#define CONFIG_BT_MESH_CRPL                     10
+#define CONFIG_BT_MESH_MODEL_OP_INDEX           NET_BUF_USE_MALLOC // heap opcode dispatch index
+#define CONFIG_BT_MESH_SUB_INDEX                NET_BUF_USE_MALLOC // heap group subscription index
+#define CONFIG_BT_MESH_CRPL                     128 // 8 bytes RAM + ~13 bytes of store log each
 #define CONFIG_BT_MESH_LABEL_COUNT              3
 
+/* Replay protection config */
+#define CONFIG_BT_MESH_RPL_HASH_SIZE            256 // power of 2, > CRPL
+#define CONFIG_BT_MESH_RPL_LRU_EVICT            0
+
 /* Provisioning config */
 #define CONFIG_BT_MESH_PROV                     1
 #define CONFIG_BT_MESH_PB_ADV                   1
@@ -95,9 +152,50 @@
 #define CONFIG_BT_MESH_STORE_TIMEOUT            2
 #define CONFIG_BT_MESH_SEQ_STORE_RATE 		    128
 #define CONFIG_BT_MESH_RPL_STORE_TIMEOUT        600
+/* Delay (ms) used for "store now" requests so that back-to-back updates
+ * (e.g. NetKey, IV and SEQ at provisioning) share a single flash pass.
+ */
+#define CONFIG_BT_MESH_STORE_COALESCE_MS        20
+/* Pack settings records into an append-only log of a few VM items (pages)
+ * instead of one VM item per record. Pages use VM indexes
+ * STORE_LOG_INDEX .. STORE_LOG_INDEX + STORE_LOG_PAGES - 1, which must stay
+ * below the app's VM range (80). One page is always kept free for
+ * compaction, so live records must fit in (PAGES - 1) pages: about 13
+ * bytes per RPL entry and up to 1 KB for the keys and models.
+ */
+#define CONFIG_BT_MESH_STORE_LOG                1
+#define CONFIG_BT_MESH_STORE_LOG_INDEX          75
+#define CONFIG_BT_MESH_STORE_LOG_PAGES          5
+#define CONFIG_BT_MESH_STORE_LOG_PAGE_SIZE      768
+/* Record ids the log indexes, 3 bytes of RAM each: one per RPL slot and
+ * about 70 for the keys, models and the rest of the default composition.
+ * Ids at or above STORE_LOG_INDEX only ever live in the log.
+ */
+#define CONFIG_BT_MESH_STORE_LOG_ID_MAX         (CONFIG_BT_MESH_CRPL + 96)
+/* Also store the NID, EncKey, PrivacyKey, NetID, BeaconKey and IdentityKey
+ * of each NetKey (~80 bytes per key, needs CONFIG_BT_MESH_STORE_LOG), so
+ * that boot does not rerun the k2/k3/k1 CMAC chains for every subnet.
+ * Budget one more log page per two subnets when enabling it.
+ */
+#define CONFIG_BT_MESH_STORE_DERIVED_KEYS       0
 
-/* TODO */
+/* Provisioner role: Configuration Database, PB-ADV provisioning of
+ * discovered devices and device keys for the Configuration Client.
+ */
 #define CONFIG_BT_MESH_PROVISIONER              0
+#if CONFIG_BT_MESH_PROVISIONER
+/* Nodes the database can hold, ~40 bytes each */
+#define CONFIG_BT_MESH_CDB_NODE_COUNT           128
+#define CONFIG_BT_MESH_CDB_SUBNET_COUNT         1
+/* Expanded DevKeys kept, ~180 bytes each: one per node the Configuration
+ * Client plan has in flight and one for single requests.
+ */
+#define CONFIG_BT_MESH_CDB_DEV_KEY_CACHE        (CONFIG_BT_MESH_CFG_CLI_PLAN_INFLIGHT + 1)
+/* Unprovisioned devices tracked while waiting for a link */
+#define CONFIG_BT_MESH_PROV_DEV_TABLE_SIZE      16
+/* Links opened to one device before it is given up */
+#define CONFIG_BT_MESH_PROV_ATTEMPTS            3
+#endif /* CONFIG_BT_MESH_PROVISIONER */
 // #define CONFIG_BT_MESH_HEALTH_CLI               1
 
 
@@ -131,6 +229,8 @@ extern const int config_bt_mesh_features;
 
 /**
  * @brief Config adv bearer hardware param when node send messages
+ *        (only used when CONFIG_BT_MESH_ADV_XMIT_TIMING is 0, otherwise
+ *        each PDU follows its own Transmit count and interval)
  */
 /*-----------------------------------------------------------*/
 extern const u16 config_bt_mesh_node_msg_adv_interval;
@@ -174,6 +274,15 @@ extern const u8 config_bt_mesh_friend_queue_size;
 /*-----------------------------------------------------------*/
 extern const u8 config_bt_mesh_adv_buf_count;
 
+/**
+ * @brief Config segmented message contexts, incoming SDUs share one
+ *        reassembly arena sized in bytes
+ */
+/*-----------------------------------------------------------*/
+extern const u8 config_bt_mesh_tx_seg_msg_count;
+extern const u8 config_bt_mesh_rx_seg_msg_count;
+extern const u16 config_bt_mesh_rx_seg_arena_size;
+
 /**
  * @brief Config PB-ADV param
  */
@@ -5,6 +5,7 @@
 #include "api/mesh_config.h"
 #include "api/access.h"
 #include "api/main.h"
+#include "api/cdb.h"
 #include "api/proxy.h"
 #include "api/cfg_cli.h"
 #include "api/cfg_srv.h"
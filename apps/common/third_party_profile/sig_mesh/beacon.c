@@ -14,6 +14,7 @@
 #include "crypto.h"
 #include "beacon.h"
 #include "foundation.h"
+#include "provisioner.h"
 
 #define LOG_TAG             "[MESH-beacon]"
 /* #define LOG_INFO_ENABLE */
@@ -377,7 +378,11 @@ void bt_mesh_beacon_recv(struct net_buf_simple *buf)
     type = net_buf_simple_pull_u8(buf);
     switch (type) {
     case BEACON_TYPE_UNPROVISIONED:
-        BT_DBG("Ignoring unprovisioned device beacon");
+        if (IS_ENABLED(CONFIG_BT_MESH_PROVISIONER)) {
+            bt_mesh_provisioner_beacon_recv(buf);
+        } else {
+            BT_DBG("Ignoring unprovisioned device beacon");
+        }
         break;
     case BEACON_TYPE_SECURE:
         secure_beacon_recv(buf);
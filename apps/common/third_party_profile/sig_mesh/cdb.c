@@ -0,0 +1,313 @@
+/*  Bluetooth Mesh */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "adaptation.h"
+#include "crypto.h"
+#include "mesh.h"
+#include "net.h"
+#include "access.h"
+#include "provisioner.h"
+
+#define LOG_TAG             "[MESH-cdb]"
+#define LOG_INFO_ENABLE
+#define LOG_DEBUG_ENABLE
+#define LOG_WARN_ENABLE
+#define LOG_ERROR_ENABLE
+#define LOG_DUMP_ENABLE
+#include "mesh_log.h"
+
+#if MESH_RAM_AND_CODE_MAP_DETAIL
+#ifdef SUPPORT_MS_EXTENSIONS
+#pragma bss_seg(".ble_mesh_cdb_bss")
+#pragma data_seg(".ble_mesh_cdb_data")
+#pragma const_seg(".ble_mesh_cdb_const")
+#pragma code_seg(".ble_mesh_cdb_code")
+#endif
+#else /* MESH_RAM_AND_CODE_MAP_DETAIL */
+#pragma bss_seg(".ble_mesh_bss")
+#pragma data_seg(".ble_mesh_data")
+#pragma const_seg(".ble_mesh_const")
+#pragma code_seg(".ble_mesh_code")
+#endif /* MESH_RAM_AND_CODE_MAP_DETAIL */
+
+#if CONFIG_BT_MESH_PROVISIONER
+
+#define UNICAST_ADDR_MAX       0x7fff
+
+struct bt_mesh_cdb bt_mesh_cdb;
+
+/* Expanded DevKeys of the nodes the Configuration Client is talking to,
+ * so pipelined requests to a few nodes do not re-run the key expansion
+ * per message, without keeping a schedule for every node.
+ */
+static struct {
+    u16_t addr;
+    struct tc_aes_key_sched_struct sched;
+} dev_key_cache[CONFIG_BT_MESH_CDB_DEV_KEY_CACHE];
+
+/* Entry replaced on the next miss */
+static u8_t dev_key_next;
+
+static void dev_key_forget(u16_t addr)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(dev_key_cache); i++) {
+        if (dev_key_cache[i].addr == addr) {
+            dev_key_cache[i].addr = BT_MESH_ADDR_UNASSIGNED;
+        }
+    }
+}
+
+/* Return the last address of whatever overlaps [addr, addr + num_elem),
+ * or 0 if the range is free.
+ */
+static u16_t addr_conflict(u16_t addr, u8_t num_elem)
+{
+    u16_t end = addr + num_elem - 1;
+    u16_t own = bt_mesh_primary_addr();
+    int i;
+
+    if (own != BT_MESH_ADDR_UNASSIGNED &&
+        addr <= own + bt_mesh_elem_count() - 1 && own <= end) {
+        return own + bt_mesh_elem_count() - 1;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(bt_mesh_cdb.nodes); i++) {
+        struct bt_mesh_cdb_node *node = &bt_mesh_cdb.nodes[i];
+
+        if (node->addr == BT_MESH_ADDR_UNASSIGNED) {
+            continue;
+        }
+
+        if (addr <= node->addr + node->num_elem - 1 && node->addr <= end) {
+            return node->addr + node->num_elem - 1;
+        }
+    }
+
+    return 0;
+}
+
+static u16_t addr_alloc(u8_t num_elem)
+{
+    u16_t addr = bt_mesh_cdb.lowest_avail_addr;
+    u16_t taken;
+
+    while (addr + num_elem - 1 <= UNICAST_ADDR_MAX) {
+        taken = addr_conflict(addr, num_elem);
+        if (!taken) {
+            return addr;
+        }
+
+        addr = taken + 1;
+    }
+
+    return BT_MESH_ADDR_UNASSIGNED;
+}
+
+int bt_mesh_cdb_create(const u8_t key[16])
+{
+    struct bt_mesh_cdb_subnet *sub;
+    int i;
+
+    if (bt_mesh_cdb.valid) {
+        return -EALREADY;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(bt_mesh_cdb.subnets); i++) {
+        bt_mesh_cdb.subnets[i].net_idx = BT_MESH_KEY_UNUSED;
+    }
+
+    sub = &bt_mesh_cdb.subnets[0];
+    sub->net_idx = BT_MESH_KEY_PRIMARY;
+    memcpy(sub->keys[0].net_key, key, 16);
+
+    /* A gateway normally provisions itself into the same network */
+    if (bt_mesh.valid) {
+        bt_mesh_cdb.iv_index = bt_mesh.iv_index;
+        bt_mesh_cdb.iv_update = bt_mesh.iv_update;
+    }
+
+    bt_mesh_cdb.lowest_avail_addr = 1;
+    bt_mesh_cdb.valid = true;
+
+    return 0;
+}
+
+void bt_mesh_cdb_clear(void)
+{
+    (void)memset(&bt_mesh_cdb, 0, sizeof(bt_mesh_cdb));
+    (void)memset(dev_key_cache, 0, sizeof(dev_key_cache));
+}
+
+void bt_mesh_cdb_iv_update(u32_t iv_index, bool iv_update)
+{
+    bt_mesh_cdb.iv_index = iv_index;
+    bt_mesh_cdb.iv_update = iv_update;
+}
+
+struct bt_mesh_cdb_node *bt_mesh_cdb_node_alloc(const u8_t uuid[16], u16_t addr,
+        u8_t num_elem, u16_t net_idx)
+{
+    struct bt_mesh_cdb_node *node = NULL;
+    int i;
+
+    if (!bt_mesh_cdb.valid || !num_elem) {
+        return NULL;
+    }
+
+    if (addr == BT_MESH_ADDR_UNASSIGNED) {
+        addr = addr_alloc(num_elem);
+        if (addr == BT_MESH_ADDR_UNASSIGNED) {
+            BT_WARN("No unicast range for %u elements", num_elem);
+            return NULL;
+        }
+    } else if (addr + num_elem - 1 > UNICAST_ADDR_MAX ||
+               addr_conflict(addr, num_elem)) {
+        BT_WARN("Address range 0x%04x+%u is taken", addr, num_elem);
+        return NULL;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(bt_mesh_cdb.nodes); i++) {
+        if (bt_mesh_cdb.nodes[i].addr == BT_MESH_ADDR_UNASSIGNED) {
+            node = &bt_mesh_cdb.nodes[i];
+            break;
+        }
+    }
+
+    if (!node) {
+        BT_WARN("Configuration database full");
+        return NULL;
+    }
+
+    memcpy(node->uuid, uuid, 16);
+    node->addr = addr;
+    node->num_elem = num_elem;
+    node->net_idx = net_idx;
+
+    /* The DevKey is only known once provisioning completes */
+    dev_key_forget(addr);
+
+    if (addr == bt_mesh_cdb.lowest_avail_addr) {
+        bt_mesh_cdb.lowest_avail_addr = addr + num_elem;
+    }
+
+    BT_DBG("Node 0x%04x, %u elements", addr, num_elem);
+
+    return node;
+}
+
+void bt_mesh_cdb_node_del(struct bt_mesh_cdb_node *node, bool store)
+{
+    if (!node || node->addr == BT_MESH_ADDR_UNASSIGNED) {
+        return;
+    }
+
+    BT_DBG("Node 0x%04x", node->addr);
+
+    if (node->addr < bt_mesh_cdb.lowest_avail_addr) {
+        bt_mesh_cdb.lowest_avail_addr = node->addr;
+    }
+
+    dev_key_forget(node->addr);
+
+    (void)memset(node, 0, sizeof(*node));
+}
+
+struct bt_mesh_cdb_node *bt_mesh_cdb_node_get(u16_t addr)
+{
+    int i;
+
+    if (!BT_MESH_ADDR_IS_UNICAST(addr)) {
+        return NULL;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(bt_mesh_cdb.nodes); i++) {
+        struct bt_mesh_cdb_node *node = &bt_mesh_cdb.nodes[i];
+
+        if (node->addr != BT_MESH_ADDR_UNASSIGNED &&
+            addr >= node->addr && addr < node->addr + node->num_elem) {
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+struct bt_mesh_cdb_node *bt_mesh_cdb_node_get_by_uuid(const u8_t uuid[16])
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(bt_mesh_cdb.nodes); i++) {
+        struct bt_mesh_cdb_node *node = &bt_mesh_cdb.nodes[i];
+
+        if (node->addr != BT_MESH_ADDR_UNASSIGNED &&
+            !memcmp(node->uuid, uuid, 16)) {
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+struct bt_mesh_cdb_subnet *bt_mesh_cdb_subnet_get(u16_t net_idx)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(bt_mesh_cdb.subnets); i++) {
+        if (bt_mesh_cdb.subnets[i].net_idx == net_idx) {
+            return &bt_mesh_cdb.subnets[i];
+        }
+    }
+
+    return NULL;
+}
+
+u8_t bt_mesh_cdb_subnet_flags(const struct bt_mesh_cdb_subnet *sub)
+{
+    u8_t flags = 0x00;
+
+    if (sub && sub->kr_flag) {
+        flags |= BT_MESH_NET_FLAG_KR;
+    }
+
+    if (bt_mesh_cdb.iv_update) {
+        flags |= BT_MESH_NET_FLAG_IVU;
+    }
+
+    return flags;
+}
+
+struct tc_aes_key_sched_struct *bt_mesh_cdb_dev_key_get(u16_t addr)
+{
+    struct bt_mesh_cdb_node *node;
+    int i;
+
+    node = bt_mesh_cdb_node_get(addr);
+    if (!node) {
+        return NULL;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(dev_key_cache); i++) {
+        if (dev_key_cache[i].addr == node->addr) {
+            return &dev_key_cache[i].sched;
+        }
+    }
+
+    i = dev_key_next;
+    dev_key_next = (dev_key_next + 1) % ARRAY_SIZE(dev_key_cache);
+
+    if (bt_mesh_aes_key_expand(node->dev_key, &dev_key_cache[i].sched)) {
+        dev_key_cache[i].addr = BT_MESH_ADDR_UNASSIGNED;
+        return NULL;
+    }
+
+    dev_key_cache[i].addr = node->addr;
+
+    return &dev_key_cache[i].sched;
+}
+
+#endif /* CONFIG_BT_MESH_PROVISIONER */
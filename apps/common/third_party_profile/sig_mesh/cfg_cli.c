@@ -32,7 +32,7 @@
 #pragma code_seg(".ble_mesh_code")
 #endif /* MESH_RAM_AND_CODE_MAP_DETAIL */
 
-#define CID_NVAL 0xffff
+#define CID_NVAL BT_MESH_CFG_CID_NVAL
 
 struct comp_data {
     u8_t *status;
@@ -43,6 +43,9 @@ static s32_t msg_timeout = K_SECONDS(2);
 
 static struct bt_mesh_cfg_cli *cli;
 
+static bool plan_status(struct bt_mesh_msg_ctx *ctx, u32_t op,
+                        struct net_buf_simple *buf);
+
 static void comp_data_status(struct bt_mesh_model *model,
                              struct bt_mesh_msg_ctx *ctx,
                              struct net_buf_simple *buf)
@@ -194,6 +197,10 @@ static void app_key_status(struct bt_mesh_model *model,
            ctx->net_idx, ctx->app_idx, ctx->addr, buf->len,
            bt_hex(buf->data, buf->len));
 
+    if (plan_status(ctx, OP_APP_KEY_STATUS, buf)) {
+        return;
+    }
+
     if (cli->op_pending != OP_APP_KEY_STATUS) {
         BT_WARN("Unexpected App Key Status message");
         return;
@@ -233,6 +240,10 @@ static void mod_app_status(struct bt_mesh_model *model,
            ctx->net_idx, ctx->app_idx, ctx->addr, buf->len,
            bt_hex(buf->data, buf->len));
 
+    if (plan_status(ctx, OP_MOD_APP_STATUS, buf)) {
+        return;
+    }
+
     if (cli->op_pending != OP_MOD_APP_STATUS) {
         BT_WARN("Unexpected Model App Status message");
         return;
@@ -283,6 +294,10 @@ static void mod_pub_status(struct bt_mesh_model *model,
            ctx->net_idx, ctx->app_idx, ctx->addr, buf->len,
            bt_hex(buf->data, buf->len));
 
+    if (plan_status(ctx, OP_MOD_PUB_STATUS, buf)) {
+        return;
+    }
+
     if (cli->op_pending != OP_MOD_PUB_STATUS) {
         BT_WARN("Unexpected Model Pub Status message");
         return;
@@ -357,6 +372,10 @@ static void mod_sub_status(struct bt_mesh_model *model,
            ctx->net_idx, ctx->app_idx, ctx->addr, buf->len,
            bt_hex(buf->data, buf->len));
 
+    if (plan_status(ctx, OP_MOD_SUB_STATUS, buf)) {
+        return;
+    }
+
     if (cli->op_pending != OP_MOD_SUB_STATUS) {
         BT_WARN("Unexpected Model Subscription Status message");
         return;
@@ -474,6 +493,51 @@ const struct bt_mesh_model_op bt_mesh_cfg_cli_op[] = {
     BT_MESH_MODEL_OP_END,
 };
 
+static void app_key_add_encode(struct net_buf_simple *msg, u16_t key_net_idx,
+                               u16_t key_app_idx, const u8_t app_key[16])
+{
+    bt_mesh_model_msg_init(msg, OP_APP_KEY_ADD);
+    key_idx_pack(msg, key_net_idx, key_app_idx);
+    net_buf_simple_add_mem(msg, app_key, 16);
+}
+
+/* Model App Bind/Unbind and the address based Model Subscription
+ * messages share one layout: element, 16-bit parameter, model.
+ */
+static void mod_encode(struct net_buf_simple *msg, u32_t op, u16_t elem_addr,
+                       u16_t param, u16_t mod_id, u16_t cid)
+{
+    bt_mesh_model_msg_init(msg, op);
+    net_buf_simple_add_le16(msg, elem_addr);
+    net_buf_simple_add_le16(msg, param);
+
+    if (cid != CID_NVAL) {
+        net_buf_simple_add_le16(msg, cid);
+    }
+
+    net_buf_simple_add_le16(msg, mod_id);
+}
+
+static void mod_pub_set_encode(struct net_buf_simple *msg, u16_t elem_addr,
+                               u16_t mod_id, u16_t cid,
+                               const struct bt_mesh_cfg_mod_pub *pub)
+{
+    bt_mesh_model_msg_init(msg, OP_MOD_PUB_SET);
+
+    net_buf_simple_add_le16(msg, elem_addr);
+    net_buf_simple_add_le16(msg, pub->addr);
+    net_buf_simple_add_le16(msg, (pub->app_idx | (pub->cred_flag << 12)));
+    net_buf_simple_add_u8(msg, pub->ttl);
+    net_buf_simple_add_u8(msg, pub->period);
+    net_buf_simple_add_u8(msg, pub->transmit);
+
+    if (cid != CID_NVAL) {
+        net_buf_simple_add_le16(msg, cid);
+    }
+
+    net_buf_simple_add_le16(msg, mod_id);
+}
+
 static int cli_prepare(void *param, u32_t op)
 {
     if (!cli) {
@@ -780,9 +844,7 @@ int bt_mesh_cfg_app_key_add(u16_t net_idx, u16_t addr, u16_t key_net_idx,
         return err;
     }
 
-    bt_mesh_model_msg_init(&msg, OP_APP_KEY_ADD);
-    key_idx_pack(&msg, key_net_idx, key_app_idx);
-    net_buf_simple_add_mem(&msg, app_key, 16);
+    app_key_add_encode(&msg, key_net_idx, key_app_idx, app_key);
 
     err = bt_mesh_model_send(cli->model, &ctx, &msg, NULL, NULL);
     if (err) {
@@ -824,15 +886,7 @@ static int mod_app_bind(u16_t net_idx, u16_t addr, u16_t elem_addr,
         return err;
     }
 
-    bt_mesh_model_msg_init(&msg, OP_MOD_APP_BIND);
-    net_buf_simple_add_le16(&msg, elem_addr);
-    net_buf_simple_add_le16(&msg, mod_app_idx);
-
-    if (cid != CID_NVAL) {
-        net_buf_simple_add_le16(&msg, cid);
-    }
-
-    net_buf_simple_add_le16(&msg, mod_id);
+    mod_encode(&msg, OP_MOD_APP_BIND, elem_addr, mod_app_idx, mod_id, cid);
 
     err = bt_mesh_model_send(cli->model, &ctx, &msg, NULL, NULL);
     if (err) {
@@ -892,15 +946,7 @@ static int mod_sub(u32_t op, u16_t net_idx, u16_t addr, u16_t elem_addr,
         return err;
     }
 
-    bt_mesh_model_msg_init(&msg, op);
-    net_buf_simple_add_le16(&msg, elem_addr);
-    net_buf_simple_add_le16(&msg, sub_addr);
-
-    if (cid != CID_NVAL) {
-        net_buf_simple_add_le16(&msg, cid);
-    }
-
-    net_buf_simple_add_le16(&msg, mod_id);
+    mod_encode(&msg, op, elem_addr, sub_addr, mod_id, cid);
 
     err = bt_mesh_model_send(cli->model, &ctx, &msg, NULL, NULL);
     if (err) {
@@ -1184,20 +1230,7 @@ static int mod_pub_set(u16_t net_idx, u16_t addr, u16_t elem_addr,
         return err;
     }
 
-    bt_mesh_model_msg_init(&msg, OP_MOD_PUB_SET);
-
-    net_buf_simple_add_le16(&msg, elem_addr);
-    net_buf_simple_add_le16(&msg, pub->addr);
-    net_buf_simple_add_le16(&msg, (pub->app_idx & (pub->cred_flag << 12)));
-    net_buf_simple_add_u8(&msg, pub->ttl);
-    net_buf_simple_add_u8(&msg, pub->period);
-    net_buf_simple_add_u8(&msg, pub->transmit);
-
-    if (cid != CID_NVAL) {
-        net_buf_simple_add_le16(&msg, cid);
-    }
-
-    net_buf_simple_add_le16(&msg, mod_id);
+    mod_pub_set_encode(&msg, elem_addr, mod_id, cid, pub);
 
     err = bt_mesh_model_send(cli->model, &ctx, &msg, NULL, NULL);
     if (err) {
@@ -1393,6 +1426,392 @@ int bt_mesh_cfg_hb_pub_get(u16_t net_idx, u16_t addr,
     return cli_wait();
 }
 
+/* Plan engine: every queued node walks its steps in order, one request
+ * at a time, while up to CONFIG_BT_MESH_CFG_CLI_PLAN_INFLIGHT nodes have
+ * a request outstanding. Statuses are matched by source and opcode, and
+ * by the parameters they echo so that a late answer to a retried step
+ * is not taken for the next one.
+ *
+ * Segmented requests wait for a free segmentation context instead of
+ * failing their send: no more of them are sent than there are contexts,
+ * and a request the transport had no room for is deferred without using
+ * up an attempt, to be resent once a context or buffer is released.
+ */
+enum {
+    JOB_FREE,
+    JOB_QUEUED,
+    JOB_ACTIVE,
+};
+
+struct plan_job {
+    const struct bt_mesh_cfg_plan *plan;
+    u16_t addr;
+    u8_t  state;
+    u8_t  step;
+    u8_t  sends;           /* Transmissions of the current step */
+    u8_t  seg: 1,          /* The current request is segmented */
+          deferred: 1;     /* Not sent yet, waiting for the transport */
+    u8_t  echo_len;
+    u8_t  echo[8];         /* Parameters the status has to repeat */
+    u32_t queued_at;
+    u32_t sent_at;
+};
+
+/* A deferred request is also retried after this long, in case the
+ * buffer it was waiting for is released without a notification.
+ */
+#define PLAN_DEFER_RETRY            K_MSEC(100)
+
+static struct plan_job jobs[CONFIG_BT_MESH_CFG_CLI_PLAN_QUEUE];
+static struct k_delayed_work plan_timer;
+/* Resend the deferred requests on the next timer run */
+static bool plan_resume;
+
+static void plan_step_send(struct plan_job *job);
+
+static u32_t step_status_op(const struct bt_mesh_cfg_step *step)
+{
+    switch (step->type) {
+    case BT_MESH_CFG_STEP_APP_KEY_ADD:
+        return OP_APP_KEY_STATUS;
+    case BT_MESH_CFG_STEP_MOD_APP_BIND:
+        return OP_MOD_APP_STATUS;
+    case BT_MESH_CFG_STEP_MOD_SUB_ADD:
+        return OP_MOD_SUB_STATUS;
+    case BT_MESH_CFG_STEP_MOD_PUB_SET:
+        return OP_MOD_PUB_STATUS;
+    default:
+        return 0;
+    }
+}
+
+static void plan_timer_update(void)
+{
+    s32_t next = -1;
+    u32_t now = k_uptime_get_32();
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+        s32_t left;
+
+        if (jobs[i].state != JOB_ACTIVE) {
+            continue;
+        }
+
+        if (jobs[i].deferred) {
+            left = plan_resume ? 0 : PLAN_DEFER_RETRY;
+        } else {
+            left = msg_timeout - (s32_t)(now - jobs[i].sent_at);
+            if (left < 0) {
+                left = 0;
+            }
+        }
+
+        if (next < 0 || left < next) {
+            next = left;
+        }
+    }
+
+    if (next < 0) {
+        k_delayed_work_cancel(&plan_timer);
+    } else {
+        k_delayed_work_submit(&plan_timer, next);
+    }
+}
+
+static void plan_kick(void)
+{
+    struct plan_job *next;
+    int active = 0;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+        if (jobs[i].state == JOB_ACTIVE) {
+            active++;
+        }
+    }
+
+    while (active < CONFIG_BT_MESH_CFG_CLI_PLAN_INFLIGHT) {
+        next = NULL;
+
+        for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+            if (jobs[i].state == JOB_QUEUED &&
+                (!next ||
+                 (s32_t)(jobs[i].queued_at - next->queued_at) < 0)) {
+                next = &jobs[i];
+            }
+        }
+
+        if (!next) {
+            break;
+        }
+
+        next->state = JOB_ACTIVE;
+        next->step = 0;
+        next->sends = 0;
+        next->deferred = 0;
+        active++;
+
+        plan_step_send(next);
+    }
+
+    plan_timer_update();
+}
+
+static void plan_done(struct plan_job *job, int err, u8_t status)
+{
+    const struct bt_mesh_cfg_plan *plan = job->plan;
+    u32_t elapsed = k_uptime_get_32() - job->queued_at;
+    u16_t addr = job->addr;
+    u8_t step = job->step;
+
+    BT_DBG("Node 0x%04x %s after %u ms", addr, err ? "failed" : "done",
+           elapsed);
+
+    job->state = JOB_FREE;
+
+    /* Its segmentation slot is free for a deferred request */
+    if (job->seg && !job->deferred) {
+        plan_resume = true;
+    }
+
+    if (plan->complete) {
+        plan->complete(addr, err, step, status, elapsed);
+    }
+
+    plan_kick();
+}
+
+/* Segmented requests sent and not answered yet, other than job's */
+static bool plan_seg_busy(struct plan_job *job)
+{
+    int count = 0;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+        if (&jobs[i] != job && jobs[i].state == JOB_ACTIVE &&
+            jobs[i].seg && !jobs[i].deferred) {
+            count++;
+        }
+    }
+
+    return count >= CONFIG_BT_MESH_TX_SEG_MSG_COUNT;
+}
+
+static int plan_send(struct plan_job *job)
+{
+    const struct bt_mesh_cfg_plan *plan = job->plan;
+    const struct bt_mesh_cfg_step *step = &plan->steps[job->step];
+    NET_BUF_SIMPLE_DEFINE(msg, 1 + 19 + 4);
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = plan->net_idx,
+        .app_idx = BT_MESH_KEY_DEV,
+        .addr = job->addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    u16_t elem_addr = job->addr + step->elem;
+    u8_t op_len = 2;
+
+    switch (step->type) {
+    case BT_MESH_CFG_STEP_APP_KEY_ADD:
+        app_key_add_encode(&msg, plan->net_idx, step->app_idx,
+                           step->app_key);
+        op_len = 1;
+        /* The status only repeats the key indexes */
+        job->echo_len = 3;
+        break;
+    case BT_MESH_CFG_STEP_MOD_APP_BIND:
+        mod_encode(&msg, OP_MOD_APP_BIND, elem_addr, step->app_idx,
+                   step->mod_id, step->cid);
+        job->echo_len = msg.len - op_len;
+        break;
+    case BT_MESH_CFG_STEP_MOD_SUB_ADD:
+        mod_encode(&msg, OP_MOD_SUB_ADD, elem_addr, step->sub_addr,
+                   step->mod_id, step->cid);
+        job->echo_len = msg.len - op_len;
+        break;
+    case BT_MESH_CFG_STEP_MOD_PUB_SET:
+        mod_pub_set_encode(&msg, elem_addr, step->mod_id, step->cid,
+                           step->pub);
+        op_len = 1;
+        /* A rejected publication is reported with other values */
+        job->echo_len = 2;
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    memcpy(job->echo, &msg.data[op_len], job->echo_len);
+
+    /* The transport segments anything longer than 11 bytes */
+    job->seg = (msg.len > 11);
+    if (job->seg && plan_seg_busy(job)) {
+        return -EBUSY;
+    }
+
+    return bt_mesh_model_send(cli->model, &ctx, &msg, NULL, NULL);
+}
+
+static void plan_step_send(struct plan_job *job)
+{
+    int err;
+
+    if (job->step >= job->plan->step_count) {
+        plan_done(job, 0, STATUS_SUCCESS);
+        return;
+    }
+
+    err = plan_send(job);
+    if (err == -EBUSY || err == -ENOBUFS) {
+        BT_DBG("Step %u for 0x%04x deferred (err %d)", job->step,
+               job->addr, err);
+        job->deferred = 1;
+        return;
+    }
+
+    if (err) {
+        BT_ERR("Step %u for 0x%04x not sent (err %d)", job->step,
+               job->addr, err);
+        job->deferred = 0;
+        plan_done(job, err, STATUS_UNSPECIFIED);
+        return;
+    }
+
+    job->deferred = 0;
+    job->sent_at = k_uptime_get_32();
+    job->sends++;
+}
+
+static bool plan_status(struct bt_mesh_msg_ctx *ctx, u32_t op,
+                        struct net_buf_simple *buf)
+{
+    struct plan_job *job = NULL;
+    u8_t status;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+        if (jobs[i].state == JOB_ACTIVE && jobs[i].addr == ctx->addr &&
+            step_status_op(&jobs[i].plan->steps[jobs[i].step]) == op) {
+            job = &jobs[i];
+            break;
+        }
+    }
+
+    if (!job) {
+        return false;
+    }
+
+    if (buf->len < 1 + job->echo_len ||
+        memcmp(&buf->data[1], job->echo, job->echo_len)) {
+        BT_DBG("Stale status 0x%04x from 0x%04x", op, ctx->addr);
+        return true;
+    }
+
+    status = buf->data[0];
+
+    /* The request no longer holds a segmentation context */
+    if (job->seg) {
+        plan_resume = true;
+    }
+
+    /* A retried AppKey Add finds the key from the first attempt */
+    if (status == STATUS_SUCCESS ||
+        (op == OP_APP_KEY_STATUS && status == STATUS_IDX_ALREADY_STORED)) {
+        job->step++;
+        job->sends = 0;
+        plan_step_send(job);
+        plan_timer_update();
+    } else {
+        BT_WARN("Node 0x%04x refused step %u (status 0x%02x)",
+                job->addr, job->step, status);
+        plan_done(job, -EIO, status);
+    }
+
+    return true;
+}
+
+static void plan_timeout(struct k_work *work)
+{
+    u32_t now = k_uptime_get_32();
+    int i;
+
+    plan_resume = false;
+
+    for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+        struct plan_job *job = &jobs[i];
+
+        if (job->state != JOB_ACTIVE) {
+            continue;
+        }
+
+        if (job->deferred) {
+            plan_step_send(job);
+            continue;
+        }
+
+        if ((s32_t)(now - job->sent_at) < msg_timeout) {
+            continue;
+        }
+
+        if (job->sends > CONFIG_BT_MESH_CFG_CLI_PLAN_RETRIES) {
+            BT_WARN("Node 0x%04x not answering step %u", job->addr,
+                    job->step);
+            plan_done(job, -ETIMEDOUT, STATUS_UNSPECIFIED);
+            continue;
+        }
+
+        plan_step_send(job);
+    }
+
+    plan_timer_update();
+}
+
+int bt_mesh_cfg_plan_add(u16_t addr, const struct bt_mesh_cfg_plan *plan)
+{
+    int i;
+
+    if (!cli) {
+        BT_ERR("No available Configuration Client context!");
+        return -EINVAL;
+    }
+
+    if (!BT_MESH_ADDR_IS_UNICAST(addr) || !plan) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+        if (jobs[i].state == JOB_FREE) {
+            break;
+        }
+    }
+
+    if (i == ARRAY_SIZE(jobs)) {
+        return -ENOMEM;
+    }
+
+    jobs[i].plan = plan;
+    jobs[i].addr = addr;
+    jobs[i].state = JOB_QUEUED;
+    jobs[i].queued_at = k_uptime_get_32();
+
+    plan_kick();
+
+    return 0;
+}
+
+void bt_mesh_cfg_cli_seg_tx_free(void)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+        if (jobs[i].state == JOB_ACTIVE && jobs[i].deferred) {
+            plan_resume = true;
+            plan_timer_update();
+            return;
+        }
+    }
+}
+
 s32_t bt_mesh_cfg_cli_timeout_get(void)
 {
     return msg_timeout;
@@ -1420,6 +1839,8 @@ int bt_mesh_cfg_cli_init(struct bt_mesh_model *model, bool primary)
     cli = model->user_data;
     cli->model = model;
 
+    k_delayed_work_init(&plan_timer, plan_timeout);
+
     /* Configuration Model security is device-key based */
     model->keys[0] = BT_MESH_KEY_DEV;
 
@@ -483,7 +483,8 @@ static u8_t app_key_set(u16_t net_idx, u16_t app_idx, const u8_t val[16],
         keys = &key->keys[0];
     }
 
-    if (bt_mesh_app_id(val, &keys->id)) {
+    if (bt_mesh_app_id(val, &keys->id) ||
+        bt_mesh_aes_key_expand(val, &keys->sched)) {
         if (update) {
             key->updated = false;
         }
@@ -1259,6 +1260,7 @@ static void mod_sub_list_clear(struct bt_mesh_model *mod)
 
     /* Clear all subscriptions (0x0000 is the unassigned address) */
     (void)memset(mod->groups, 0, sizeof(mod->groups));
+    bt_mesh_model_sub_changed();
 }
 
 static void mod_pub_va_set(struct bt_mesh_model *model,
@@ -1334,6 +1336,7 @@ static void mod_sub_list_clear(struct bt_mesh_model *mod)
 {
     /* Clear all subscriptions (0x0000 is the unassigned address) */
     (void)memset(mod->groups, 0, sizeof(mod->groups));
+    bt_mesh_model_sub_changed();
 }
 
 static void mod_pub_va_set(struct bt_mesh_model *model,
@@ -1474,6 +1477,8 @@ static void mod_sub_add(struct bt_mesh_model *model,
     } else {
         status = STATUS_SUCCESS;
 
+        bt_mesh_model_sub_changed();
+
         if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
             bt_mesh_store_mod_sub(mod);
         }
@@ -1544,6 +1549,8 @@ static void mod_sub_del(struct bt_mesh_model *model,
     if (match) {
         *match = BT_MESH_ADDR_UNASSIGNED;
 
+        bt_mesh_model_sub_changed();
+
         if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
             bt_mesh_store_mod_sub(mod);
         }
@@ -1606,6 +1613,8 @@ static void mod_sub_overwrite(struct bt_mesh_model *model,
         mod->groups[0] = sub_addr;
         status = STATUS_SUCCESS;
 
+        bt_mesh_model_sub_changed();
+
         if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
             bt_mesh_store_mod_sub(mod);
         }
@@ -1858,6 +1867,8 @@ static void mod_sub_va_add(struct bt_mesh_model *model,
             bt_mesh_lpn_group_add(sub_addr);
         }
 
+        bt_mesh_model_sub_changed();
+
         if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
             bt_mesh_store_mod_sub(mod);
         }
@@ -1925,6 +1936,8 @@ static void mod_sub_va_del(struct bt_mesh_model *model,
     if (match) {
         *match = BT_MESH_ADDR_UNASSIGNED;
 
+        bt_mesh_model_sub_changed();
+
         if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
             bt_mesh_store_mod_sub(mod);
         }
@@ -1989,6 +2002,8 @@ static void mod_sub_va_overwrite(struct bt_mesh_model *model,
         if (status == STATUS_SUCCESS) {
             mod->groups[0] = sub_addr;
 
+            bt_mesh_model_sub_changed();
+
             if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
                 bt_mesh_store_mod_sub(mod);
             }
@@ -3560,4 +3575,6 @@ void bt_mesh_subnet_del(struct bt_mesh_subnet *sub, bool store)
 
     (void)memset(sub, 0, sizeof(*sub));
     sub->net_idx = BT_MESH_KEY_UNUSED;
+
+    bt_mesh_net_nid_map_invalidate();
 }
@@ -211,7 +211,28 @@ int bt_mesh_id128(const u8_t n[16], const char *s, u8_t out[16])
     return bt_mesh_k1(n, 16, salt, id128, out);
 }
 
-static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
+static int aes_encrypt_sched(struct tc_aes_key_sched_struct *sched,
+                             const u8_t plaintext[16], u8_t enc_data[16])
+{
+    if (tc_aes_encrypt(enc_data, plaintext, sched) == TC_CRYPTO_FAIL) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int bt_mesh_aes_key_expand(const u8_t key[16],
+                           struct tc_aes_key_sched_struct *sched)
+{
+    if (tc_aes128_set_encrypt_key(sched, key) == TC_CRYPTO_FAIL) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int bt_mesh_ccm_decrypt(struct tc_aes_key_sched_struct *sched,
+                               u8_t nonce[13],
                                const u8_t *enc_msg, size_t msg_len,
                                const u8_t *aad, size_t aad_len,
                                u8_t *out_msg, size_t mic_size)
@@ -230,7 +251,7 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
     memcpy(pmsg + 1, nonce, 13);
     sys_put_be16(0x0000, pmsg + 14);
 
-    err = bt_encrypt_be(key, pmsg, cmic);
+    err = aes_encrypt_sched(sched, pmsg, cmic);
     if (err) {
         return err;
     }
@@ -245,7 +266,7 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
     memcpy(pmsg + 1, nonce, 13);
     sys_put_be16(msg_len, pmsg + 14);
 
-    err = bt_encrypt_be(key, pmsg, Xn);
+    err = aes_encrypt_sched(sched, pmsg, Xn);
     if (err) {
         return err;
     }
@@ -269,7 +290,7 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
             aad_len -= 16;
             i = 0;
 
-            err = bt_encrypt_be(key, pmsg, Xn);
+            err = aes_encrypt_sched(sched, pmsg, Xn);
             if (err) {
                 return err;
             }
@@ -283,7 +304,7 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
             pmsg[i] = Xn[i];
         }
 
-        err = bt_encrypt_be(key, pmsg, Xn);
+        err = aes_encrypt_sched(sched, pmsg, Xn);
         if (err) {
             return err;
         }
@@ -302,7 +323,7 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
             memcpy(pmsg + 1, nonce, 13);
             sys_put_be16(j + 1, pmsg + 14);
 
-            err = bt_encrypt_be(key, pmsg, cmsg);
+            err = aes_encrypt_sched(sched, pmsg, cmsg);
             if (err) {
                 return err;
             }
@@ -323,7 +344,7 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
                 pmsg[i] = Xn[i] ^ 0x00;
             }
 
-            err = bt_encrypt_be(key, pmsg, Xn);
+            err = aes_encrypt_sched(sched, pmsg, Xn);
             if (err) {
                 return err;
             }
@@ -338,7 +359,7 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
             memcpy(pmsg + 1, nonce, 13);
             sys_put_be16(j + 1, pmsg + 14);
 
-            err = bt_encrypt_be(key, pmsg, cmsg);
+            err = aes_encrypt_sched(sched, pmsg, cmsg);
             if (err) {
                 return err;
             }
@@ -355,7 +376,7 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
                 pmsg[i] = Xn[i] ^ msg[i];
             }
 
-            err = bt_encrypt_be(key, pmsg, Xn);
+            err = aes_encrypt_sched(sched, pmsg, Xn);
             if (err) {
                 return err;
             }
@@ -369,7 +390,8 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
     return 0;
 }
 
-static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
+static int bt_mesh_ccm_encrypt(struct tc_aes_key_sched_struct *sched,
+                               u8_t nonce[13],
                                const u8_t *msg, size_t msg_len,
                                const u8_t *aad, size_t aad_len,
                                u8_t *out_msg, size_t mic_size)
@@ -379,7 +401,6 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
     size_t i, j;
     int err;
 
-    BT_DBG("key %s", bt_hex(key, 16));
     BT_DBG("nonce %s", bt_hex(nonce, 13));
     BT_DBG("msg (len %u) %s", msg_len, bt_hex(msg, msg_len));
     BT_DBG("aad_len %u mic_size %u", aad_len, mic_size);
@@ -394,7 +415,7 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
     memcpy(pmsg + 1, nonce, 13);
     sys_put_be16(0x0000, pmsg + 14);
 
-    err = bt_encrypt_be(key, pmsg, cmic);
+    err = aes_encrypt_sched(sched, pmsg, cmic);
     if (err) {
         return err;
     }
@@ -409,7 +430,7 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
     memcpy(pmsg + 1, nonce, 13);
     sys_put_be16(msg_len, pmsg + 14);
 
-    err = bt_encrypt_be(key, pmsg, Xn);
+    err = aes_encrypt_sched(sched, pmsg, Xn);
     if (err) {
         return err;
     }
@@ -433,7 +454,7 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
             aad_len -= 16;
             i = 0;
 
-            err = bt_encrypt_be(key, pmsg, Xn);
+            err = aes_encrypt_sched(sched, pmsg, Xn);
             if (err) {
                 return err;
             }
@@ -447,7 +468,7 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
             pmsg[i] = Xn[i];
         }
 
-        err = bt_encrypt_be(key, pmsg, Xn);
+        err = aes_encrypt_sched(sched, pmsg, Xn);
         if (err) {
             return err;
         }
@@ -469,7 +490,7 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
                 pmsg[i] = Xn[i] ^ 0x00;
             }
 
-            err = bt_encrypt_be(key, pmsg, Xn);
+            err = aes_encrypt_sched(sched, pmsg, Xn);
             if (err) {
                 return err;
             }
@@ -484,7 +505,7 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
             memcpy(pmsg + 1, nonce, 13);
             sys_put_be16(j + 1, pmsg + 14);
 
-            err = bt_encrypt_be(key, pmsg, cmsg);
+            err = aes_encrypt_sched(sched, pmsg, cmsg);
             if (err) {
                 return err;
             }
@@ -500,7 +521,7 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
                 pmsg[i] = Xn[i] ^ msg[(j * 16) + i];
             }
 
-            err = bt_encrypt_be(key, pmsg, Xn);
+            err = aes_encrypt_sched(sched, pmsg, Xn);
             if (err) {
                 return err;
             }
@@ -510,7 +531,7 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
             memcpy(pmsg + 1, nonce, 13);
             sys_put_be16(j + 1, pmsg + 14);
 
-            err = bt_encrypt_be(key, pmsg, cmsg);
+            err = aes_encrypt_sched(sched, pmsg, cmsg);
             if (err) {
                 return err;
             }
@@ -584,20 +605,20 @@ static void create_net_nonce(u8_t nonce[13], const u8_t *pdu,
 }
 
 int bt_mesh_net_obfuscate(u8_t *pdu, u32_t iv_index,
-                          const u8_t privacy_key[16])
+                          struct tc_aes_key_sched_struct *privacy)
 {
     u8_t priv_rand[16] = { 0x00, 0x00, 0x00, 0x00, 0x00, };
     u8_t tmp[16];
     int err, i;
 
-    BT_DBG("IVIndex %u, PrivacyKey %s", iv_index, bt_hex(privacy_key, 16));
+    BT_DBG("IVIndex %u", iv_index);
 
     sys_put_be32(iv_index, &priv_rand[5]);
     memcpy(&priv_rand[9], &pdu[7], 7);
 
     BT_DBG("PrivacyRandom %s", bt_hex(priv_rand, 16));
 
-    err = bt_encrypt_be(privacy_key, priv_rand, tmp);
+    err = aes_encrypt_sched(privacy, priv_rand, tmp);
     if (err) {
         return err;
     }
@@ -609,15 +630,14 @@ int bt_mesh_net_obfuscate(u8_t *pdu, u32_t iv_index,
     return 0;
 }
 
-int bt_mesh_net_encrypt(const u8_t key[16], struct net_buf_simple *buf,
-                        u32_t iv_index, bool proxy)
+int bt_mesh_net_encrypt(struct tc_aes_key_sched_struct *enc,
+                        struct net_buf_simple *buf, u32_t iv_index, bool proxy)
 {
     u8_t mic_len = NET_MIC_LEN(buf->data);
     u8_t nonce[13];
     int err;
 
-    BT_DBG("IVIndex %u EncKey %s mic_len %u", iv_index, bt_hex(key, 16),
-           mic_len);
+    BT_DBG("IVIndex %u mic_len %u", iv_index, mic_len);
     BT_DBG("PDU (len %u) %s", buf->len, bt_hex(buf->data, buf->len));
 
 #if defined(CONFIG_BT_MESH_PROXY)
@@ -632,7 +652,7 @@ int bt_mesh_net_encrypt(const u8_t key[16], struct net_buf_simple *buf,
 
     BT_DBG("Nonce %s", bt_hex(nonce, 13));
 
-    err = bt_mesh_ccm_encrypt(key, nonce, &buf->data[7], buf->len - 7,
+    err = bt_mesh_ccm_encrypt(enc, nonce, &buf->data[7], buf->len - 7,
                               NULL, 0, &buf->data[7], mic_len);
     if (!err) {
         net_buf_simple_add(buf, mic_len);
@@ -641,15 +661,14 @@ int bt_mesh_net_encrypt(const u8_t key[16], struct net_buf_simple *buf,
     return err;
 }
 
-int bt_mesh_net_decrypt(const u8_t key[16], struct net_buf_simple *buf,
-                        u32_t iv_index, bool proxy)
+int bt_mesh_net_decrypt(struct tc_aes_key_sched_struct *enc,
+                        struct net_buf_simple *buf, u32_t iv_index, bool proxy)
 {
     u8_t mic_len = NET_MIC_LEN(buf->data);
     u8_t nonce[13];
 
     BT_DBG("PDU (%u bytes) %s", buf->len, bt_hex(buf->data, buf->len));
-    BT_DBG("iv_index %u, key %s mic_len %u", iv_index, bt_hex(key, 16),
-           mic_len);
+    BT_DBG("iv_index %u, mic_len %u", iv_index, mic_len);
 
 #if defined(CONFIG_BT_MESH_PROXY)
     if (proxy) {
@@ -665,7 +684,7 @@ int bt_mesh_net_decrypt(const u8_t key[16], struct net_buf_simple *buf,
 
     buf->len -= mic_len;
 
-    return bt_mesh_ccm_decrypt(key, nonce, &buf->data[7], buf->len - 7,
+    return bt_mesh_ccm_decrypt(enc, nonce, &buf->data[7], buf->len - 7,
                                NULL, 0, &buf->data[7], mic_len);
 }
 
@@ -687,14 +706,14 @@ static void create_app_nonce(u8_t nonce[13], bool dev_key, u8_t aszmic,
     sys_put_be32(iv_index, &nonce[9]);
 }
 
-int bt_mesh_app_encrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
+int bt_mesh_app_encrypt(struct tc_aes_key_sched_struct *key,
+                        bool dev_key, u8_t aszmic,
                         struct net_buf_simple *buf, const u8_t *ad,
                         u16_t src, u16_t dst, u32_t seq_num, u32_t iv_index)
 {
     u8_t nonce[13];
     int err;
 
-    BT_DBG("AppKey %s", bt_hex(key, 16));
     BT_DBG("dev_key %u src 0x%04x dst 0x%04x", dev_key, src, dst);
     BT_DBG("seq_num 0x%08x iv_index 0x%08x", seq_num, iv_index);
     BT_DBG("Clear: %s", bt_hex(buf->data, buf->len));
@@ -713,7 +732,8 @@ int bt_mesh_app_encrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
     return err;
 }
 
-int bt_mesh_app_decrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
+int bt_mesh_app_decrypt(struct tc_aes_key_sched_struct *key,
+                        bool dev_key, u8_t aszmic,
                         struct net_buf_simple *buf, struct net_buf_simple *out,
                         const u8_t *ad, u16_t src, u16_t dst, u32_t seq_num,
                         u32_t iv_index)
@@ -725,7 +745,6 @@ int bt_mesh_app_decrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
 
     create_app_nonce(nonce, dev_key, aszmic, src, dst, seq_num, iv_index);
 
-    BT_DBG("AppKey %s", bt_hex(key, 16));
     BT_DBG("Nonce  %s", bt_hex(nonce, 13));
 
     err = bt_mesh_ccm_decrypt(key, nonce, buf->data, buf->len, ad,
@@ -855,7 +874,29 @@ int bt_mesh_prov_conf(const u8_t conf_key[16], const u8_t rand[16],
 int bt_mesh_prov_decrypt(const u8_t key[16], u8_t nonce[13],
                          const u8_t data[25 + 8], u8_t out[25])
 {
-    return bt_mesh_ccm_decrypt(key, nonce, data, 25, NULL, 0, out, 8);
+    struct tc_aes_key_sched_struct sched;
+    int err;
+
+    err = bt_mesh_aes_key_expand(key, &sched);
+    if (err) {
+        return err;
+    }
+
+    return bt_mesh_ccm_decrypt(&sched, nonce, data, 25, NULL, 0, out, 8);
+}
+
+int bt_mesh_prov_encrypt(const u8_t key[16], u8_t nonce[13],
+                         const u8_t data[25], u8_t out[25 + 8])
+{
+    struct tc_aes_key_sched_struct sched;
+    int err;
+
+    err = bt_mesh_aes_key_expand(key, &sched);
+    if (err) {
+        return err;
+    }
+
+    return bt_mesh_ccm_encrypt(&sched, nonce, data, 25, NULL, 0, out, 8);
 }
 
 int bt_mesh_beacon_auth(const u8_t beacon_key[16], u8_t flags,
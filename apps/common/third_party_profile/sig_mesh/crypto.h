@@ -6,6 +6,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <tinycrypt/aes.h>
+
 struct bt_mesh_sg {
     const void *data;
     size_t len;
@@ -118,20 +120,29 @@ static inline int bt_mesh_prov_salt(const u8_t conf_salt[16],
     return bt_mesh_aes_cmac(prov_salt_key, sg, ARRAY_SIZE(sg), prov_salt);
 }
 
+/* Expand a 128-bit key into its AES round key schedule. The net, app and
+ * device keys keep their schedule next to the raw key so that the CCM and
+ * obfuscation helpers below never re-run the key expansion per block.
+ */
+int bt_mesh_aes_key_expand(const u8_t key[16],
+                           struct tc_aes_key_sched_struct *sched);
+
 int bt_mesh_net_obfuscate(u8_t *pdu, u32_t iv_index,
-                          const u8_t privacy_key[16]);
+                          struct tc_aes_key_sched_struct *privacy);
 
-int bt_mesh_net_encrypt(const u8_t key[16], struct net_buf_simple *buf,
-                        u32_t iv_index, bool proxy);
+int bt_mesh_net_encrypt(struct tc_aes_key_sched_struct *enc,
+                        struct net_buf_simple *buf, u32_t iv_index, bool proxy);
 
-int bt_mesh_net_decrypt(const u8_t key[16], struct net_buf_simple *buf,
-                        u32_t iv_index, bool proxy);
+int bt_mesh_net_decrypt(struct tc_aes_key_sched_struct *enc,
+                        struct net_buf_simple *buf, u32_t iv_index, bool proxy);
 
-int bt_mesh_app_encrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
+int bt_mesh_app_encrypt(struct tc_aes_key_sched_struct *key,
+                        bool dev_key, u8_t aszmic,
                         struct net_buf_simple *buf, const u8_t *ad,
                         u16_t src, u16_t dst, u32_t seq_num, u32_t iv_index);
 
-int bt_mesh_app_decrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
+int bt_mesh_app_decrypt(struct tc_aes_key_sched_struct *key,
+                        bool dev_key, u8_t aszmic,
                         struct net_buf_simple *buf, struct net_buf_simple *out,
                         const u8_t *ad, u16_t src, u16_t dst, u32_t seq_num,
                         u32_t iv_index);
@@ -153,5 +164,8 @@ int bt_mesh_prov_conf(const u8_t conf_key[16], const u8_t rand[16],
 int bt_mesh_prov_decrypt(const u8_t key[16], u8_t nonce[13],
                          const u8_t data[25 + 8], u8_t out[25]);
 
+int bt_mesh_prov_encrypt(const u8_t key[16], u8_t nonce[13],
+                         const u8_t data[25], u8_t out[25 + 8]);
+
 int bt_encrypt_be(const u8_t key[16], const u8_t plaintext[16],
                   u8_t enc_data[16]);
@@ -118,6 +118,7 @@ int bt_mesh_cfg_srv_init(struct bt_mesh_model *model, bool primary);
 int bt_mesh_health_srv_init(struct bt_mesh_model *model, bool primary);
 
 int bt_mesh_cfg_cli_init(struct bt_mesh_model *model, bool primary);
+void bt_mesh_cfg_cli_seg_tx_free(void);
 int bt_mesh_health_cli_init(struct bt_mesh_model *model, bool primary);
 
 void bt_mesh_cfg_reset(void);
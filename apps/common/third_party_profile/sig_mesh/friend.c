@@ -64,6 +64,17 @@
  */
 #define FRIEND_XMIT         BT_MESH_TRANSMIT(0, 20)
 
+#if (CONFIG_BT_MESH_FRIEND_QUEUE_MIN > CONFIG_BT_MESH_FRIEND_QUEUE_SIZE)
+#error "CONFIG_BT_MESH_FRIEND_QUEUE_MIN must not exceed the queue size"
+#endif
+
+/* Eviction order when the shared pool runs dry, lowest goes first */
+enum {
+    FRIEND_PRIO_DATA,   /* Unsegmented access or relayed data */
+    FRIEND_PRIO_SEG,    /* Segment of a complete segmented message */
+    FRIEND_PRIO_CTL,    /* Transport control: acks, Friend Update */
+};
+
 struct friend_pdu_info {
     u16_t  src;
     u16_t  dst;
@@ -84,6 +95,8 @@ NET_BUF_POOL_FIXED_DEFINE(friend_buf_pool, FRIEND_BUF_COUNT,
 static struct friend_adv {
     struct bt_mesh_adv adv;
     u64_t seq_auth;
+    u32_t enqueued;     /* k_uptime_get_32() when put in the Friend Queue */
+    u8_t  prio;
 } *adv_pool;
 
 #else
@@ -91,6 +104,8 @@ static struct friend_adv {
 static struct friend_adv {
     struct bt_mesh_adv adv;
     u64_t seq_auth;
+    u32_t enqueued;     /* k_uptime_get_32() when put in the Friend Queue */
+    u8_t  prio;
 } adv_pool[FRIEND_BUF_COUNT];
 
 #endif /* NET_BUF_USE_MALLOC */
@@ -100,47 +115,127 @@ static struct bt_mesh_adv *adv_alloc(int id)
     return &adv_pool[id].adv;
 }
 
-static void discard_buffer(void)
+/* Pool buffers held by an LPN: its queue, incomplete segmented messages
+ * and the last sent PDU.
+ */
+static u32_t friend_buf_usage(struct bt_mesh_friend *frnd)
 {
-    struct bt_mesh_friend *frnd = &bt_mesh.frnd[0];
-    struct net_buf *buf;
+    u32_t count = frnd->queue_size + (frnd->last ? 1 : 0);
+    sys_snode_t *node;
+    int i;
+
+    for (i = 0; i < FRIEND_SEG_RX; i++) {
+        SYS_SLIST_FOR_EACH_NODE(&frnd->seg[i].queue, node) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/* Take from the LPN furthest above its guaranteed share, so that one busy
+ * LPN cannot starve the others. Only if nobody is above it does the
+ * requester pay with its own queue, and only then anyone else.
+ */
+static struct bt_mesh_friend *discard_lpn_pick(struct bt_mesh_friend *req)
+{
+    struct bt_mesh_friend *frnd = NULL;
+    u32_t usage, over_max = 0;
     int i;
 
-    /* Find the Friend context with the most queued buffers */
-    for (i = 1; i < CONFIG_BT_MESH_FRIEND_LPN_COUNT; i++) {
-        if (bt_mesh.frnd[i].queue_size > frnd->queue_size) {
+    for (i = 0; i < CONFIG_BT_MESH_FRIEND_LPN_COUNT; i++) {
+        struct bt_mesh_friend *cur = &bt_mesh.frnd[i];
+
+        if (!cur->queue_size) {
+            continue;
+        }
+
+        usage = friend_buf_usage(cur);
+        if (usage > CONFIG_BT_MESH_FRIEND_QUEUE_MIN &&
+            usage - CONFIG_BT_MESH_FRIEND_QUEUE_MIN > over_max) {
+            over_max = usage - CONFIG_BT_MESH_FRIEND_QUEUE_MIN;
+            frnd = cur;
+        }
+    }
+
+    if (frnd) {
+        return frnd;
+    }
+
+    if (req && req->queue_size) {
+        return req;
+    }
+
+    for (i = 0; i < CONFIG_BT_MESH_FRIEND_LPN_COUNT; i++) {
+        if (bt_mesh.frnd[i].queue_size > (frnd ? frnd->queue_size : 0)) {
             frnd = &bt_mesh.frnd[i];
         }
     }
 
+    return frnd;
+}
+
+static bool discard_buffer(struct bt_mesh_friend *req)
+{
+    struct bt_mesh_friend *frnd;
+    sys_snode_t *cur, *prev = NULL;
+    sys_snode_t *victim = NULL, *victim_prev = NULL;
+    u8_t prio = FRIEND_PRIO_CTL + 1;
+    struct net_buf *buf;
+
+    frnd = discard_lpn_pick(req);
+    if (!frnd) {
+        return false;
+    }
+
+    /* Oldest PDU of the lowest priority */
+    for (cur = sys_slist_peek_head(&frnd->queue);
+         cur != NULL; prev = cur, cur = sys_slist_peek_next(cur)) {
+        buf = (void *)cur;
+
 #if NET_BUF_FREE_EN
-    struct net_buf *head_buf = sys_slist_peek_head(&frnd->queue);
-    if (head_buf && (head_buf->flags & NET_BUF_FRIEND_POLL_CACHE)) {
-        buf = sys_slist_peek_next(head_buf);
-        __ASSERT_NO_MSG(buf != NULL);
-        BT_WARN("Discarding none cahce buffer 0x%x for LPN 0x%04x", buf, frnd->lpn);
-        sys_slist_remove(&frnd->queue, head_buf, buf);
-        frnd->queue_size--;
-        buf->flags &= ~NET_BUF_FRIEND_QUEUE_CACHE;
-        net_buf_unref(buf);
-        return;
+        if (buf->flags & NET_BUF_FRIEND_POLL_CACHE) {
+            continue;
+        }
+#endif /* NET_BUF_FREE_EN */
+
+        if (FRIEND_ADV(buf)->prio < prio) {
+            prio = FRIEND_ADV(buf)->prio;
+            victim = cur;
+            victim_prev = prev;
+
+            if (prio == FRIEND_PRIO_DATA) {
+                break;
+            }
+        }
+    }
+
+    if (!victim) {
+        return false;
     }
 
+    buf = (void *)victim;
+    BT_WARN("Discarding buffer 0x%x (prio %u) for LPN 0x%04x", buf, prio,
+            frnd->lpn);
+
+    sys_slist_remove(&frnd->queue, victim_prev, victim);
     frnd->queue_size--;
-#endif /* NET_BUF_FREE_EN */
+    frnd->stats.dropped++;
 
-    buf = net_buf_slist_get(&frnd->queue);
-    __ASSERT_NO_MSG(buf != NULL);
-    BT_WARN("Discarding buffer 0x%x for LPN 0x%04x", buf, frnd->lpn);
+    /* Make sure old slist entry state doesn't remain */
+    buf->frags = NULL;
 
 #if NET_BUF_FREE_EN
     buf->flags &= ~NET_BUF_FRIEND_QUEUE_CACHE;
 #endif /* NET_BUF_FREE_EN */
 
     net_buf_unref(buf);
+
+    return true;
 }
 
-static struct net_buf *friend_buf_alloc(u16_t src)
+static struct net_buf *friend_buf_alloc(struct bt_mesh_friend *frnd,
+                                        u16_t src)
 {
     struct net_buf *buf;
 
@@ -151,13 +246,15 @@ static struct net_buf *friend_buf_alloc(u16_t src)
         buf = bt_mesh_adv_create_from_pool(&friend_buf_pool, adv_alloc,
                                            BT_MESH_ADV_DATA,
                                            FRIEND_XMIT, K_NO_WAIT);
-        if (!buf) {
-            discard_buffer();
+        if (!buf && !discard_buffer(frnd)) {
+            BT_ERR("Friend buffer pool exhausted");
+            return NULL;
         }
     } while (!buf);
 
     BT_MESH_ADV(buf)->addr = src;
     FRIEND_ADV(buf)->seq_auth = TRANS_SEQ_AUTH_NVAL;
+    FRIEND_ADV(buf)->prio = FRIEND_PRIO_DATA;
 
     BT_DBG("allocated buf addr 0x%x", buf);
 
@@ -392,19 +489,26 @@ static struct net_buf *create_friend_pdu(struct bt_mesh_friend *frnd,
         struct net_buf_simple *sdu)
 {
     struct bt_mesh_subnet *sub;
-    const u8_t *enc, *priv;
+    struct tc_aes_key_sched_struct *enc, *priv;
     struct net_buf *buf;
     u8_t nid;
 
     sub = bt_mesh_subnet_get(frnd->net_idx);
     __ASSERT_NO_MSG(sub != NULL);
 
-    buf = friend_buf_alloc(info->src);
+    buf = friend_buf_alloc(frnd, info->src);
+    if (!buf) {
+        return NULL;
+    }
+
+    if (info->ctl) {
+        FRIEND_ADV(buf)->prio = FRIEND_PRIO_CTL;
+    }
 
     /* Friend Offer needs master security credentials */
     if (info->ctl && TRANS_CTL_OP(sdu->data) == TRANS_CTL_OP_FRIEND_OFFER) {
-        enc = sub->keys[sub->kr_flag].enc;
-        priv = sub->keys[sub->kr_flag].privacy;
+        enc = &sub->keys[sub->kr_flag].enc;
+        priv = &sub->keys[sub->kr_flag].privacy;
         nid = sub->keys[sub->kr_flag].nid;
     } else {
         if (friend_cred_get(sub, frnd->lpn, &nid, &enc, &priv)) {
@@ -476,7 +580,9 @@ static struct net_buf *encode_friend_ctl(struct bt_mesh_friend *frnd,
 #if NET_BUF_FREE_EN
     struct net_buf *buf = create_friend_pdu(frnd, &info, sdu);
 
-    buf->flags |= NET_BUF_FRIEND_POLL_CACHE;
+    if (buf) {
+        buf->flags |= NET_BUF_FRIEND_POLL_CACHE;
+    }
 
     return buf;
 #else
@@ -616,13 +722,24 @@ int bt_mesh_friend_sub_rem(struct bt_mesh_net_rx *rx,
     return 0;
 }
 
+static void queue_account(struct bt_mesh_friend *frnd, struct net_buf *buf)
+{
+    FRIEND_ADV(buf)->enqueued = k_uptime_get_32();
+
+    frnd->queue_size++;
+    frnd->stats.enqueued++;
+    if (frnd->queue_size > frnd->stats.depth_max) {
+        frnd->stats.depth_max = frnd->queue_size;
+    }
+}
+
 static void enqueue_buf(struct bt_mesh_friend *frnd, struct net_buf *buf)
 {
     BT_INFO("--func=%s", __FUNCTION__);
 
     net_buf_slist_put(&frnd->queue, buf);
 
-    frnd->queue_size++;
+    queue_account(frnd, buf);
 }
 
 static void enqueue_update(struct bt_mesh_friend *frnd, u8_t md)
@@ -672,6 +789,7 @@ int bt_mesh_friend_poll(struct bt_mesh_net_rx *rx, struct net_buf_simple *buf)
 
     BT_DBG("msg->fsn %u frnd->fsn %u", (msg->fsn & 1), frnd->fsn);
 
+    frnd->poll_at = k_uptime_get_32();
     friend_recv_delay(frnd);
 
     if (!frnd->established) {
@@ -973,6 +1091,7 @@ int bt_mesh_friend_req(struct bt_mesh_net_rx *rx, struct net_buf_simple *buf)
     }
 
 init_friend:
+    (void)memset(&frnd->stats, 0, sizeof(frnd->stats));
     frnd->lpn = rx->ctx.addr;
     frnd->num_elem = msg->num_elem;
     frnd->net_idx = rx->sub->net_idx;
@@ -1065,7 +1184,10 @@ static void enqueue_friend_pdu(struct bt_mesh_friend *frnd,
          */
         SYS_SLIST_FOR_EACH_CONTAINER(&seg->queue, buf, node) {
             FRIEND_ADV(buf)->seq_auth = TRANS_SEQ_AUTH_NVAL;
-            frnd->queue_size++;
+            if (FRIEND_ADV(buf)->prio == FRIEND_PRIO_DATA) {
+                FRIEND_ADV(buf)->prio = FRIEND_PRIO_SEG;
+            }
+            queue_account(frnd, buf);
         }
 
         sys_slist_merge_slist(&frnd->queue, &seg->queue);
@@ -1118,6 +1240,31 @@ static void buf_send_end(int err, void *user_data)
     }
 }
 
+static void friend_delivered(struct bt_mesh_friend *frnd, struct net_buf *buf)
+{
+    u32_t wait = k_uptime_get_32() - FRIEND_ADV(buf)->enqueued;
+
+    frnd->stats.delivered++;
+    frnd->stats.wait_sum += wait;
+    if (wait > frnd->stats.wait_max) {
+        frnd->stats.wait_max = wait;
+    }
+}
+
+/* Time from the Friend Poll until its response goes to the advertiser:
+ * the ReceiveDelay plus whatever held up the timer.
+ */
+static void friend_poll_answered(struct bt_mesh_friend *frnd)
+{
+    u32_t latency = k_uptime_get_32() - frnd->poll_at;
+
+    frnd->stats.polls++;
+    frnd->stats.latency_sum += latency;
+    if (latency > frnd->stats.latency_max) {
+        frnd->stats.latency_max = latency;
+    }
+}
+
 static void friend_timeout(struct k_work *work)
 {
     struct bt_mesh_friend *frnd = CONTAINER_OF(work, struct bt_mesh_friend,
@@ -1159,12 +1306,19 @@ static void friend_timeout(struct k_work *work)
 #endif /* NET_BUF_FREE_EN */
 
     frnd->queue_size--;
+    friend_delivered(frnd, frnd->last);
     BT_DBG("Sending buf 0x%x from Friend Queue of LPN 0x%04x, queue_size %u",
            frnd->last, frnd->lpn, frnd->queue_size);
 
 send_last:
+    /* A Friend Offer is not an answer to a poll */
+    if (frnd->established) {
+        friend_poll_answered(frnd);
+    }
+
     frnd->pending_req = 0;
     frnd->pending_buf = 1;
+    BT_MESH_ADV(frnd->last)->origin = BT_MESH_ADV_ORIGIN_FRIEND;
     bt_mesh_adv_send(frnd->last, &buf_sent_cb, frnd);
 }
 
@@ -1193,6 +1347,42 @@ int bt_mesh_friend_init(void)
     return 0;
 }
 
+int bt_mesh_friend_lpn_stats_get(u16_t lpn_addr,
+                                 struct bt_mesh_friend_lpn_stats *stats)
+{
+    int i;
+
+    for (i = 0; i < CONFIG_BT_MESH_FRIEND_LPN_COUNT; i++) {
+        struct bt_mesh_friend *frnd = &bt_mesh.frnd[i];
+
+        if (frnd->valid && frnd->lpn == lpn_addr) {
+            *stats = frnd->stats;
+            return 0;
+        }
+    }
+
+    return -ENOENT;
+}
+
+void bt_mesh_friend_lpn_stats_reset(void)
+{
+    int i;
+
+    for (i = 0; i < CONFIG_BT_MESH_FRIEND_LPN_COUNT; i++) {
+        (void)memset(&bt_mesh.frnd[i].stats, 0, sizeof(bt_mesh.frnd[i].stats));
+    }
+}
+
+void bt_mesh_friend_buf_stats_get(struct net_buf_pool_stats *stats)
+{
+    net_buf_pool_stats_get(&friend_buf_pool, stats);
+}
+
+void bt_mesh_friend_buf_stats_reset(void)
+{
+    net_buf_pool_stats_reset(&friend_buf_pool);
+}
+
 static void friend_purge_old_ack(struct bt_mesh_friend *frnd, u64_t *seq_auth,
                                  u16_t src)
 {
@@ -1472,6 +1662,8 @@ void bt_mesh_friend_buf_alloc(void)
     u32 buf_size;
     u32 net_buf_p, net_buf_data_p, adv_pool_p;
     u32 frnd_p, sub_list_p, seg_p, frnd_cred_p;
+    u32 sub_list_size = ALIGN_4BYTE(FRIEND_SUB_LIST_SIZE * sizeof(u16_t));
+    u32 seg_size = sizeof(struct bt_mesh_friend_seg) * FRIEND_SEG_RX;
 
     buf_size = sizeof(struct net_buf) * FRIEND_BUF_COUNT;
     BT_DBG("net_buf size=0x%x", buf_size);
@@ -1485,11 +1677,11 @@ void bt_mesh_friend_buf_alloc(void)
     buf_size += (sizeof(struct bt_mesh_friend) * CONFIG_BT_MESH_FRIEND_LPN_COUNT);
     BT_DBG("frnd size=0x%x", sizeof(struct bt_mesh_friend) * CONFIG_BT_MESH_FRIEND_LPN_COUNT);
     sub_list_p = buf_size;
-    buf_size += ALIGN_4BYTE(FRIEND_SUB_LIST_SIZE * sizeof(u16_t));
-    BT_DBG("sub_list size=0x%x", ALIGN_4BYTE(FRIEND_SUB_LIST_SIZE * sizeof(u16_t)));
+    buf_size += sub_list_size * CONFIG_BT_MESH_FRIEND_LPN_COUNT;
+    BT_DBG("sub_list size=0x%x", sub_list_size * CONFIG_BT_MESH_FRIEND_LPN_COUNT);
     seg_p = buf_size;
-    buf_size += (sizeof(struct bt_mesh_friend_seg) * FRIEND_SEG_RX);
-    BT_DBG("seg size=0x%x", sizeof(struct bt_mesh_friend_seg) * FRIEND_SEG_RX);
+    buf_size += seg_size * CONFIG_BT_MESH_FRIEND_LPN_COUNT;
+    BT_DBG("seg size=0x%x", seg_size * CONFIG_BT_MESH_FRIEND_LPN_COUNT);
     frnd_cred_p = buf_size;
     buf_size += bt_mesh_friend_cred_size_need();
     BT_DBG("frnd_cred size=0x%x", bt_mesh_friend_cred_size_need());
@@ -1510,9 +1702,10 @@ void bt_mesh_friend_buf_alloc(void)
                    FRIEND_BUF_COUNT);
 
     bt_mesh.frnd = (struct bt_mesh_friend *)frnd_p;
+    /* Every LPN needs its own subscription list and segment queues */
     for (int i = 0; i < CONFIG_BT_MESH_FRIEND_LPN_COUNT; i++) {
-        bt_mesh.frnd[i].sub_list = (u16_t *)sub_list_p;
-        bt_mesh.frnd[i].seg = (struct bt_mesh_friend_seg *)seg_p;
+        bt_mesh.frnd[i].sub_list = (u16_t *)(sub_list_p + i * sub_list_size);
+        bt_mesh.frnd[i].seg = (struct bt_mesh_friend_seg *)(seg_p + i * seg_size);
     }
 
     bt_mesh_friend_cred_malloc((void *)frnd_cred_p);
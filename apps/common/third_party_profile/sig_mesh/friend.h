@@ -42,3 +42,12 @@ int bt_mesh_friend_sub_rem(struct bt_mesh_net_rx *rx,
                            struct net_buf_simple *buf);
 
 int bt_mesh_friend_init(void);
+
+int bt_mesh_friend_lpn_stats_get(u16_t lpn_addr,
+                                 struct bt_mesh_friend_lpn_stats *stats);
+void bt_mesh_friend_lpn_stats_reset(void);
+
+struct net_buf_pool_stats;
+
+void bt_mesh_friend_buf_stats_get(struct net_buf_pool_stats *stats);
+void bt_mesh_friend_buf_stats_reset(void);
@@ -78,6 +78,14 @@
 
 #define CLEAR_ATTEMPTS        2
 
+/* Shortest interval the poll scheduler picks on its own */
+#define POLL_TIMEOUT_MIN      K_SECONDS(1)
+
+/* An own transmission takes the next poll along when that poll is due
+ * within 1/POLL_BATCH_DIV of the current poll interval.
+ */
+#define POLL_BATCH_DIV        2
+
 #define LPN_CRITERIA ((CONFIG_BT_MESH_LPN_MIN_QUEUE_SIZE) | \
               (CONFIG_BT_MESH_LPN_RSSI_FACTOR << 3) | \
               (CONFIG_BT_MESH_LPN_RECV_WIN_FACTOR << 5))
@@ -90,6 +98,9 @@
 
 static void (*lpn_cb)(u16_t friend_addr, bool established);
 
+static struct bt_mesh_lpn_stats lpn_stats;
+static u32_t lpn_stats_since;
+
 #if defined(CONFIG_BT_MESH_DEBUG_LOW_POWER)
 static const char *state2str(int state)
 {
@@ -165,6 +176,30 @@ static inline void group_clear(atomic_tt *target, atomic_tt *source)
 #endif
 }
 
+/* Scanning is where an LPN spends its radio time, so account for it */
+static void lpn_scan_enable(void)
+{
+    struct bt_mesh_lpn *lpn = &bt_mesh.lpn;
+
+    if (!lpn->scan_start) {
+        lpn->scan_start = k_uptime_get_32() | 1;
+    }
+
+    bt_mesh_scan_enable();
+}
+
+static void lpn_scan_disable(void)
+{
+    struct bt_mesh_lpn *lpn = &bt_mesh.lpn;
+
+    if (lpn->scan_start) {
+        lpn_stats.radio_ms += k_uptime_get_32() - lpn->scan_start;
+        lpn->scan_start = 0;
+    }
+
+    bt_mesh_scan_disable();
+}
+
 static void clear_friendship(bool force, bool disable);
 
 static void friend_clear_sent(int err, void *user_data)
@@ -174,7 +209,7 @@ static void friend_clear_sent(int err, void *user_data)
     /* We're switching away from Low Power behavior, so permanently
      * enable scanning.
      */
-    bt_mesh_scan_enable();
+    lpn_scan_enable();
 
     lpn->req_attempts++;
 
@@ -234,7 +269,7 @@ static void clear_friendship(bool force, bool disable)
     }
 
     if (IS_ENABLED(CONFIG_BT_MESH_LPN_ESTABLISHMENT)) {
-        bt_mesh_scan_disable();
+        lpn_scan_disable();
     }
 
     bt_mesh_rx_reset();
@@ -262,6 +297,9 @@ static void clear_friendship(bool force, bool disable)
     lpn->sent_req = 0;
     lpn->established = 0;
     lpn->clear_success = 0;
+    lpn->poll_rx = 0;
+    lpn->last_rx = 0;
+    lpn->rx_gap = 0;
 
     group_zero(lpn->added);
     group_zero(lpn->pending);
@@ -294,6 +332,7 @@ static void friend_req_sent(u16_t duration, int err, void *user_data)
     }
 
     lpn->adv_duration = duration;
+    lpn_stats.radio_ms += duration;
 
     if (IS_ENABLED(CONFIG_BT_MESH_LPN_ESTABLISHMENT)) {
         //< 3.6.6.4.1 Low Power establishment
@@ -361,6 +400,7 @@ static void req_sent(u16_t duration, int err, void *user_data)
 
     lpn->req_attempts++;
     lpn->adv_duration = duration;
+    lpn_stats.radio_ms += duration;
 
     if (lpn->established || IS_ENABLED(CONFIG_BT_MESH_LPN_ESTABLISHMENT)) {
         lpn_set_state(BT_MESH_LPN_RECV_DELAY);
@@ -416,6 +456,7 @@ static int send_friend_poll(void)
     if (err == 0) {
         lpn->pending_poll = 0;
         lpn->sent_req = TRANS_CTL_OP_FRIEND_POLL;
+        lpn_stats.polls++;
     }
 
     return err;
@@ -460,7 +501,7 @@ int bt_mesh_lpn_set(bool enable)
         lpn_set_state(BT_MESH_LPN_ENABLED);
 
         if (IS_ENABLED(CONFIG_BT_MESH_LPN_ESTABLISHMENT)) {
-            bt_mesh_scan_disable();
+            lpn_scan_disable();
         }
 
         send_friend_req(lpn);
@@ -486,7 +527,7 @@ static void friend_response_received(struct bt_mesh_lpn *lpn)
     }
 
     k_delayed_work_cancel(&lpn->timer);
-    bt_mesh_scan_disable();
+    lpn_scan_disable();
     lpn_set_state(BT_MESH_LPN_ESTABLISHED);
     lpn->req_attempts = 0;
     lpn->sent_req = 0;
@@ -507,6 +548,23 @@ void bt_mesh_lpn_msg_received(struct bt_mesh_net_rx *rx)
         return;
     }
 
+    lpn_stats.delivered++;
+
+    /* Only the first message of a cycle says when traffic arrives; the
+     * rest of a More Data burst was just waiting in the Friend Queue.
+     */
+    if (!lpn->poll_rx++) {
+        u32_t now = k_uptime_get_32();
+
+        if (lpn->last_rx) {
+            u32_t gap = now - lpn->last_rx;
+
+            lpn->rx_gap = lpn->rx_gap ? (3 * lpn->rx_gap + gap) / 4 : gap;
+        }
+
+        lpn->last_rx = now;
+    }
+
     friend_response_received(lpn);
 
     BT_DBG("Requesting more messages from Friend");
@@ -748,12 +806,12 @@ static void update_timeout(struct bt_mesh_lpn *lpn)
 {
     if (lpn->established) {
         BT_WARN("No response from Friend during ReceiveWindow");
-        bt_mesh_scan_disable();
+        lpn_scan_disable();
         lpn_set_state(BT_MESH_LPN_ESTABLISHED);
         k_delayed_work_submit(&lpn->timer, POLL_RETRY_TIMEOUT);
     } else {
         if (IS_ENABLED(CONFIG_BT_MESH_LPN_ESTABLISHMENT)) {
-            bt_mesh_scan_disable();
+            lpn_scan_disable();
         }
 
         if (lpn->req_attempts < 6) {
@@ -790,7 +848,7 @@ static void lpn_timeout(struct k_work *work)
         BT_DBG("Starting to look for Friend nodes");
         lpn_set_state(BT_MESH_LPN_ENABLED);
         if (IS_ENABLED(CONFIG_BT_MESH_LPN_ESTABLISHMENT)) {
-            bt_mesh_scan_disable();
+            lpn_scan_disable();
         }
     /* fall through */
     case BT_MESH_LPN_ENABLED:
@@ -801,7 +859,7 @@ static void lpn_timeout(struct k_work *work)
     case BT_MESH_LPN_REQ_WAIT:
         BT_DBG("BT_MESH_LPN_REQ_WAIT");
         LPN_REQ_IO_1();
-        bt_mesh_scan_enable();
+        lpn_scan_enable();
         //< 3.6.6.4.1 Low Power establishment
         //the node should listen for up to 1 second for the Friend Offer messages sent by potential Friend nodes
         k_delayed_work_submit(&lpn->timer,
@@ -813,7 +871,7 @@ static void lpn_timeout(struct k_work *work)
         BT_DBG("BT_MESH_LPN_WAIT_OFFER");
         BT_WARN("No acceptable Friend Offers received");
         if (IS_ENABLED(CONFIG_BT_MESH_LPN_ESTABLISHMENT)) {
-            bt_mesh_scan_disable();
+            lpn_scan_disable();
         }
         //< 3.6.6.4.1 Low Power establishment
         //After each Friend Request message is sent, this value shall be incremented by 1.
@@ -854,7 +912,7 @@ static void lpn_timeout(struct k_work *work)
         k_delayed_work_submit(&lpn->timer,
                               lpn->adv_duration + SCAN_LATENCY +
                               lpn->recv_win);
-        bt_mesh_scan_enable();
+        lpn_scan_enable();
         lpn_set_state(BT_MESH_LPN_WAIT_UPDATE);
         break;
     case BT_MESH_LPN_WAIT_UPDATE:
@@ -907,17 +965,27 @@ void bt_mesh_lpn_group_del(u16_t *groups, size_t group_count)
 
 static s32_t poll_timeout(struct bt_mesh_lpn *lpn)
 {
+    s32_t timeout_max = POLL_TIMEOUT_MAX(lpn);
+
     /* If we're waiting for segment acks keep polling at high freq */
     if (bt_mesh_tx_in_progress()) {
-        return min(POLL_TIMEOUT_MAX(lpn), K_SECONDS(1));
+        return min(timeout_max, K_SECONDS(1));
     }
 
-    if (lpn->poll_timeout < POLL_TIMEOUT_MAX(lpn)) {
+    if (lpn->poll_rx && lpn->rx_gap) {
+        /* Traffic is flowing: poll about when the next message is due */
+        lpn->poll_timeout = max(lpn->rx_gap, POLL_TIMEOUT_MIN);
+    } else if (lpn->poll_timeout < timeout_max) {
         lpn->poll_timeout *= 2;
-        lpn->poll_timeout = min(lpn->poll_timeout,
-                                POLL_TIMEOUT_MAX(lpn));
     }
 
+    if (lpn->traffic_hint && lpn->poll_timeout > lpn->traffic_hint) {
+        lpn->poll_timeout = max(lpn->traffic_hint, POLL_TIMEOUT_MIN);
+    }
+
+    lpn->poll_timeout = min(lpn->poll_timeout, timeout_max);
+    lpn->poll_rx = 0;
+
     BT_DBG("Poll Timeout is %ums", lpn->poll_timeout);
 
     return lpn->poll_timeout;
@@ -1072,6 +1140,8 @@ int bt_mesh_lpn_friend_update(struct bt_mesh_net_rx *rx,
     if (msg->md) {
         BT_DBG("Requesting for more messages");
         send_friend_poll();
+    } else if (!lpn->poll_rx) {
+        lpn_stats.empty++;
     }
 
     if (!lpn->sent_req) {
@@ -1092,11 +1162,75 @@ int bt_mesh_lpn_poll(void)
     return send_friend_poll();
 }
 
+void bt_mesh_lpn_msg_sent(void)
+{
+    struct bt_mesh_lpn *lpn = &bt_mesh.lpn;
+    u32_t remaining;
+
+    if (lpn->state != BT_MESH_LPN_ESTABLISHED || lpn->sent_req) {
+        return;
+    }
+
+    /* The radio is up for this transmission anyway, so let the poll that
+     * is due soon ride along instead of waking up again for it.
+     */
+    remaining = k_delayed_work_remaining_get(&lpn->timer);
+    if (!remaining || remaining > lpn->poll_timeout / POLL_BATCH_DIV) {
+        return;
+    }
+
+    BT_DBG("Poll moved up by %u ms", remaining);
+
+    if (!send_friend_poll()) {
+        lpn_stats.batched++;
+    }
+}
+
+void bt_mesh_lpn_traffic_hint(u32_t period_ms)
+{
+    bt_mesh.lpn.traffic_hint = period_ms;
+}
+
 void bt_mesh_lpn_set_cb(void (*cb)(u16_t friend_addr, bool established))
 {
     lpn_cb = cb;
 }
 
+void bt_mesh_lpn_stats_get(struct bt_mesh_lpn_stats *stats)
+{
+    struct bt_mesh_lpn *lpn = &bt_mesh.lpn;
+    u32_t now = k_uptime_get_32();
+
+    *stats = lpn_stats;
+
+    /* Include a scan that is still running */
+    if (lpn->scan_start) {
+        stats->radio_ms += now - lpn->scan_start;
+    }
+
+    stats->elapsed_ms = now - lpn_stats_since;
+    if (stats->elapsed_ms) {
+        stats->radio_ms_per_hour = (u64_t)stats->radio_ms * 3600000 /
+                                   stats->elapsed_ms;
+    }
+
+    if (stats->delivered) {
+        stats->polls_per_msg_x100 = stats->polls * 100 / stats->delivered;
+    }
+}
+
+void bt_mesh_lpn_stats_reset(void)
+{
+    struct bt_mesh_lpn *lpn = &bt_mesh.lpn;
+
+    (void)memset(&lpn_stats, 0, sizeof(lpn_stats));
+    lpn_stats_since = k_uptime_get_32();
+
+    if (lpn->scan_start) {
+        lpn->scan_start = lpn_stats_since | 1;
+    }
+}
+
 static void lpn_sub_add(struct bt_mesh_model *mod, struct bt_mesh_elem *elem,
                         bool vnd, bool primary, void *user_data)
 {
@@ -1119,14 +1253,14 @@ int bt_mesh_lpn_init(void)
 
     if (lpn->state == BT_MESH_LPN_ENABLED) {
         if (IS_ENABLED(CONFIG_BT_MESH_LPN_ESTABLISHMENT)) {
-            bt_mesh_scan_disable();
+            lpn_scan_disable();
         } else {
-            bt_mesh_scan_enable();
+            lpn_scan_enable();
         }
 
         send_friend_req(lpn);
     } else {
-        bt_mesh_scan_enable();
+        lpn_scan_enable();
 
         if (IS_ENABLED(CONFIG_BT_MESH_LPN_AUTO)) {
             BT_DBG("Waiting %u ms for messages", LPN_AUTO_TIMEOUT);
@@ -55,6 +55,7 @@ static inline bool bt_mesh_lpn_timer(void)
 }
 
 void bt_mesh_lpn_msg_received(struct bt_mesh_net_rx *rx);
+void bt_mesh_lpn_msg_sent(void);
 
 void bt_mesh_lpn_group_add(u16_t group);
 void bt_mesh_lpn_group_del(u16_t *groups, size_t group_count);
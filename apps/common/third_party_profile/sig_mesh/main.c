@@ -8,6 +8,7 @@
 
 #include "adaptation.h"
 #include "adv.h"
+#include "crypto.h"
 #include "prov.h"
 #include "net.h"
 #include "beacon.h"
@@ -57,8 +58,13 @@ int bt_mesh_provision(const u8_t net_key[16], u16_t net_idx,
         bt_mesh_proxy_prov_disable(false);
     }
 
-    /* create 'Secure Network beacon' PDU of 'Mesh beacons' */
-    err = bt_mesh_net_create(net_idx, flags, net_key, iv_index);
+    memcpy(bt_mesh.dev_key, dev_key, 16);
+    err = bt_mesh_aes_key_expand(bt_mesh.dev_key, &bt_mesh.dev_key_sched);
+    if (!err) {
+        /* create 'Secure Network beacon' PDU of 'Mesh beacons' */
+        err = bt_mesh_net_create(net_idx, flags, net_key, iv_index);
+    }
+
     if (err) {
         if (IS_ENABLED(CONFIG_BT_MESH_PB_GATT)) {
             bt_mesh_proxy_prov_enable();
@@ -71,8 +77,6 @@ int bt_mesh_provision(const u8_t net_key[16], u16_t net_idx,
 
     bt_mesh_comp_provision(addr);
 
-    memcpy(bt_mesh.dev_key, dev_key, 16);
-
     if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
         BT_DBG("Storing network information persistently");
         bt_mesh_store_net();
@@ -120,9 +124,12 @@ void bt_mesh_reset(void)
 
     if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
         bt_mesh_clear_net();
+        /* Apps usually reboot right after a node reset */
+        bt_mesh_settings_flush();
     }
 
     (void)memset(bt_mesh.dev_key, 0, sizeof(bt_mesh.dev_key));
+    (void)memset(&bt_mesh.dev_key_sched, 0, sizeof(bt_mesh.dev_key_sched));
 
     bt_mesh_scan_disable();
     bt_mesh_beacon_disable();
@@ -225,3 +232,78 @@ int bt_mesh_init(const struct bt_mesh_prov *prov,
 
     return 0;
 }
+
+void bt_mesh_stats_log(void)
+{
+    struct bt_mesh_net_pdu_stats pdu;
+    struct bt_mesh_net_cache_stats cache;
+    struct bt_mesh_net_decrypt_stats dec;
+    struct bt_mesh_seg_tx_stats tx;
+    struct bt_mesh_seg_rx_stats rx;
+    struct net_buf_pool_stats pool;
+    struct bt_mesh_proxy_client_stats proxy;
+    int i;
+
+    bt_mesh_net_pdu_stats_get(&pdu);
+    bt_mesh_net_cache_stats_get(&cache);
+    bt_mesh_net_decrypt_stats_get(&dec);
+    bt_mesh_seg_tx_stats_get(&tx);
+    bt_mesh_seg_rx_stats_get(&rx);
+
+    BT_INFO("net: sent %u rcvd %u local %u relayed %u relay drop %u",
+            pdu.sent, pdu.received, pdu.local, pdu.relayed,
+            pdu.relay_dropped);
+    BT_INFO("net: dup hit %u/%u msg hit %u/%u nid miss %u decrypt %u/%u",
+            cache.dup_hit, cache.dup_checked, cache.msg_hit,
+            cache.msg_checked, dec.nid_miss, dec.attempts - dec.failed,
+            dec.attempts);
+    BT_INFO("seg tx: acked %u failed %u segs %u/%u, %u ms avg, %u B/s",
+            tx.sdu_acked, tx.sdu_failed, tx.seg_acked, tx.seg_failed,
+            tx.sdu_acked ? tx.sdu_ms / tx.sdu_acked : 0,
+            tx.sdu_ms ? (u32_t)((u64_t)tx.sdu_bytes * 1000 / tx.sdu_ms) : 0);
+    BT_INFO("seg rx: complete %u incomplete %u no ctx %u, %u ms avg, %u B/s",
+            rx.sdu_complete, rx.incomplete, rx.no_ctx,
+            rx.sdu_complete ? rx.sdu_ms / rx.sdu_complete : 0,
+            rx.sdu_ms ? (u32_t)((u64_t)rx.sdu_bytes * 1000 / rx.sdu_ms) : 0);
+
+    bt_mesh_adv_buf_stats_get(&pool);
+    BT_INFO("adv bufs: %u/%u used, max %u, alloc failed %u", pool.used,
+            pool.count, pool.used_max, pool.alloc_failed);
+
+#if defined(CONFIG_BT_MESH_FRIEND)
+    bt_mesh_friend_buf_stats_get(&pool);
+    BT_INFO("friend bufs: %u/%u used, max %u, alloc failed %u", pool.used,
+            pool.count, pool.used_max, pool.alloc_failed);
+#endif /* CONFIG_BT_MESH_FRIEND */
+
+    for (i = 0; i < CONFIG_BT_MAX_CONN; i++) {
+        if (bt_mesh_proxy_client_stats_get(i, &proxy)) {
+            continue;
+        }
+
+        BT_INFO("proxy %d: rx %u pdus %u B/s, tx %u pdus %u B/s, "
+                "%u queued %u dropped %u notify failed, %u filtered, "
+                "%u addrs", i, proxy.rx_pdus, proxy.connected_ms ?
+                (u32_t)((u64_t)proxy.rx_bytes * 1000 / proxy.connected_ms) : 0,
+                proxy.tx_pdus, proxy.connected_ms ?
+                (u32_t)((u64_t)proxy.tx_bytes * 1000 / proxy.connected_ms) : 0,
+                proxy.tx_queued, proxy.tx_dropped, proxy.tx_failed,
+                proxy.relay_filtered, proxy.filter_count);
+    }
+}
+
+void bt_mesh_stats_reset(void)
+{
+    bt_mesh_net_pdu_stats_reset();
+    bt_mesh_net_cache_stats_reset();
+    bt_mesh_net_decrypt_stats_reset();
+    bt_mesh_seg_tx_stats_reset();
+    bt_mesh_seg_rx_stats_reset();
+    bt_mesh_adv_buf_stats_reset();
+
+#if defined(CONFIG_BT_MESH_FRIEND)
+    bt_mesh_friend_buf_stats_reset();
+#endif /* CONFIG_BT_MESH_FRIEND */
+
+    bt_mesh_proxy_client_stats_reset();
+}
@@ -81,8 +81,46 @@ static struct friend_cred friend_cred[FRIEND_CRED_COUNT];
 
 static struct friend_cred friend_cred_lpn[FRIEND_CRED_COUNT_LPN];
 
-static u64_t msg_cache[CONFIG_BT_MESH_MSG_CACHE_SIZE];
-static u16_t msg_cache_next;
+/* Fixed size FIFO ring of hashes with a chained hash index on top, so
+ * both lookup and insert are O(1) whatever the cache size. When the ring
+ * is full the oldest entry is unlinked from its bucket and overwritten.
+ * Chain and bucket links store the ring slot plus one, zero ends a chain.
+ */
+struct net_cache {
+    u64_t *entry;
+    u16_t *chain;
+    u16_t *bucket;
+    u16_t  size;
+    u16_t  next;
+    u16_t  count;
+};
+
+#define NET_CACHE_DEFINE(_name, _size)                          \
+    static u64_t _name##_entry[_size];                          \
+    static u16_t _name##_chain[_size];                          \
+    static u16_t _name##_bucket[_size];                         \
+    static struct net_cache _name = {                           \
+        .entry = _name##_entry,                                 \
+        .chain = _name##_chain,                                 \
+        .bucket = _name##_bucket,                               \
+        .size = _size,                                          \
+    }
+
+NET_CACHE_DEFINE(msg_cache, CONFIG_BT_MESH_MSG_CACHE_SIZE);
+NET_CACHE_DEFINE(dup_cache, CONFIG_BT_MESH_DUP_CACHE_SIZE);
+
+static struct bt_mesh_net_cache_stats cache_stats;
+
+/* One bit per 7-bit NID of every live network and friendship credential.
+ * Bits are set as soon as a NID is derived, so the map is always a
+ * superset of what net_find_and_decrypt() can match, and only pruned by
+ * a lazy rebuild after keys have been dropped.
+ */
+static u8_t nid_map[128 / 8];
+static bool nid_map_dirty;
+
+static struct bt_mesh_net_decrypt_stats decrypt_stats;
+static struct bt_mesh_net_pdu_stats pdu_stats;
 
 /* Singleton network context (the implementation only supports one) */
 struct bt_mesh_net bt_mesh = {
@@ -98,25 +136,80 @@ struct bt_mesh_net bt_mesh = {
     },
 };
 
-static u32_t dup_cache[4];
-static int   dup_cache_next;
+static u16_t net_cache_bucket(struct net_cache *cache, u64_t key)
+{
+    u32_t h = (u32_t)key ^ (u32_t)(key >> 32);
+
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+
+    return h % cache->size;
+}
+
+static void net_cache_reset(struct net_cache *cache)
+{
+    (void)memset(cache->bucket, 0, cache->size * sizeof(cache->bucket[0]));
+    cache->next = 0;
+    cache->count = 0;
+}
+
+static void net_cache_unlink(struct net_cache *cache, u16_t slot)
+{
+    u16_t *link = &cache->bucket[net_cache_bucket(cache, cache->entry[slot])];
+
+    while (*link) {
+        if (*link == slot + 1) {
+            *link = cache->chain[slot];
+            return;
+        }
+
+        link = &cache->chain[*link - 1];
+    }
+}
+
+/* Returns true if key was already cached, otherwise adds it */
+static bool net_cache_check(struct net_cache *cache, u64_t key)
+{
+    u16_t *head = &cache->bucket[net_cache_bucket(cache, key)];
+    u16_t slot;
+
+    for (slot = *head; slot; slot = cache->chain[slot - 1]) {
+        if (cache->entry[slot - 1] == key) {
+            return true;
+        }
+    }
+
+    slot = cache->next;
+
+    if (cache->count == cache->size) {
+        net_cache_unlink(cache, slot);
+    } else {
+        cache->count++;
+    }
+
+    cache->entry[slot] = key;
+    cache->chain[slot] = *head;
+    *head = slot + 1;
+
+    cache->next = (slot + 1) % cache->size;
+
+    return false;
+}
 
 static bool check_dup(struct net_buf_simple *data)
 {
     const u8_t *tail = net_buf_simple_tail(data);
     u32_t val;
-    int i;
 
     val = sys_get_be32(tail - 4) ^ sys_get_be32(tail - 8);
 
-    for (i = 0; i < ARRAY_SIZE(dup_cache); i++) {
-        if (dup_cache[i] == val) {
-            return true;
-        }
-    }
+    cache_stats.dup_checked++;
 
-    dup_cache[dup_cache_next++] = val;
-    dup_cache_next %= ARRAY_SIZE(dup_cache);
+    if (net_cache_check(&dup_cache, val)) {
+        cache_stats.dup_hit++;
+        return true;
+    }
 
     return false;
 }
@@ -137,20 +230,112 @@ static u64_t msg_hash(struct bt_mesh_net_rx *rx, struct net_buf_simple *pdu)
 static bool msg_cache_match(struct bt_mesh_net_rx *rx,
                             struct net_buf_simple *pdu)
 {
-    u64_t hash = msg_hash(rx, pdu);
-    u16_t i;
+    cache_stats.msg_checked++;
 
-    for (i = 0; i < ARRAY_SIZE(msg_cache); i++) {
-        if (msg_cache[i] == hash) {
-            return true;
+    if (net_cache_check(&msg_cache, msg_hash(rx, pdu))) {
+        cache_stats.msg_hit++;
+        return true;
+    }
+
+    return false;
+}
+
+void bt_mesh_net_cache_stats_get(struct bt_mesh_net_cache_stats *stats)
+{
+    *stats = cache_stats;
+}
+
+void bt_mesh_net_cache_stats_reset(void)
+{
+    (void)memset(&cache_stats, 0, sizeof(cache_stats));
+}
+
+static void nid_map_add(u8_t nid)
+{
+    nid_map[(nid & 0x7f) / 8] |= BIT(nid % 8);
+}
+
+static void nid_map_rebuild(void)
+{
+    int i;
+
+    (void)memset(nid_map, 0, sizeof(nid_map));
+
+    for (i = 0; i < ARRAY_SIZE(bt_mesh.sub); i++) {
+        struct bt_mesh_subnet *sub = &bt_mesh.sub[i];
+
+        if (sub->net_idx == BT_MESH_KEY_UNUSED) {
+            continue;
+        }
+
+        nid_map_add(sub->keys[0].nid);
+
+        if (sub->kr_phase != BT_MESH_KR_NORMAL) {
+            nid_map_add(sub->keys[1].nid);
         }
     }
 
-    /* Add to the cache */
-    msg_cache[msg_cache_next++] = hash;
-    msg_cache_next %= ARRAY_SIZE(msg_cache);
+#if (defined(CONFIG_BT_MESH_LOW_POWER) || \
+     defined(CONFIG_BT_MESH_FRIEND))
+    if (BT_MESH_FEATURES_IS_SUPPORT(BT_MESH_FEAT_LOW_POWER | BT_MESH_FEAT_FRIEND)) {
+        int friend_cred_count = BT_MESH_FEATURES_IS_SUPPORT(BT_MESH_FEAT_FRIEND) ?
+                                FRIEND_CRED_COUNT : FRIEND_CRED_COUNT_LPN;
 
-    return false;
+        for (i = 0; i < friend_cred_count; i++) {
+            struct friend_cred *cred;
+
+            if (BT_MESH_FEATURES_IS_SUPPORT(BT_MESH_FEAT_FRIEND)) {
+                cred = &friend_cred[i];
+            } else {
+                cred = &friend_cred_lpn[i];
+            }
+
+            if (cred->net_idx == BT_MESH_KEY_UNUSED) {
+                continue;
+            }
+
+            /* Either credential may be live during Key Refresh */
+            nid_map_add(cred->cred[0].nid);
+            nid_map_add(cred->cred[1].nid);
+        }
+    }
+#endif
+
+    nid_map_dirty = false;
+}
+
+static bool nid_map_match(u8_t nid)
+{
+    if (nid_map_dirty) {
+        nid_map_rebuild();
+    }
+
+    return (nid_map[nid / 8] & BIT(nid % 8));
+}
+
+void bt_mesh_net_nid_map_invalidate(void)
+{
+    nid_map_dirty = true;
+}
+
+void bt_mesh_net_decrypt_stats_get(struct bt_mesh_net_decrypt_stats *stats)
+{
+    *stats = decrypt_stats;
+}
+
+void bt_mesh_net_decrypt_stats_reset(void)
+{
+    (void)memset(&decrypt_stats, 0, sizeof(decrypt_stats));
+}
+
+void bt_mesh_net_pdu_stats_get(struct bt_mesh_net_pdu_stats *stats)
+{
+    *stats = pdu_stats;
+}
+
+void bt_mesh_net_pdu_stats_reset(void)
+{
+    (void)memset(&pdu_stats, 0, sizeof(pdu_stats));
 }
 
 struct bt_mesh_subnet *bt_mesh_subnet_get(u16_t net_idx)
@@ -170,62 +355,105 @@ struct bt_mesh_subnet *bt_mesh_subnet_get(u16_t net_idx)
     return NULL;
 }
 
-int bt_mesh_net_keys_create(struct bt_mesh_subnet_keys *keys,
-                            const u8_t key[16])
+int bt_mesh_net_keys_derive(const u8_t key[16],
+                            struct bt_mesh_net_keys_derived *derived)
 {
     u8_t p[] = { 0 };
-    u8_t nid;
     int err;
 
-    err = bt_mesh_k2(key, p, sizeof(p), &nid, keys->enc, keys->privacy);
+    err = bt_mesh_k2(key, p, sizeof(p), &derived->nid, derived->enc,
+                     derived->privacy);
     if (err) {
         BT_ERR("Unable to generate NID, EncKey & PrivacyKey");
         return err;
     }
 
-    memcpy(keys->net, key, 16);
-
-    keys->nid = nid;
-
-    BT_DBG("NID 0x%02x EncKey %s", keys->nid, bt_hex(keys->enc, 16));
-    BT_DBG("PrivacyKey %s", bt_hex(keys->privacy, 16));
+    BT_DBG("NID 0x%02x EncKey %s", derived->nid, bt_hex(derived->enc, 16));
+    BT_DBG("PrivacyKey %s", bt_hex(derived->privacy, 16));
 
-    err = bt_mesh_k3(key, keys->net_id);
+    err = bt_mesh_k3(key, derived->net_id);
     if (err) {
         BT_ERR("Unable to generate Net ID");
         return err;
     }
 
-    BT_DBG("NetID %s", bt_hex(keys->net_id, 8));
+    BT_DBG("NetID %s", bt_hex(derived->net_id, 8));
 
 #if defined(CONFIG_BT_MESH_GATT_PROXY)
     if (BT_MESH_FEATURES_IS_SUPPORT(BT_MESH_FEAT_PROXY)) {
-        err = bt_mesh_identity_key(key, keys->identity);
+        err = bt_mesh_identity_key(key, derived->identity);
         if (err) {
             BT_ERR("Unable to generate IdentityKey");
             return err;
         }
 
-        BT_DBG("IdentityKey %s", bt_hex(keys->identity, 16));
+        BT_DBG("IdentityKey %s", bt_hex(derived->identity, 16));
+    } else {
+        (void)memset(derived->identity, 0, sizeof(derived->identity));
     }
 #endif /* GATT_PROXY */
 
-    err = bt_mesh_beacon_key(key, keys->beacon);
+    err = bt_mesh_beacon_key(key, derived->beacon);
     if (err) {
         BT_ERR("Unable to generate beacon key");
         return err;
     }
 
-    BT_DBG("BeaconKey %s", bt_hex(keys->beacon, 16));
+    BT_DBG("BeaconKey %s", bt_hex(derived->beacon, 16));
+
+    return 0;
+}
+
+int bt_mesh_net_keys_restore(struct bt_mesh_subnet_keys *keys,
+                             const u8_t key[16],
+                             const struct bt_mesh_net_keys_derived *derived)
+{
+    int err;
+
+    err = bt_mesh_aes_key_expand(derived->enc, &keys->enc);
+    if (!err) {
+        err = bt_mesh_aes_key_expand(derived->privacy, &keys->privacy);
+    }
+
+    if (err) {
+        BT_ERR("Unable to expand EncKey & PrivacyKey");
+        return err;
+    }
+
+    memcpy(keys->net, key, 16);
+
+    keys->nid = derived->nid;
+    nid_map_add(derived->nid);
+
+    memcpy(keys->net_id, derived->net_id, sizeof(keys->net_id));
+#if defined(CONFIG_BT_MESH_GATT_PROXY)
+    memcpy(keys->identity, derived->identity, sizeof(keys->identity));
+#endif
+    memcpy(keys->beacon, derived->beacon, sizeof(keys->beacon));
 
     return 0;
 }
 
+int bt_mesh_net_keys_create(struct bt_mesh_subnet_keys *keys,
+                            const u8_t key[16])
+{
+    struct bt_mesh_net_keys_derived derived;
+    int err;
+
+    err = bt_mesh_net_keys_derive(key, &derived);
+    if (err) {
+        return err;
+    }
+
+    return bt_mesh_net_keys_restore(keys, key, &derived);
+}
+
 #if (defined(CONFIG_BT_MESH_LOW_POWER) || \
      defined(CONFIG_BT_MESH_FRIEND))
 int friend_cred_set(struct friend_cred *cred, u8_t idx, const u8_t net_key[16])
 {
     u16_t lpn_addr, frnd_addr;
+    u8_t enc[16], privacy[16];
     int err;
     u8_t p[9];
 
@@ -258,15 +486,27 @@ int friend_cred_set(struct friend_cred *cred, u8_t idx, const u8_t net_key[16])
     sys_put_be16(cred->frnd_counter, p + 7);
 
     err = bt_mesh_k2(net_key, p, sizeof(p), &cred->cred[idx].nid,
-                     cred->cred[idx].enc, cred->cred[idx].privacy);
+                     enc, privacy);
     if (err) {
         BT_ERR("Unable to generate NID, EncKey & PrivacyKey");
         return err;
     }
 
+    nid_map_add(cred->cred[idx].nid);
+
     BT_DBG("Friend NID 0x%02x EncKey %s", cred->cred[idx].nid,
-           bt_hex(cred->cred[idx].enc, 16));
-    BT_DBG("Friend PrivacyKey %s", bt_hex(cred->cred[idx].privacy, 16));
+           bt_hex(enc, 16));
+    BT_DBG("Friend PrivacyKey %s", bt_hex(privacy, 16));
+
+    err = bt_mesh_aes_key_expand(enc, &cred->cred[idx].enc);
+    if (!err) {
+        err = bt_mesh_aes_key_expand(privacy, &cred->cred[idx].privacy);
+    }
+
+    if (err) {
+        BT_ERR("Unable to expand Friend EncKey & PrivacyKey");
+        return err;
+    }
 
     return 0;
 }
@@ -389,6 +629,8 @@ void friend_cred_clear(struct friend_cred *cred)
     cred->lpn_counter = 0;
     cred->frnd_counter = 0;
     (void)memset(cred->cred, 0, sizeof(cred->cred));
+
+    nid_map_dirty = true;
 }
 
 int friend_cred_del(u16_t net_idx, u16_t addr)
@@ -415,7 +657,8 @@ int friend_cred_del(u16_t net_idx, u16_t addr)
 }
 
 int friend_cred_get(struct bt_mesh_subnet *sub, u16_t addr, u8_t *nid,
-                    const u8_t **enc, const u8_t **priv)
+                    struct tc_aes_key_sched_struct **enc,
+                    struct tc_aes_key_sched_struct **priv)
 {
     int i;
     int friend_cred_count = BT_MESH_FEATURES_IS_SUPPORT(BT_MESH_FEAT_FRIEND) ?
@@ -444,11 +687,11 @@ int friend_cred_get(struct bt_mesh_subnet *sub, u16_t addr, u8_t *nid,
         }
 
         if (enc) {
-            *enc = cred->cred[sub->kr_flag].enc;
+            *enc = &cred->cred[sub->kr_flag].enc;
         }
 
         if (priv) {
-            *priv = cred->cred[sub->kr_flag].privacy;
+            *priv = &cred->cred[sub->kr_flag].privacy;
         }
 
         return 0;
@@ -458,7 +701,8 @@ int friend_cred_get(struct bt_mesh_subnet *sub, u16_t addr, u8_t *nid,
 }
 #else
 int friend_cred_get(struct bt_mesh_subnet *sub, u16_t addr, u8_t *nid,
-                    const u8_t **enc, const u8_t **priv)
+                    struct tc_aes_key_sched_struct **enc,
+                    struct tc_aes_key_sched_struct **priv)
 {
     return -ENOENT;
 }
@@ -514,8 +758,7 @@ int bt_mesh_net_create(u16_t idx, u8_t flags, const u8_t key[16],
         return -EALREADY;
     }
 
-    (void)memset(msg_cache, 0, sizeof(msg_cache));
-    msg_cache_next = 0;
+    net_cache_reset(&msg_cache);
 
     sub = &bt_mesh.sub[0];
 
@@ -566,6 +809,7 @@ void bt_mesh_net_revoke_keys(struct bt_mesh_subnet *sub)
     BT_DBG("idx 0x%04x", sub->net_idx);
 
     memcpy(&sub->keys[0], &sub->keys[1], sizeof(sub->keys[0]));
+    nid_map_dirty = true;
 
     for (i = 0; i < ARRAY_SIZE(bt_mesh.app_keys); i++) {
         struct bt_mesh_app_key *key = &bt_mesh.app_keys[i];
@@ -641,6 +885,8 @@ void bt_mesh_rpl_reset(void)
             }
         }
     }
+
+    bt_mesh_rpl_index_rebuild();
 }
 
 #if defined(CONFIG_BT_MESH_IV_UPDATE_TEST)
@@ -719,7 +965,7 @@ bool bt_mesh_net_iv_update(u32_t iv_index, bool iv_update)
 
         if (iv_index > bt_mesh.iv_index + 1) {
             BT_WARN("Performing IV Index Recovery");
-            (void)memset(bt_mesh.rpl, 0, sizeof(bt_mesh.rpl));
+            bt_mesh_rpl_clear();
             bt_mesh.iv_index = iv_index;
             bt_mesh.seq = 0;
             goto do_update;
@@ -778,6 +1024,13 @@ do_update:
         bt_mesh_store_iv(false);
     }
 
+#if CONFIG_BT_MESH_PROVISIONER
+    /* New nodes join with the IV Index the network is on */
+    if (bt_mesh_cdb.valid) {
+        bt_mesh_cdb_iv_update(bt_mesh.iv_index, bt_mesh.iv_update);
+    }
+#endif /* CONFIG_BT_MESH_PROVISIONER */
+
     return true;
 }
 
@@ -796,15 +1049,15 @@ int bt_mesh_net_resend(struct bt_mesh_subnet *sub, struct net_buf *buf,
                        bool new_key, const struct bt_mesh_send_cb *cb,
                        void *cb_data)
 {
-    const u8_t *enc, *priv;
+    struct tc_aes_key_sched_struct *enc, *priv;
     u32_t seq;
     int err;
 
     BT_DBG("net_idx 0x%04x new_key %u len %u", sub->net_idx, new_key,
            buf->len);
 
-    enc = sub->keys[new_key].enc;
-    priv = sub->keys[new_key].privacy;
+    enc = &sub->keys[new_key].enc;
+    priv = &sub->keys[new_key].privacy;
 
     err = bt_mesh_net_obfuscate(buf->data, BT_MESH_NET_IVI_TX, priv);
     if (err) {
@@ -860,7 +1113,7 @@ int bt_mesh_net_encode(struct bt_mesh_net_tx *tx, struct net_buf_simple *buf,
     const bool ctl = (tx->ctx->app_idx == BT_MESH_KEY_UNUSED);
     u32_t seq_val;
     u8_t nid;
-    const u8_t *enc, *priv;
+    struct tc_aes_key_sched_struct *enc, *priv;
     u8_t *seq;
     int err;
 
@@ -899,14 +1152,14 @@ int bt_mesh_net_encode(struct bt_mesh_net_tx *tx, struct net_buf_simple *buf,
             tx->friend_cred = 0;
 
             nid = tx->sub->keys[tx->sub->kr_flag].nid;
-            enc = tx->sub->keys[tx->sub->kr_flag].enc;
-            priv = tx->sub->keys[tx->sub->kr_flag].privacy;
+            enc = &tx->sub->keys[tx->sub->kr_flag].enc;
+            priv = &tx->sub->keys[tx->sub->kr_flag].privacy;
         }
     } else {
         tx->friend_cred = 0;
         nid = tx->sub->keys[tx->sub->kr_flag].nid;
-        enc = tx->sub->keys[tx->sub->kr_flag].enc;
-        priv = tx->sub->keys[tx->sub->kr_flag].privacy;
+        enc = &tx->sub->keys[tx->sub->kr_flag].enc;
+        priv = &tx->sub->keys[tx->sub->kr_flag].privacy;
     }
 
     net_buf_simple_push_u8(buf, (nid | (BT_MESH_NET_IVI_TX & 1) << 7));
@@ -939,6 +1192,8 @@ int bt_mesh_net_send(struct bt_mesh_net_tx *tx, struct net_buf *buf,
         goto done;
     }
 
+    pdu_stats.sent++;
+
     /* Deliver to GATT Proxy Clients if necessary. Mesh spec 3.4.5.2:
      * "The output filter of the interface connected to advertising or
      * GATT bearers shall drop all messages with TTL value set to 1."
@@ -1039,11 +1294,16 @@ struct bt_mesh_subnet *bt_mesh_subnet_find(const u8_t net_id[8], u8_t flags,
     return NULL;
 }
 
-static int net_decrypt(struct bt_mesh_subnet *sub, const u8_t *enc,
-                       const u8_t *priv, const u8_t *data,
+static int net_decrypt(struct bt_mesh_subnet *sub,
+                       struct tc_aes_key_sched_struct *enc,
+                       struct tc_aes_key_sched_struct *priv,
+                       const u8_t *data,
                        size_t data_len, struct bt_mesh_net_rx *rx,
                        struct net_buf_simple *buf)
 {
+    bool proxy;
+    int err;
+
     BT_DBG("NID 0x%02x net_idx 0x%04x", NID(data), sub->net_idx);
     BT_DBG("IVI %u net->iv_index 0x%08x", IVI(data), bt_mesh.iv_index);
 
@@ -1052,6 +1312,8 @@ static int net_decrypt(struct bt_mesh_subnet *sub, const u8_t *enc,
     net_buf_simple_reset(buf);
     memcpy(net_buf_simple_add(buf, data_len), data, data_len);
 
+    decrypt_stats.attempts++;
+
     if (bt_mesh_net_obfuscate(buf->data, BT_MESH_NET_IVI_RX(rx), priv)) {
         return -ENOENT;
     }
@@ -1069,13 +1331,15 @@ static int net_decrypt(struct bt_mesh_subnet *sub, const u8_t *enc,
 
     BT_DBG("src 0x%04x", rx->ctx.addr);
 
-    if (IS_ENABLED(CONFIG_BT_MESH_PROXY) &&
-        rx->net_if == BT_MESH_NET_IF_PROXY_CFG) {
-        return bt_mesh_net_decrypt(enc, buf, BT_MESH_NET_IVI_RX(rx),
-                                   true);
+    proxy = (IS_ENABLED(CONFIG_BT_MESH_PROXY) &&
+             rx->net_if == BT_MESH_NET_IF_PROXY_CFG);
+
+    err = bt_mesh_net_decrypt(enc, buf, BT_MESH_NET_IVI_RX(rx), proxy);
+    if (err) {
+        decrypt_stats.failed++;
     }
 
-    return bt_mesh_net_decrypt(enc, buf, BT_MESH_NET_IVI_RX(rx), false);
+    return err;
 }
 
 #if (defined(CONFIG_BT_MESH_LOW_POWER) || \
@@ -1103,7 +1367,7 @@ static int friend_decrypt(struct bt_mesh_subnet *sub, const u8_t *data,
         }
 
         if (NID(data) == cred->cred[0].nid &&
-            !net_decrypt(sub, cred->cred[0].enc, cred->cred[0].privacy,
+            !net_decrypt(sub, &cred->cred[0].enc, &cred->cred[0].privacy,
                          data, data_len, rx, buf)) {
             return 0;
         }
@@ -1113,7 +1377,7 @@ static int friend_decrypt(struct bt_mesh_subnet *sub, const u8_t *data,
         }
 
         if (NID(data) == cred->cred[1].nid &&
-            !net_decrypt(sub, cred->cred[1].enc, cred->cred[1].privacy,
+            !net_decrypt(sub, &cred->cred[1].enc, &cred->cred[1].privacy,
                          data, data_len, rx, buf)) {
             rx->new_key = 1;
             return 0;
@@ -1133,6 +1397,14 @@ static bool net_find_and_decrypt(const u8_t *data, size_t data_len,
 
     BT_DBG("");
 
+    /* Most PDUs heard over the air belong to other networks, drop those
+     * before walking subnets and friendship credentials.
+     */
+    if (!nid_map_match(NID(data))) {
+        decrypt_stats.nid_miss++;
+        return false;
+    }
+
     for (i = 0; i < ARRAY_SIZE(bt_mesh.sub); i++) {
         sub = &bt_mesh.sub[i];
         if (sub->net_idx == BT_MESH_KEY_UNUSED) {
@@ -1152,7 +1424,7 @@ static bool net_find_and_decrypt(const u8_t *data, size_t data_len,
 #endif
 
         if (NID(data) == sub->keys[0].nid &&
-            !net_decrypt(sub, sub->keys[0].enc, sub->keys[0].privacy,
+            !net_decrypt(sub, &sub->keys[0].enc, &sub->keys[0].privacy,
                          data, data_len, rx, buf)) {
             rx->ctx.net_idx = sub->net_idx;
             rx->sub = sub;
@@ -1164,7 +1436,7 @@ static bool net_find_and_decrypt(const u8_t *data, size_t data_len,
         }
 
         if (NID(data) == sub->keys[1].nid &&
-            !net_decrypt(sub, sub->keys[1].enc, sub->keys[1].privacy,
+            !net_decrypt(sub, &sub->keys[1].enc, &sub->keys[1].privacy,
                          data, data_len, rx, buf)) {
             rx->new_key = 1;
             rx->ctx.net_idx = sub->net_idx;
@@ -1210,7 +1482,7 @@ static void bt_mesh_net_relay(struct net_buf_simple *sbuf,
 {
     BT_INFO("--func=%s", __FUNCTION__);
 
-    const u8_t *enc, *priv;
+    struct tc_aes_key_sched_struct *enc, *priv;
     struct net_buf *buf;
     u8_t nid, transmit;
 
@@ -1252,9 +1524,16 @@ static void bt_mesh_net_relay(struct net_buf_simple *sbuf,
     buf = bt_mesh_adv_create(BT_MESH_ADV_DATA, transmit, K_NO_WAIT);
     if (!buf) {
         BT_ERR("Out of relay buffers");
+        pdu_stats.relay_dropped++;
         return;
     }
 
+    pdu_stats.relayed++;
+
+    if (rx->net_if == BT_MESH_NET_IF_ADV) {
+        BT_MESH_ADV(buf)->origin = BT_MESH_ADV_ORIGIN_RELAY;
+    }
+
     /* Only decrement TTL for non-locally originated packets */
     if (rx->net_if != BT_MESH_NET_IF_LOCAL) {
         /* Leave CTL bit intact */
@@ -1264,8 +1543,8 @@ static void bt_mesh_net_relay(struct net_buf_simple *sbuf,
 
     net_buf_add_mem(buf, sbuf->data, sbuf->len);
 
-    enc = rx->sub->keys[rx->sub->kr_flag].enc;
-    priv = rx->sub->keys[rx->sub->kr_flag].privacy;
+    enc = &rx->sub->keys[rx->sub->kr_flag].enc;
+    priv = &rx->sub->keys[rx->sub->kr_flag].privacy;
     nid = rx->sub->keys[rx->sub->kr_flag].nid;
 
     BT_DBG("Relaying packet. TTL is now %u", TTL(buf->data));
@@ -1406,6 +1685,11 @@ void bt_mesh_net_recv(struct net_buf_simple *data, s8_t rssi,
     rx.local_match = (bt_mesh_fixed_group_match(rx.ctx.recv_dst) ||
                       bt_mesh_elem_find(rx.ctx.recv_dst));
 
+    pdu_stats.received++;
+    if (rx.local_match) {
+        pdu_stats.local++;
+    }
+
     bt_mesh_trans_recv(&buf, &rx);
 
     /* Relay if this was a group/virtual address, or if the destination
@@ -6,6 +6,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <tinycrypt/aes.h>
+
 #define BT_MESH_NET_FLAG_KR       BIT(0)
 #define BT_MESH_NET_FLAG_IVU      BIT(1)
 
@@ -30,6 +32,7 @@ struct bt_mesh_app_key {
     struct bt_mesh_app_keys {
         u8_t id;
         u8_t val[16];
+        struct tc_aes_key_sched_struct sched; /* Expanded AppKey */
     } keys[2];
 };
 
@@ -57,12 +60,12 @@ struct bt_mesh_subnet {
     struct bt_mesh_subnet_keys {
         u8_t net[16];       /* NetKey */
         u8_t nid;           /* NID */
-        u8_t enc[16];       /* EncKey */
+        struct tc_aes_key_sched_struct enc;     /* Expanded EncKey */
         u8_t net_id[8];     /* Network ID */
 #if defined(CONFIG_BT_MESH_GATT_PROXY)
         u8_t identity[16];  /* IdentityKey */
 #endif
-        u8_t privacy[16];   /* PrivacyKey */
+        struct tc_aes_key_sched_struct privacy; /* Expanded PrivacyKey */
         u8_t beacon[16];    /* BeaconKey */
     } keys[2];
 };
@@ -74,6 +77,9 @@ struct bt_mesh_rpl {
     bool  store;
 #endif
     u32_t seq;
+#if CONFIG_BT_MESH_RPL_LRU_EVICT
+    u32_t lru;   /* Last use stamp, smallest gets evicted when full */
+#endif
 };
 
 #if defined(CONFIG_BT_MESH_FRIEND)
@@ -85,6 +91,19 @@ struct bt_mesh_rpl {
 #endif
 
 #if CONFIG_BT_MESH_FRIEND
+/* Friend Queue counters of one LPN, since its Friend Request */
+struct bt_mesh_friend_lpn_stats {
+    u32_t enqueued;         /* PDUs put in the Friend Queue */
+    u32_t delivered;        /* PDUs handed out on a Friend Poll */
+    u32_t dropped;          /* PDUs evicted to make room in the pool */
+    u32_t depth_max;        /* Peak queue_size */
+    u32_t wait_max;         /* Longest time in the queue until delivery, ms */
+    u32_t wait_sum;         /* Sum over delivered PDUs, ms */
+    u32_t polls;            /* Friend Polls answered */
+    u32_t latency_max;      /* Longest Friend Poll to response time, ms */
+    u32_t latency_sum;      /* Sum over answered Friend Polls, ms */
+};
+
 struct bt_mesh_friend {
     u16_t lpn;
     u8_t  recv_delay;
@@ -96,6 +115,7 @@ struct bt_mesh_friend {
           valid: 1,
           established: 1;
     s32_t poll_to;
+    u32_t poll_at;          /* k_uptime_get_32() of the last Friend Poll */
     u8_t  num_elem;
     u16_t lpn_counter;
     u16_t counter;
@@ -125,6 +145,8 @@ struct bt_mesh_friend {
     sys_slist_t queue;
     u32_t queue_size;
 
+    struct bt_mesh_friend_lpn_stats stats;
+
     /* Friend Clear Procedure */
     struct {
         u32_t start;                  /* Clear Procedure start */
@@ -191,6 +213,13 @@ struct bt_mesh_lpn {
     /* Duration reported for last advertising packet */
     u16_t adv_duration;
 
+    /* Adaptive poll scheduling */
+    u8_t  poll_rx;          /* Messages delivered in this poll cycle */
+    u32_t last_rx;          /* Uptime of the last cycle that had data */
+    u32_t rx_gap;           /* Smoothed time between such cycles, ms */
+    u32_t traffic_hint;     /* Expected message period from the app, ms */
+    u32_t scan_start;       /* Uptime scanning started, 0 when off */
+
     /* Next LPN related action timer */
     struct k_delayed_work timer;
 
@@ -252,6 +281,7 @@ struct bt_mesh_net {
     struct k_delayed_work ivu_timer;
 
     u8_t dev_key[16];
+    struct tc_aes_key_sched_struct dev_key_sched; /* Expanded DevKey */
 
     struct bt_mesh_app_key app_keys[CONFIG_BT_MESH_APP_KEY_COUNT];
 
@@ -301,6 +331,27 @@ extern struct bt_mesh_net bt_mesh;
 
 #define BT_MESH_NET_HDR_LEN 9
 
+/* Raw key material behind struct bt_mesh_subnet_keys, i.e. everything the
+ * k2/k3/k1 chains produce from a NetKey.
+ */
+struct bt_mesh_net_keys_derived {
+    u8_t nid;
+    u8_t enc[16];
+    u8_t privacy[16];
+    u8_t net_id[8];
+    u8_t beacon[16];
+#if defined(CONFIG_BT_MESH_GATT_PROXY)
+    u8_t identity[16];
+#endif
+} __packed;
+
+int bt_mesh_net_keys_derive(const u8_t key[16],
+                            struct bt_mesh_net_keys_derived *derived);
+
+int bt_mesh_net_keys_restore(struct bt_mesh_subnet_keys *keys,
+                             const u8_t key[16],
+                             const struct bt_mesh_net_keys_derived *derived);
+
 int bt_mesh_net_keys_create(struct bt_mesh_subnet_keys *keys,
                             const u8_t key[16]);
 
@@ -345,6 +396,49 @@ void bt_mesh_net_recv(struct net_buf_simple *data, s8_t rssi,
 
 u32_t bt_mesh_next_seq(void);
 
+/* Network layer duplicate filtering counters, for sizing
+ * CONFIG_BT_MESH_MSG_CACHE_SIZE and CONFIG_BT_MESH_DUP_CACHE_SIZE.
+ */
+struct bt_mesh_net_cache_stats {
+    u32_t dup_checked;  /* Advertising PDUs checked against dup cache */
+    u32_t dup_hit;      /* Dropped as identical to a recent PDU */
+    u32_t msg_checked;  /* Decrypted PDUs checked against msg cache */
+    u32_t msg_hit;      /* Dropped as already seen (same SEQ and SRC) */
+};
+
+void bt_mesh_net_cache_stats_get(struct bt_mesh_net_cache_stats *stats);
+void bt_mesh_net_cache_stats_reset(void);
+
+/* Network layer decryption of received PDUs. A PDU whose NID matches no
+ * live network or friendship credential never reaches decryption.
+ */
+struct bt_mesh_net_decrypt_stats {
+    u32_t nid_miss;     /* Dropped by the NID filter */
+    u32_t attempts;     /* Deobfuscate and decrypt attempts */
+    u32_t failed;       /* Attempts that failed authentication */
+};
+
+void bt_mesh_net_decrypt_stats_get(struct bt_mesh_net_decrypt_stats *stats);
+void bt_mesh_net_decrypt_stats_reset(void);
+
+/* Network PDU flow. Comparing one node's sent with the other nodes'
+ * local counts gives the delivery ratio of a test run, and relayed over
+ * received the relay load it put on each node.
+ */
+struct bt_mesh_net_pdu_stats {
+    u32_t sent;          /* PDUs originated by this node */
+    u32_t received;      /* PDUs decrypted, minus duplicates */
+    u32_t local;         /* Received PDUs addressed to this node */
+    u32_t relayed;       /* Received PDUs relayed or proxied */
+    u32_t relay_dropped; /* Relays dropped for lack of a buffer */
+};
+
+void bt_mesh_net_pdu_stats_get(struct bt_mesh_net_pdu_stats *stats);
+void bt_mesh_net_pdu_stats_reset(void);
+
+/* Prune the NID filter after a network key was deleted */
+void bt_mesh_net_nid_map_invalidate(void);
+
 void bt_mesh_net_start(void);
 
 void bt_mesh_net_init(void);
@@ -359,13 +453,14 @@ struct friend_cred {
 
     struct {
         u8_t nid;         /* NID */
-        u8_t enc[16];     /* EncKey */
-        u8_t privacy[16]; /* PrivacyKey */
+        struct tc_aes_key_sched_struct enc;     /* Expanded EncKey */
+        struct tc_aes_key_sched_struct privacy; /* Expanded PrivacyKey */
     } cred[2];
 };
 
 int friend_cred_get(struct bt_mesh_subnet *sub, u16_t addr, u8_t *nid,
-                    const u8_t **enc, const u8_t **priv);
+                    struct tc_aes_key_sched_struct **enc,
+                    struct tc_aes_key_sched_struct **priv);
 int friend_cred_set(struct friend_cred *cred, u8_t idx, const u8_t net_key[16]);
 void friend_cred_refresh(u16_t net_idx);
 int friend_cred_update(struct bt_mesh_subnet *sub);
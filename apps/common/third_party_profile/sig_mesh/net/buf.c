@@ -157,6 +157,10 @@ struct net_buf *net_buf_alloc_len(struct net_buf_pool *pool, size_t size,
 
         pool->free_count--;
         BT_INFO("free_count=%d", pool->free_count);
+
+        if (pool->buf_count - pool->free_count > pool->used_max) {
+            pool->used_max = pool->buf_count - pool->free_count;
+        }
         do {
             uninit_count = pool->uninit_count--;
 
@@ -186,6 +190,10 @@ struct net_buf *net_buf_alloc_len(struct net_buf_pool *pool, size_t size,
         goto success;
     }
 
+    if (pool->alloc_failed < 0xffff) {
+        pool->alloc_failed++;
+    }
+
     irq_unlock(key);
 
     NET_BUF_ERR("%s():%d: Failed to get free buffer", func, line);
@@ -216,6 +224,32 @@ success:
     return buf;
 }
 
+void net_buf_pool_stats_get(struct net_buf_pool *pool,
+                            struct net_buf_pool_stats *stats)
+{
+    stats->count = pool->buf_count;
+#if NET_BUF_FREE_EN
+    stats->used = pool->buf_count - pool->free_count;
+    stats->used_max = pool->used_max;
+#else
+    stats->used = 0;
+    stats->used_max = 0;
+#endif /* NET_BUF_FREE_EN */
+    stats->alloc_failed = pool->alloc_failed;
+}
+
+void net_buf_pool_stats_reset(struct net_buf_pool *pool)
+{
+    unsigned int key;
+
+    key = irq_lock();
+#if NET_BUF_FREE_EN
+    pool->used_max = pool->buf_count - pool->free_count;
+#endif /* NET_BUF_FREE_EN */
+    pool->alloc_failed = 0;
+    irq_unlock(key);
+}
+
 struct net_buf *net_buf_alloc_fixed(struct net_buf_pool *pool, s32_t timeout)
 {
     const struct net_buf_pool_fixed *fixed = pool->alloc->alloc_data;
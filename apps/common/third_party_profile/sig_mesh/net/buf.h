@@ -474,8 +474,14 @@ struct net_buf_pool {
 
     u16_t free_count;
 
+    /** Most buffers in use at once */
+    u16_t used_max;
+
 #endif /* NET_BUF_FREE_EN */
 
+    /** Allocations that found the pool empty */
+    u16_t alloc_failed;
+
 #if defined(CONFIG_NET_BUF_POOL_USAGE)
     /** Amount of available buffers in the pool. */
     s16_t avail_count;
@@ -737,6 +743,33 @@ struct net_buf_pool *net_buf_pool_get(int id);
  */
 int net_buf_id(struct net_buf *buf);
 
+/** Pool occupancy, for sizing the buffer counts. */
+struct net_buf_pool_stats {
+    u16_t count;        /**< Buffers in the pool */
+    u16_t used;         /**< Buffers in use now */
+    u16_t used_max;     /**< Most buffers in use at once */
+    u16_t alloc_failed; /**< Allocations that found the pool empty */
+};
+
+/**
+ *  @brief Get the occupancy counters of a pool.
+ *
+ *  In-use counts are only tracked with NET_BUF_FREE_EN and read 0
+ *  otherwise.
+ *
+ *  @param pool Pool to query.
+ *  @param stats Filled with the counters.
+ */
+void net_buf_pool_stats_get(struct net_buf_pool *pool,
+                            struct net_buf_pool_stats *stats);
+
+/**
+ *  @brief Restart the high-water mark and failure count of a pool.
+ *
+ *  @param pool Pool to reset.
+ */
+void net_buf_pool_stats_reset(struct net_buf_pool *pool);
+
 /**
  *  @brief Allocate a new buffer from a pool.
  *
@@ -15,6 +15,7 @@
 #include "foundation.h"
 #include "proxy.h"
 #include "prov.h"
+#include "provisioner.h"
 
 #define LOG_TAG             "[MESH-prov]"
 #define LOG_INFO_ENABLE
@@ -191,6 +192,9 @@ struct prov_link {
 #endif
 
     struct k_delayed_work prot_timer;
+
+    /* Runs the DH request outside the PDU handler */
+    struct k_delayed_work dh_work;
 };
 
 struct prov_rx {
@@ -225,14 +229,87 @@ static const struct bt_mesh_prov *prov;
 
 static void pub_key_ready(const u8_t *pkey);
 
-static int reset_state(void)
+static struct bt_pub_key_cb pub_key_cb = {
+    .func = pub_key_ready,
+};
+
+static struct bt_mesh_prov_timing timing;
+static u32_t link_open_at;
+static u32_t last_pdu_at;
+static u32_t key_wait_at;
+static u32_t dh_at;
+static u32_t key_gen_at;
+static u32_t key_gen_ms;
+/* The current key pair went out on a link */
+static bool key_used;
+static struct k_delayed_work key_retry;
+
+/* Pause before asking the controller again after a failed generation */
+#define KEY_GEN_RETRY        K_SECONDS(1)
+
+static void timing_link_open(void)
+{
+    (void)memset(&timing, 0, sizeof(timing));
+    link_open_at = k_uptime_get_32();
+    last_pdu_at = link_open_at;
+}
+
+static void timing_pdu(u8_t type)
+{
+    u32_t now = k_uptime_get_32();
+
+    if (type < ARRAY_SIZE(timing.pdu_ms)) {
+        timing.pdu_ms[type] = now - last_pdu_at;
+    }
+
+    timing.total_ms = now - link_open_at;
+    last_pdu_at = now;
+}
+
+static void wait_pub_key(void)
+{
+    key_wait_at = k_uptime_get_32();
+    atomic_set_bit(link.flags, WAIT_PUB_KEY);
+    BT_WARN("Waiting for local public key");
+}
+
+/* The key pair is generated ahead of any link and replaced once a link
+ * has used it, so a provisioner rarely waits for it.
+ */
+static int key_pair_gen(void)
 {
-    static struct bt_pub_key_cb pub_key_cb = {
-        .func = pub_key_ready,
-    };
     int err;
 
+    if (key_gen_at) {
+        return 0;
+    }
+
+    key_gen_at = k_uptime_get_32() | 1;
+    key_used = false;
+
+    err = bt_pub_key_gen(&pub_key_cb);
+    if (err) {
+        key_gen_at = 0;
+        BT_ERR("Failed to generate public key (%d)", err);
+        k_delayed_work_submit(&key_retry, KEY_GEN_RETRY);
+    }
+
+    return err;
+}
+
+static void key_pair_retry(struct k_work *work)
+{
+    if (!bt_pub_key_get()) {
+        key_pair_gen();
+    }
+}
+
+static int reset_state(void)
+{
+    bool provisioner = atomic_test_bit(link.flags, PROVISIONER);
+
     k_delayed_work_cancel(&link.prot_timer);
+    k_delayed_work_cancel(&link.dh_work);
 
     /* Disable Attention Timer if it was set */
     if (link.conf_inputs[0]) {
@@ -270,10 +347,13 @@ static int reset_state(void)
     (void)memset(&link, 0, offsetof(struct prov_link, prot_timer));
 #endif /* PB_ADV */
 
-    err = bt_pub_key_gen(&pub_key_cb);
-    if (err) {
-        BT_ERR("Failed to generate public key (%d)", err);
-        return err;
+    if (IS_ENABLED(CONFIG_BT_MESH_PROVISIONER) && provisioner) {
+        bt_mesh_provisioner_link_closed();
+    }
+
+    /* Whatever the link's outcome, its key pair is not reused */
+    if (key_used || !bt_pub_key_get()) {
+        return key_pair_gen();
     }
 
     return 0;
@@ -578,6 +658,23 @@ static void prov_send_fail_msg(u8_t err)
 {
     PROV_BUF(buf, 2);
 
+#if defined(CONFIG_BT_MESH_PB_ADV)
+    /* A provisioner ends a failed attempt by closing the link, which
+     * also frees the bearer for the next device right away.
+     */
+    if (IS_ENABLED(CONFIG_BT_MESH_PROVISIONER) &&
+        atomic_test_bit(link.flags, PROVISIONER)) {
+        u8_t reason = CLOSE_REASON_FAILED;
+
+        BT_WARN("Closing link (err 0x%02x)", err);
+
+        link.expect = PROV_NO_PDU;
+        atomic_set_bit(link.flags, LINK_CLOSING);
+        bearer_ctl_send(LINK_CLOSE, &reason, sizeof(reason));
+        return;
+    }
+#endif
+
     prov_buf_init(&buf, PROV_FAILED);
     net_buf_simple_add_u8(&buf, err);
 
@@ -1023,6 +1120,8 @@ static void send_pub_key(void)
 
     BT_DBG("Local Public Key: %s", bt_hex(key, 64));
 
+    key_used = true;
+
     prov_buf_init(&buf, PROV_PUB_KEY);
 
     /* Swap X and Y halves independently to big-endian */
@@ -1058,6 +1157,13 @@ static void prov_dh_key_cb(const u8_t dhkey[32])
 {
     BT_DBG("%p", dhkey);
 
+    timing.dh_ms = k_uptime_get_32() - dh_at;
+
+    if (!atomic_test_bit(link.flags, LINK_ACTIVE)) {
+        BT_WARN("DHKey ready after the link was closed");
+        return;
+    }
+
     if (!dhkey) {
         BT_ERR("DHKey generation failed");
         prov_send_fail_msg(PROV_ERR_UNEXP_ERR);
@@ -1075,10 +1181,14 @@ static void prov_dh_key_cb(const u8_t dhkey[32])
     }
 }
 
-static void prov_dh_key_gen(void)
+static void dh_key_gen(struct k_work *work)
 {
     u8_t remote_pk_le[64], *remote_pk;
 
+    if (!atomic_test_bit(link.flags, LINK_ACTIVE)) {
+        return;
+    }
+
     if (atomic_test_bit(link.flags, PROVISIONER)) {
         remote_pk = &link.conf_inputs[81];
     } else {
@@ -1092,12 +1202,22 @@ static void prov_dh_key_gen(void)
     sys_memcpy_swap(remote_pk_le, remote_pk, 32);
     sys_memcpy_swap(&remote_pk_le[32], &remote_pk[32], 32);
 
+    dh_at = k_uptime_get_32();
+
     if (bt_dh_key_gen(remote_pk_le, prov_dh_key_cb)) {
         BT_ERR("Failed to generate DHKey");
         prov_send_fail_msg(PROV_ERR_UNEXP_ERR);
     }
 }
 
+static void prov_dh_key_gen(void)
+{
+    /* Return to the bearer first so the ack for the Public Key and any
+     * queued adv go out before the P-256 computation is started.
+     */
+    k_delayed_work_submit(&link.dh_work, 0);
+}
+
 static void prov_pub_key(const u8_t *data)
 {
     BT_DBG("Remote Public Key: %s", bt_hex(data, 64));
@@ -1119,8 +1239,7 @@ static void prov_pub_key(const u8_t *data)
             prov_clear_tx();
 #endif
 
-            atomic_set_bit(link.flags, WAIT_PUB_KEY);
-            BT_WARN("Waiting for local public key");
+            wait_pub_key();
             return;
         }
     }
@@ -1132,12 +1251,28 @@ static void pub_key_ready(const u8_t *pkey)
 {
     if (!pkey) {
         BT_WARN("Public key not available");
+
+        /* Only a generation of ours gets retried; another user's is
+         * still running and reports here when done.
+         */
+        if (key_gen_at) {
+            key_gen_at = 0;
+            k_delayed_work_submit(&key_retry, KEY_GEN_RETRY);
+        }
+
         return;
     }
 
-    BT_DBG("Local public key ready");
+    if (key_gen_at) {
+        key_gen_ms = k_uptime_get_32() - key_gen_at;
+        key_gen_at = 0;
+    }
+
+    BT_DBG("Local public key ready in %u ms", key_gen_ms);
 
     if (atomic_test_and_clear_bit(link.flags, WAIT_PUB_KEY)) {
+        timing.key_wait_ms = k_uptime_get_32() - key_wait_at;
+
         if (atomic_test_bit(link.flags, PROVISIONER)) {
             send_pub_key();
         } else {
@@ -1248,10 +1383,6 @@ static void prov_complete(const u8_t *data)
            bt_hex(node->dev_key, 16), node->net_idx, node->num_elem,
            node->addr);
 
-    if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
-        bt_mesh_store_cdb_node(node);
-    }
-
     link.provisioner->node = NULL;
     link.expect = PROV_NO_PDU;
     atomic_set_bit(link.flags, LINK_CLOSING);
@@ -1265,6 +1396,8 @@ static void prov_complete(const u8_t *data)
                          node->num_elem);
     }
 
+    bt_mesh_provisioner_node_added();
+
     /*
      * According to mesh profile spec (5.3.1.4.3), the close message should
      * be restransmitted at least three times. Retransmit the LINK_CLOSE
@@ -1452,6 +1585,9 @@ static void prov_data(const u8_t *data)
         return;
     }
 
+    BT_INFO("Provisioned in %u ms (key wait %u ms, DHKey %u ms)",
+            timing.total_ms, timing.key_wait_ms, timing.dh_ms);
+
     /* After PB-GATT provisioning we should start advertising
      * using Node Identity.
      */
@@ -1464,6 +1600,11 @@ static void prov_data(const u8_t *data)
 static void prov_failed(const u8_t *data)
 {
     BT_WARN("Error: 0x%02x", data[0]);
+
+    if (IS_ENABLED(CONFIG_BT_MESH_PROVISIONER) &&
+        atomic_test_bit(link.flags, PROVISIONER)) {
+        prov_send_fail_msg(PROV_ERR_NONE);
+    }
 }
 
 static const struct {
@@ -1562,6 +1703,7 @@ static void link_open(struct prov_rx *rx, struct net_buf_simple *buf)
     link.id = rx->link_id;
     atomic_set_bit(link.flags, LINK_ACTIVE);
     net_buf_simple_reset(link.rx.buf);
+    timing_link_open();
 
     bearer_ctl_send(LINK_ACK, NULL, 0);
 
@@ -1683,6 +1825,7 @@ static void prov_msg_recv(void)
     }
 
     BT_DBG("\nprov_msg_recv RX \"%s\"\n", prov_handlers_name_table[type]);
+    timing_pdu(type);
     prov_handlers[type].func(&link.rx.buf->data[1]);
 }
 
@@ -1752,8 +1895,7 @@ static void gen_prov_ack(struct prov_rx *rx, struct net_buf_simple *buf)
         if (IS_ENABLED(CONFIG_BT_MESH_PROVISIONER) &&
             atomic_test_and_clear_bit(link.flags, SEND_PUB_KEY)) {
             if (!bt_pub_key_get()) {
-                atomic_set_bit(link.flags, WAIT_PUB_KEY);
-                BT_WARN("Waiting for local public key");
+                wait_pub_key();
             } else {
                 send_pub_key();
             }
@@ -1936,6 +2078,7 @@ int bt_mesh_pb_gatt_recv(struct bt_conn *conn, struct net_buf_simple *buf)
         return -EINVAL;
     }
 
+    timing_pdu(type);
     prov_handlers[type].func(buf->data);
 
     return 0;
@@ -1951,6 +2094,7 @@ int bt_mesh_pb_gatt_open(struct bt_conn *conn)
 
     link.conn = bt_conn_ref(conn);
     link.expect = PROV_INVITE;
+    timing_link_open();
 
     if (prov->link_open) {
         prov->link_open(BT_MESH_PROV_GATT);
@@ -2017,6 +2161,8 @@ int bt_mesh_prov_init(const struct bt_mesh_prov *prov_info)
     }
 
     k_delayed_work_init(&link.prot_timer, protocol_timeout);
+    k_delayed_work_init(&link.dh_work, dh_key_gen);
+    k_delayed_work_init(&key_retry, key_pair_retry);
 
     prov = prov_info;
 
@@ -2036,7 +2182,18 @@ void bt_mesh_prov_complete(u16_t net_idx, u16_t addr)
 
 void bt_mesh_prov_reset(void)
 {
+    /* The link that provisioned the node already renewed the key pair */
+    if (!bt_pub_key_get()) {
+        key_pair_gen();
+    }
+
     if (prov->reset) {
         prov->reset();
     }
 }
+
+void bt_mesh_prov_timing_get(struct bt_mesh_prov_timing *stats)
+{
+    *stats = timing;
+    stats->key_gen_ms = key_gen_ms;
+}
@@ -7,6 +7,8 @@
  */
 
 void bt_mesh_pb_adv_recv(struct net_buf_simple *buf);
+int bt_mesh_pb_adv_open(const u8_t uuid[16], u16_t net_idx, u16_t addr,
+                        u8_t attention_duration);
 
 bool bt_prov_active(void);
 
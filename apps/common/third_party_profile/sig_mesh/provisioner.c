@@ -0,0 +1,320 @@
+/*  Bluetooth Mesh */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "adaptation.h"
+#include "net/buf.h"
+#include "mesh.h"
+#include "net.h"
+#include "access.h"
+#include "prov.h"
+#include "provisioner.h"
+
+#define LOG_TAG             "[MESH-provisioner]"
+#define LOG_INFO_ENABLE
+#define LOG_DEBUG_ENABLE
+#define LOG_WARN_ENABLE
+#define LOG_ERROR_ENABLE
+#define LOG_DUMP_ENABLE
+#include "mesh_log.h"
+
+#if MESH_RAM_AND_CODE_MAP_DETAIL
+#ifdef SUPPORT_MS_EXTENSIONS
+#pragma bss_seg(".ble_mesh_provisioner_bss")
+#pragma data_seg(".ble_mesh_provisioner_data")
+#pragma const_seg(".ble_mesh_provisioner_const")
+#pragma code_seg(".ble_mesh_provisioner_code")
+#endif
+#else /* MESH_RAM_AND_CODE_MAP_DETAIL */
+#pragma bss_seg(".ble_mesh_bss")
+#pragma data_seg(".ble_mesh_data")
+#pragma const_seg(".ble_mesh_const")
+#pragma code_seg(".ble_mesh_code")
+#endif /* MESH_RAM_AND_CODE_MAP_DETAIL */
+
+#if CONFIG_BT_MESH_PROVISIONER
+
+#if !defined(CONFIG_BT_MESH_PB_ADV)
+#error "CONFIG_BT_MESH_PROVISIONER needs CONFIG_BT_MESH_PB_ADV"
+#endif
+
+/* Pause between a link closing and the next one opening */
+#define LINK_GAP               K_MSEC(100)
+/* Retry interval while the bearer is held by another link */
+#define LINK_RETRY             K_SECONDS(1)
+
+enum {
+    DEV_FREE,              /* Unused table entry */
+    DEV_IDLE,              /* Heard, waiting for a link */
+    DEV_BUSY,              /* Link open */
+    DEV_FAILED,            /* Out of attempts, entry may be reused */
+};
+
+struct unprov_dev {
+    u8_t  uuid[16];
+    u8_t  state;
+    u8_t  attempts;
+    u32_t seen_at;
+};
+
+static struct unprov_dev devs[CONFIG_BT_MESH_PROV_DEV_TABLE_SIZE];
+
+static struct {
+    bool  enabled;
+    bool  done;            /* The current link produced a node */
+    u16_t net_idx;
+    u8_t  attention;
+
+    struct unprov_dev *cur;
+    u32_t link_at;
+
+    struct k_delayed_work next_link;
+} prv;
+
+static struct bt_mesh_provisioner_stats stats;
+static u32_t first_link_at;
+static u32_t provisioned_ms;
+
+static struct unprov_dev *dev_next(void)
+{
+    struct unprov_dev *next = NULL;
+    int i;
+
+    /* First heard, first served */
+    for (i = 0; i < ARRAY_SIZE(devs); i++) {
+        if (devs[i].state != DEV_IDLE) {
+            continue;
+        }
+
+        if (!next || (s32_t)(devs[i].seen_at - next->seen_at) < 0) {
+            next = &devs[i];
+        }
+    }
+
+    return next;
+}
+
+static void link_next(struct k_work *work)
+{
+    struct unprov_dev *dev;
+    int err;
+
+    if (!prv.enabled || prv.cur) {
+        return;
+    }
+
+    dev = dev_next();
+    if (!dev) {
+        return;
+    }
+
+    err = bt_mesh_pb_adv_open(dev->uuid, prv.net_idx,
+                              BT_MESH_ADDR_UNASSIGNED, prv.attention);
+    if (err) {
+        BT_DBG("Link busy (err %d)", err);
+        k_delayed_work_submit(&prv.next_link, LINK_RETRY);
+        return;
+    }
+
+    prv.cur = dev;
+    prv.done = false;
+    prv.link_at = k_uptime_get_32();
+
+    if (!first_link_at) {
+        first_link_at = prv.link_at | 1;
+    }
+
+    dev->state = DEV_BUSY;
+    dev->attempts++;
+    stats.started++;
+
+    BT_DBG("Provisioning %s, attempt %u", bt_hex(dev->uuid, 16),
+           dev->attempts);
+}
+
+void bt_mesh_provisioner_beacon_recv(struct net_buf_simple *buf)
+{
+    const struct bt_mesh_prov *prov = bt_mesh_prov_get();
+    struct unprov_dev *slot = NULL;
+    bt_mesh_prov_oob_info_t oob_info;
+    u32_t uri_hash, *hash = NULL;
+    u8_t *uuid;
+    int i;
+
+    if (!bt_mesh_cdb.valid) {
+        return;
+    }
+
+    if (buf->len != 18 && buf->len != 22) {
+        BT_WARN("Invalid unprovisioned beacon length (%u)", buf->len);
+        return;
+    }
+
+    uuid = buf->data;
+    net_buf_simple_pull(buf, 16);
+    oob_info = (bt_mesh_prov_oob_info_t)net_buf_simple_pull_be16(buf);
+
+    if (buf->len == 4) {
+        uri_hash = net_buf_simple_pull_be32(buf);
+        hash = &uri_hash;
+    }
+
+    /* Nodes keep beaconing until the Complete PDU is through */
+    if (bt_mesh_cdb_node_get_by_uuid(uuid)) {
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(devs); i++) {
+        struct unprov_dev *dev = &devs[i];
+
+        if (dev->state == DEV_FREE) {
+            if (!slot || slot->state != DEV_FREE) {
+                slot = dev;
+            }
+
+            continue;
+        }
+
+        if (!memcmp(dev->uuid, uuid, 16)) {
+            dev->seen_at = k_uptime_get_32();
+            return;
+        }
+
+        if (dev->state == DEV_FAILED &&
+            (!slot || (slot->state == DEV_FAILED &&
+                       (s32_t)(dev->seen_at - slot->seen_at) < 0))) {
+            slot = dev;
+        }
+    }
+
+    if (!slot) {
+        BT_DBG("Unprovisioned device table full");
+        return;
+    }
+
+    memcpy(slot->uuid, uuid, 16);
+    slot->state = DEV_IDLE;
+    slot->attempts = 0;
+    slot->seen_at = k_uptime_get_32();
+    stats.seen++;
+
+    BT_DBG("Unprovisioned device %s", bt_hex(uuid, 16));
+
+    if (prov && prov->unprovisioned_beacon) {
+        prov->unprovisioned_beacon(uuid, oob_info, hash);
+    }
+
+    if (prv.enabled && !prv.cur &&
+        !k_delayed_work_remaining_get(&prv.next_link)) {
+        k_delayed_work_submit(&prv.next_link, 0);
+    }
+}
+
+void bt_mesh_provisioner_node_added(void)
+{
+    if (!prv.cur) {
+        return;
+    }
+
+    prv.done = true;
+    stats.provisioned++;
+    provisioned_ms += k_uptime_get_32() - prv.link_at;
+}
+
+void bt_mesh_provisioner_link_closed(void)
+{
+    struct unprov_dev *dev = prv.cur;
+
+    if (!dev) {
+        return;
+    }
+
+    if (prv.done) {
+        (void)memset(dev, 0, sizeof(*dev));
+    } else {
+        stats.failed++;
+
+        if (dev->attempts >= CONFIG_BT_MESH_PROV_ATTEMPTS) {
+            BT_WARN("Giving up on %s", bt_hex(dev->uuid, 16));
+            dev->state = DEV_FAILED;
+        } else {
+            dev->state = DEV_IDLE;
+        }
+    }
+
+    prv.cur = NULL;
+
+    if (prv.enabled) {
+        k_delayed_work_submit(&prv.next_link, LINK_GAP);
+    }
+}
+
+int bt_mesh_provision_adv(const u8_t uuid[16], u16_t net_idx, u16_t addr,
+                          u8_t attention_duration)
+{
+    if (!bt_mesh_cdb.valid) {
+        return -EINVAL;
+    }
+
+    if (bt_mesh_cdb_node_get_by_uuid(uuid)) {
+        return -EALREADY;
+    }
+
+    return bt_mesh_pb_adv_open(uuid, net_idx, addr, attention_duration);
+}
+
+int bt_mesh_provisioner_enable(u16_t net_idx, u8_t attention_duration)
+{
+    if (!bt_mesh_cdb.valid) {
+        return -EINVAL;
+    }
+
+    if (!bt_mesh_cdb_subnet_get(net_idx)) {
+        return -ENOENT;
+    }
+
+    k_delayed_work_init(&prv.next_link, link_next);
+
+    prv.net_idx = net_idx;
+    prv.attention = attention_duration;
+    prv.enabled = true;
+
+    k_delayed_work_submit(&prv.next_link, 0);
+
+    return 0;
+}
+
+void bt_mesh_provisioner_disable(void)
+{
+    prv.enabled = false;
+    k_delayed_work_cancel(&prv.next_link);
+}
+
+void bt_mesh_provisioner_stats_get(struct bt_mesh_provisioner_stats *out)
+{
+    *out = stats;
+
+    if (first_link_at) {
+        out->active_ms = k_uptime_get_32() - first_link_at;
+    }
+
+    if (stats.provisioned) {
+        out->avg_ms = provisioned_ms / stats.provisioned;
+    }
+
+    if (out->active_ms) {
+        out->per_min_x10 = (u64_t)stats.provisioned * 600000 /
+                           out->active_ms;
+    }
+}
+
+void bt_mesh_provisioner_stats_reset(void)
+{
+    (void)memset(&stats, 0, sizeof(stats));
+    first_link_at = 0;
+    provisioned_ms = 0;
+}
+
+#endif /* CONFIG_BT_MESH_PROVISIONER */
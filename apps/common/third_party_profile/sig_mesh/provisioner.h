@@ -0,0 +1,15 @@
+/*  Bluetooth Mesh */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+struct tc_aes_key_sched_struct;
+
+void bt_mesh_provisioner_beacon_recv(struct net_buf_simple *buf);
+
+void bt_mesh_provisioner_node_added(void);
+void bt_mesh_provisioner_link_closed(void);
+
+/* Expanded DevKey of the node owning addr, NULL if it is not ours */
+struct tc_aes_key_sched_struct *bt_mesh_cdb_dev_key_get(u16_t addr);
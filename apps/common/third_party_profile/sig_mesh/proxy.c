@@ -48,6 +48,11 @@
  */
 #define PROXY_SAR_TIMEOUT  K_SECONDS(20)
 
+/* Retry for queued notifications, in case ATT_EVENT_CAN_SEND_NOW does
+ * not come, e.g. because another user of the ATT layer took it.
+ */
+#define PROXY_TX_RETRY     K_MSEC(10)
+
 #define SAR_COMPLETE       0x00
 #define SAR_FIRST          0x01
 #define SAR_CONT           0x02
@@ -62,11 +67,29 @@
 
 #define CLIENT_BUF_SIZE 68
 
+/* Length of each queued notification, little endian */
+#define TXQ_HDR_LEN     2
+
 #define ID_TYPE_NODE 0x01
 
+#if (CONFIG_BT_MESH_PROXY_FILTER_HASH_SIZE & (CONFIG_BT_MESH_PROXY_FILTER_HASH_SIZE - 1))
+#error "CONFIG_BT_MESH_PROXY_FILTER_HASH_SIZE must be a power of two"
+#endif
+
+/* At most half full, so probe sequences stay short */
+#if (CONFIG_BT_MESH_PROXY_FILTER_HASH_SIZE < 2 * CONFIG_BT_MESH_PROXY_FILTER_SIZE)
+#error "CONFIG_BT_MESH_PROXY_FILTER_HASH_SIZE must be at least twice CONFIG_BT_MESH_PROXY_FILTER_SIZE"
+#endif
+
+#define FILTER_HASH_MASK   (CONFIG_BT_MESH_PROXY_FILTER_HASH_SIZE - 1)
+
 static struct bt_mesh_proxy_client {
     struct bt_conn *conn;
-    u16_t filter[CONFIG_BT_MESH_PROXY_FILTER_SIZE];
+    /* Open addressing on the address itself, unassigned marks a free
+     * slot.
+     */
+    u16_t filter[CONFIG_BT_MESH_PROXY_FILTER_HASH_SIZE];
+    u16_t filter_count;
     enum __packed {
         NONE,
         WHITELIST,
@@ -76,6 +99,12 @@ static struct bt_mesh_proxy_client {
     u8_t msg_type;
     struct k_delayed_work    sar_timer;
     struct net_buf_simple    buf;
+    u32_t connected_at;
+    struct bt_mesh_proxy_client_stats stats;
+    struct k_delayed_work    tx_timer;
+    /* Notifications waiting for ATT buffers, each behind its length */
+    u16_t txq_len;
+    u8_t  txq[CONFIG_BT_MESH_PROXY_TX_QUEUE_SIZE];
 } clients[CONFIG_BT_MAX_CONN];
 
 static u8_t __noinit client_buf_data[CLIENT_BUF_SIZE * CONFIG_BT_MAX_CONN];
@@ -113,10 +142,36 @@ static void proxy_sar_timeout(struct k_work *work)
     }
 }
 
+static void filter_clear(struct bt_mesh_proxy_client *client)
+{
+    (void)memset(client->filter, 0, sizeof(client->filter));
+    client->filter_count = 0U;
+}
+
 #if defined(CONFIG_BT_MESH_GATT_PROXY)
 
-static int proxy_segment_and_send(struct bt_conn *conn, u8_t type,
-                                  struct net_buf_simple *msg);
+static int proxy_segment_and_send(struct bt_mesh_proxy_client *client,
+                                  u8_t type, struct net_buf_simple *msg);
+
+static inline u16_t filter_bucket(u16_t addr)
+{
+    u32_t h = addr * 0x9e3779b1;
+
+    return (h >> 16) & FILTER_HASH_MASK;
+}
+
+/* Slot holding addr, or the free slot ending its probe run */
+static u16_t filter_slot(struct bt_mesh_proxy_client *client, u16_t addr)
+{
+    u16_t i = filter_bucket(addr);
+
+    while (client->filter[i] != BT_MESH_ADDR_UNASSIGNED &&
+           client->filter[i] != addr) {
+        i = (i + 1) & FILTER_HASH_MASK;
+    }
+
+    return i;
+}
 
 static int filter_set(struct bt_mesh_proxy_client *client,
                       struct net_buf_simple *buf)
@@ -133,11 +188,11 @@ static int filter_set(struct bt_mesh_proxy_client *client,
 
     switch (type) {
     case 0x00:
-        (void)memset(client->filter, 0, sizeof(client->filter));
+        filter_clear(client);
         client->filter_type = WHITELIST;
         break;
     case 0x01:
-        (void)memset(client->filter, 0, sizeof(client->filter));
+        filter_clear(client);
         client->filter_type = BLACKLIST;
         break;
     default:
@@ -150,7 +205,7 @@ static int filter_set(struct bt_mesh_proxy_client *client,
 
 static void filter_add(struct bt_mesh_proxy_client *client, u16_t addr)
 {
-    int i;
+    u16_t i;
 
     BT_DBG("addr 0x%04x", addr);
 
@@ -158,23 +213,23 @@ static void filter_add(struct bt_mesh_proxy_client *client, u16_t addr)
         return;
     }
 
-    for (i = 0; i < ARRAY_SIZE(client->filter); i++) {
-        if (client->filter[i] == addr) {
-            return;
-        }
+    i = filter_slot(client, addr);
+    if (client->filter[i] == addr) {
+        return;
     }
 
-    for (i = 0; i < ARRAY_SIZE(client->filter); i++) {
-        if (client->filter[i] == BT_MESH_ADDR_UNASSIGNED) {
-            client->filter[i] = addr;
-            return;
-        }
+    if (client->filter_count >= CONFIG_BT_MESH_PROXY_FILTER_SIZE) {
+        BT_WARN("Proxy filter full, 0x%04x not added", addr);
+        return;
     }
+
+    client->filter[i] = addr;
+    client->filter_count++;
 }
 
 static void filter_remove(struct bt_mesh_proxy_client *client, u16_t addr)
 {
-    int i;
+    u16_t i, j, home;
 
     BT_DBG("addr 0x%04x", addr);
 
@@ -182,12 +237,29 @@ static void filter_remove(struct bt_mesh_proxy_client *client, u16_t addr)
         return;
     }
 
-    for (i = 0; i < ARRAY_SIZE(client->filter); i++) {
-        if (client->filter[i] == addr) {
-            client->filter[i] = BT_MESH_ADDR_UNASSIGNED;
-            return;
+    i = filter_slot(client, addr);
+    if (client->filter[i] != addr) {
+        return;
+    }
+
+    /* Backward shift deletion: pull up every following entry of the
+     * probe run whose home bucket does not lie in (i, j].
+     */
+    for (j = (i + 1) & FILTER_HASH_MASK;
+         client->filter[j] != BT_MESH_ADDR_UNASSIGNED;
+         j = (j + 1) & FILTER_HASH_MASK) {
+        home = filter_bucket(client->filter[j]);
+
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j)) {
+            continue;
         }
+
+        client->filter[i] = client->filter[j];
+        i = j;
     }
+
+    client->filter[i] = BT_MESH_ADDR_UNASSIGNED;
+    client->filter_count--;
 }
 
 static void send_filter_status(struct bt_mesh_proxy_client *client,
@@ -199,8 +271,7 @@ static void send_filter_status(struct bt_mesh_proxy_client *client,
         .ctx = &rx->ctx,
         .src = bt_mesh_primary_addr(),
     };
-    u16_t filter_size;
-    int i, err;
+    int err;
 
     /* Configuration messages always have dst unassigned */
     tx.ctx->addr = BT_MESH_ADDR_UNASSIGNED;
@@ -216,13 +287,7 @@ static void send_filter_status(struct bt_mesh_proxy_client *client,
         net_buf_simple_add_u8(buf, 0x01);
     }
 
-    for (filter_size = 0U, i = 0; i < ARRAY_SIZE(client->filter); i++) {
-        if (client->filter[i] != BT_MESH_ADDR_UNASSIGNED) {
-            filter_size++;
-        }
-    }
-
-    net_buf_simple_add_be16(buf, filter_size);
+    net_buf_simple_add_be16(buf, client->filter_count);
 
     BT_DBG("%u bytes: %s", buf->len, bt_hex(buf->data, buf->len));
 
@@ -232,7 +297,7 @@ static void send_filter_status(struct bt_mesh_proxy_client *client,
         return;
     }
 
-    err = proxy_segment_and_send(client->conn, BT_MESH_PROXY_CONFIG, buf);
+    err = proxy_segment_and_send(client, BT_MESH_PROXY_CONFIG, buf);
     if (err) {
         BT_ERR("Failed to send proxy cfg message (err %d)", err);
     }
@@ -292,7 +357,8 @@ static void proxy_cfg(struct bt_mesh_proxy_client *client)
     }
 }
 
-static int beacon_send(struct bt_conn *conn, struct bt_mesh_subnet *sub)
+static int beacon_send(struct bt_mesh_proxy_client *client,
+                       struct bt_mesh_subnet *sub)
 {
     BT_INFO("--func=%s", __FUNCTION__);
 
@@ -301,7 +367,7 @@ static int beacon_send(struct bt_conn *conn, struct bt_mesh_subnet *sub)
     net_buf_simple_reserve(&buf, 1);
     bt_mesh_beacon_create(sub, &buf);
 
-    return proxy_segment_and_send(conn, BT_MESH_PROXY_BEACON, &buf);
+    return proxy_segment_and_send(client, BT_MESH_PROXY_BEACON, &buf);
 }
 
 static void proxy_send_beacons(struct bt_mesh_proxy_client *client)
@@ -314,7 +380,7 @@ static void proxy_send_beacons(struct bt_mesh_proxy_client *client)
         struct bt_mesh_subnet *sub = &bt_mesh.sub[i];
 
         if (sub->net_idx != BT_MESH_KEY_UNUSED) {
-            beacon_send(client->conn, sub);
+            beacon_send(client, sub);
         }
     }
 }
@@ -336,7 +402,7 @@ void bt_mesh_proxy_beacon_send(struct bt_mesh_subnet *sub)
 
     for (i = 0; i < ARRAY_SIZE(clients); i++) {
         if (clients[i].conn) {
-            beacon_send(clients[i].conn, sub);
+            beacon_send(&clients[i], sub);
         }
     }
 }
@@ -420,6 +486,8 @@ int bt_mesh_proxy_identity_enable(void)
 
 static void proxy_complete_pdu(struct bt_mesh_proxy_client *client)
 {
+    client->stats.rx_pdus++;
+
     switch (client->msg_type) {
 #if defined(CONFIG_BT_MESH_GATT_PROXY)
     case BT_MESH_PROXY_NET_PDU:
@@ -476,6 +544,8 @@ ssize_t proxy_recv(struct bt_conn *conn,
         return -EINVAL;
     }
 
+    client->stats.rx_bytes += len;
+
     BT_INFO("PDU_SAR(data)=0x%x\r\n", PDU_SAR(data));
     switch (PDU_SAR(data)) {
     case SAR_COMPLETE:
@@ -565,8 +635,12 @@ static void proxy_connected(struct bt_conn *conn, u8_t err)
 
     client->conn = bt_conn_ref(conn);
     client->filter_type = NONE;
-    (void)memset(client->filter, 0, sizeof(client->filter));
+    filter_clear(client);
     net_buf_simple_reset(&client->buf);
+
+    (void)memset(&client->stats, 0, sizeof(client->stats));
+    client->connected_at = k_uptime_get_32();
+    client->txq_len = 0U;
 }
 
 static void proxy_disconnected(struct bt_conn *conn, u8_t reason)
@@ -587,6 +661,8 @@ static void proxy_disconnected(struct bt_conn *conn, u8_t reason)
             }
 
             k_delayed_work_cancel(&client->sar_timer);
+            k_delayed_work_cancel(&client->tx_timer);
+            client->txq_len = 0U;
             bt_conn_unref(client->conn);
             client->conn = NULL;
             break;
@@ -817,33 +893,22 @@ void bt_mesh_proxy_addr_add(struct net_buf_simple *buf, u16_t addr)
 static bool client_filter_match(struct bt_mesh_proxy_client *client,
                                 u16_t addr)
 {
-    int i;
+    bool listed;
 
     BT_DBG("filter_type %u addr 0x%04x", client->filter_type, addr);
 
-    if (client->filter_type == BLACKLIST) {
-        for (i = 0; i < ARRAY_SIZE(client->filter); i++) {
-            if (client->filter[i] == addr) {
-                return false;
-            }
-        }
+    listed = (addr != BT_MESH_ADDR_UNASSIGNED &&
+              client->filter[filter_slot(client, addr)] == addr);
 
-        return true;
+    if (client->filter_type == BLACKLIST) {
+        return !listed;
     }
 
     if (addr == BT_MESH_ADDR_ALL_NODES) {
         return true;
     }
 
-    if (client->filter_type == WHITELIST) {
-        for (i = 0; i < ARRAY_SIZE(client->filter); i++) {
-            if (client->filter[i] == addr) {
-                return true;
-            }
-        }
-    }
-
-    return false;
+    return client->filter_type == WHITELIST && listed;
 }
 
 bool bt_mesh_proxy_relay(struct net_buf_simple *buf, u16_t dst)
@@ -853,25 +918,31 @@ bool bt_mesh_proxy_relay(struct net_buf_simple *buf, u16_t dst)
 
     BT_DBG("%u bytes to dst 0x%04x", buf->len, dst);
 
+#if !NET_BUF_FREE_EN
+    /* Adv buffers have no AD header room in front of the data here */
+    NET_BUF_SIMPLE_DEFINE(msg, 32);
+
+    net_buf_simple_reserve(&msg, 1);
+    net_buf_simple_add_mem(&msg, buf->data, buf->len);
+    buf = &msg;
+#endif /* NET_BUF_FREE_EN */
+
     for (i = 0; i < ARRAY_SIZE(clients); i++) {
         struct bt_mesh_proxy_client *client = &clients[i];
-        NET_BUF_SIMPLE_DEFINE(msg, 32);
 
         if (!client->conn) {
             continue;
         }
 
         if (!client_filter_match(client, dst)) {
+            client->stats.relay_filtered++;
             continue;
         }
 
-        /* Proxy PDU sending modifies the original buffer,
-         * so we need to make a copy.
+        /* Sending leaves the buffer as it was, so every client and the
+         * advertising bearer get the same one.
          */
-        net_buf_simple_reserve(&msg, 1);
-        net_buf_simple_add_mem(&msg, buf->data, buf->len);
-
-        bt_mesh_proxy_send(client->conn, BT_MESH_PROXY_NET_PDU, &msg);
+        bt_mesh_proxy_send(client->conn, BT_MESH_PROXY_NET_PDU, buf);
         relayed = true;
     }
 
@@ -901,41 +972,178 @@ static int proxy_send(struct bt_conn *conn, const void *data, u16_t len)
     return 0;
 }
 
-static int proxy_segment_and_send(struct bt_conn *conn, u8_t type,
-                                  struct net_buf_simple *msg)
+static int proxy_notify(struct bt_mesh_proxy_client *client,
+                        const void *data, u16_t len)
+{
+    int err;
+
+    /* Whoever gets -ENOBUFS queues the PDU, flushed on CAN_SEND_NOW */
+    if (bt_gatt_notify_room(client->conn) < len) {
+        bt_gatt_notify_request(client->conn);
+        return -ENOBUFS;
+    }
+
+    err = proxy_send(client->conn, data, len);
+    if (err) {
+        client->stats.tx_failed++;
+        return err;
+    }
+
+    client->stats.tx_notify++;
+    client->stats.tx_bytes += len;
+
+    return 0;
+}
+
+/* Send queued notifications in order until the ATT layer is out of room.
+ * An entry the stack rejects for any other reason would block the queue
+ * for good, so it is dropped (and counted as failed) instead.
+ */
+static void proxy_tx_flush(struct bt_mesh_proxy_client *client)
+{
+    u16_t off = 0U, len;
+    int err;
+
+    while (off < client->txq_len) {
+        len = sys_get_le16(&client->txq[off]);
+        err = proxy_notify(client, &client->txq[off + TXQ_HDR_LEN], len);
+        if (err == -ENOBUFS) {
+            break;
+        }
+
+        if (err) {
+            BT_WARN("Queued proxy PDU dropped (err %d)", err);
+        }
+
+        off += TXQ_HDR_LEN + len;
+    }
+
+    if (off) {
+        client->txq_len -= off;
+        memmove(client->txq, &client->txq[off], client->txq_len);
+    }
+
+    if (client->txq_len) {
+        k_delayed_work_submit(&client->tx_timer, PROXY_TX_RETRY);
+    } else {
+        k_delayed_work_cancel(&client->tx_timer);
+    }
+}
+
+static void proxy_tx_retry(struct k_work *work)
+{
+    struct bt_mesh_proxy_client *client;
+
+    client = CONTAINER_OF(work, struct bt_mesh_proxy_client, tx_timer);
+    if (client->conn) {
+        proxy_tx_flush(client);
+    }
+}
+
+void bt_mesh_proxy_can_send_now(void)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(clients); i++) {
+        if (clients[i].conn && clients[i].txq_len) {
+            proxy_tx_flush(&clients[i]);
+        }
+    }
+}
+
+/* Send len bytes at data behind a one byte PDU header. The header takes
+ * the byte in front of data for the duration of the call, which keeps the
+ * payload in place and leaves the caller's buffer unchanged. What the ATT
+ * layer has no room for yet is copied to the queue, which the caller made
+ * room in; a PDU the stack rejects otherwise is dropped.
+ */
+static void proxy_send_pdu(struct bt_mesh_proxy_client *client, u8_t hdr,
+                           u8_t *data, u16_t len)
+{
+    u8_t saved = data[-1];
+    u8_t *entry;
+
+    /* Nothing may overtake what is queued already */
+    if (!client->txq_len) {
+        int err;
+
+        data[-1] = hdr;
+        err = proxy_notify(client, data - 1, len + 1);
+        data[-1] = saved;
+
+        if (err != -ENOBUFS) {
+            if (err) {
+                BT_WARN("Proxy PDU dropped (err %d)", err);
+            }
+
+            return;
+        }
+    }
+
+    entry = &client->txq[client->txq_len];
+    sys_put_le16(len + 1, entry);
+    entry[TXQ_HDR_LEN] = hdr;
+    memcpy(&entry[TXQ_HDR_LEN + 1], data, len);
+
+    client->txq_len += TXQ_HDR_LEN + 1 + len;
+    client->stats.tx_queued++;
+}
+
+static int proxy_segment_and_send(struct bt_mesh_proxy_client *client,
+                                  u8_t type, struct net_buf_simple *msg)
 {
-    u16_t mtu;
+    struct bt_conn *conn = client->conn;
+    u8_t *data = msg->data;
+    u16_t len = msg->len;
+    u16_t mtu, segs;
 
     BT_INFO("--func=%s", __FUNCTION__);
 
     BT_DBG("conn %p type 0x%02x len %u: %s", conn, type, msg->len,
            bt_hex(msg->data, msg->len));
 
-    /* ATT_MTU - OpCode (1 byte) - Handle (2 bytes) */
-    mtu = bt_gatt_get_mtu(conn) - 3;
-    if (mtu > msg->len) {
-        net_buf_simple_push_u8(msg, PDU_HDR(SAR_COMPLETE, type));
-        BT_INFO("SAR_COMPLETE");
-        return proxy_send(conn, msg->data, msg->len);
+    if (client->txq_len) {
+        proxy_tx_flush(client);
     }
 
-    net_buf_simple_push_u8(msg, PDU_HDR(SAR_FIRST, type));
-    BT_INFO("SAR_FIRST");
-    proxy_send(conn, msg->data, mtu);
-    net_buf_simple_pull(msg, mtu);
+    /* ATT_MTU - OpCode (1 byte) - Handle (2 bytes) - PDU header */
+    mtu = bt_gatt_get_mtu(conn) - 3 - 1;
+    segs = len > mtu ? (len + mtu - 1) / mtu : 1;
+
+    /* Room for every segment in case none of them goes out now, so a
+     * burst never leaves the client with part of a segmented message.
+     */
+    if (client->txq_len + len + segs * (TXQ_HDR_LEN + 1) >
+        sizeof(client->txq)) {
+        BT_WARN("Proxy TX queue full, %u bytes dropped", len);
+        client->stats.tx_dropped++;
+        return -ENOBUFS;
+    }
 
-    while (msg->len) {
-        if (msg->len + 1 < mtu) {
-            net_buf_simple_push_u8(msg, PDU_HDR(SAR_LAST, type));
-            BT_INFO("SAR_LAST");
-            proxy_send(conn, msg->data, msg->len);
-            break;
+    client->stats.tx_pdus++;
+
+    if (len <= mtu) {
+        BT_INFO("SAR_COMPLETE");
+        proxy_send_pdu(client, PDU_HDR(SAR_COMPLETE, type), data, len);
+    } else {
+        BT_INFO("SAR_FIRST");
+        proxy_send_pdu(client, PDU_HDR(SAR_FIRST, type), data, mtu);
+        data += mtu;
+        len -= mtu;
+
+        while (len > mtu) {
+            BT_INFO("SAR_CONT");
+            proxy_send_pdu(client, PDU_HDR(SAR_CONT, type), data, mtu);
+            data += mtu;
+            len -= mtu;
         }
 
-        net_buf_simple_push_u8(msg, PDU_HDR(SAR_CONT, type));
-        BT_INFO("SAR_CONT");
-        proxy_send(conn, msg->data, mtu);
-        net_buf_simple_pull(msg, mtu);
+        BT_INFO("SAR_LAST");
+        proxy_send_pdu(client, PDU_HDR(SAR_LAST, type), data, len);
+    }
+
+    if (client->txq_len && !k_delayed_work_remaining_get(&client->tx_timer)) {
+        k_delayed_work_submit(&client->tx_timer, PROXY_TX_RETRY);
     }
 
     return 0;
@@ -956,7 +1164,38 @@ int bt_mesh_proxy_send(struct bt_conn *conn, u8_t type,
         return -EINVAL;
     }
 
-    return proxy_segment_and_send(conn, type, msg);
+    return proxy_segment_and_send(client, type, msg);
+}
+
+int bt_mesh_proxy_client_stats_get(u8_t idx,
+                                   struct bt_mesh_proxy_client_stats *stats)
+{
+    struct bt_mesh_proxy_client *client;
+
+    if (idx >= ARRAY_SIZE(clients)) {
+        return -EINVAL;
+    }
+
+    client = &clients[idx];
+    if (!client->conn) {
+        return -ENOTCONN;
+    }
+
+    *stats = client->stats;
+    stats->connected_ms = k_uptime_get_32() - client->connected_at;
+    stats->filter_count = client->filter_count;
+
+    return 0;
+}
+
+void bt_mesh_proxy_client_stats_reset(void)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(clients); i++) {
+        (void)memset(&clients[i].stats, 0, sizeof(clients[i].stats));
+        clients[i].connected_at = k_uptime_get_32();
+    }
 }
 
 static struct bt_conn_cb conn_callbacks = {
@@ -978,6 +1217,7 @@ int bt_mesh_proxy_init(void)
         client->buf.__buf = client_buf_data + (i * CLIENT_BUF_SIZE);
 
         k_delayed_work_init(&client->sar_timer, proxy_sar_timeout);
+        k_delayed_work_init(&client->tx_timer, proxy_tx_retry);
     }
 
     bt_conn_cb_register(&conn_callbacks);
@@ -36,6 +36,8 @@
  */
 #define BT_UUID_MESH_PROXY_DATA_OUT       	(0x2ade)
 
+struct bt_mesh_subnet;
+
 int bt_mesh_proxy_prov_enable(void);
 int bt_mesh_proxy_prov_disable(bool);
 
@@ -50,14 +52,44 @@ struct net_buf_simple *bt_mesh_proxy_get_buf(void);
 void bt_mesh_proxy_identity_start(struct bt_mesh_subnet *sub);
 void bt_mesh_proxy_identity_stop(struct bt_mesh_subnet *sub);
 
+/* buf needs one byte in front of data, as adv buffers keep for the AD
+ * header. It is passed on to the clients as is and left unchanged.
+ */
 bool bt_mesh_proxy_relay(struct net_buf_simple *buf, u16_t dst);
 void bt_mesh_proxy_addr_add(struct net_buf_simple *buf, u16_t addr);
 
 int bt_mesh_proxy_send(struct bt_conn *conn, u8_t type,
                        struct net_buf_simple *msg);
 
+/* The ATT layer has room again, send what the clients have queued */
+void bt_mesh_proxy_can_send_now(void);
+
 int bt_mesh_proxy_init(void);
 
+/* Traffic of one Proxy Client connection. The byte counts over
+ * connected_ms give its throughput in each direction.
+ */
+struct bt_mesh_proxy_client_stats {
+    u32_t rx_pdus;        /* Proxy PDUs reassembled from the client */
+    u32_t rx_bytes;       /* Bytes the client wrote */
+    u32_t tx_pdus;        /* Proxy PDUs sent, before segmentation */
+    u32_t tx_notify;      /* Notifications sent */
+    u32_t tx_bytes;       /* Bytes notified */
+    u32_t tx_failed;      /* Notifications refused and dropped */
+    u32_t tx_queued;      /* Notifications that waited for ATT buffers */
+    u32_t tx_dropped;     /* Proxy PDUs dropped with the queue full */
+    u32_t relay_filtered; /* Network PDUs the client's filter held back */
+    u32_t connected_ms;   /* Time since connection or the last reset */
+    u16_t filter_count;   /* Addresses on the client's filter */
+};
+
+/* idx is the client slot, below CONFIG_BT_MAX_CONN. -ENOTCONN if the
+ * slot is not in use.
+ */
+int bt_mesh_proxy_client_stats_get(u8_t idx,
+                                   struct bt_mesh_proxy_client_stats *stats);
+void bt_mesh_proxy_client_stats_reset(void);
+
 ssize_t proxy_recv(struct bt_conn *conn,
                    const void *buf,
                    u16_t len, u16_t offset, u8_t flags);
@@ -12,6 +12,9 @@
 #include "foundation.h"
 #include "proxy.h"
 #include "settings.h"
+#if CONFIG_BT_MESH_STORE_DERIVED_KEYS
+#include "asm/crc16.h"
+#endif
 
 #define LOG_TAG             "[MESH-settings]"
 /* #define LOG_INFO_ENABLE */
@@ -37,25 +40,73 @@
 
 #define MAX_MODEL_NUMS      6
 
+/* Record id layout, spelled out so it can be checked at build time.
+ * Without CONFIG_BT_MESH_STORE_LOG the ids are VM item indexes and have
+ * to end below the log pages, and with them the app's VM range. With the
+ * log they are 16-bit record ids: the ones below STORE_LOG_INDEX can
+ * still be read from the VM items of a node that stored them before the
+ * log, the rest only ever live in the log.
+ *
+ * The VM layout keeps the 10 RPL slots it always had, so that it does not
+ * move with CONFIG_BT_MESH_CRPL; further slots are log only records.
+ */
+#define SETTINGS_VM_CRPL        10
+#define SETTINGS_LOG_CRPL       (CONFIG_BT_MESH_CRPL > SETTINGS_VM_CRPL ? \
+                                 CONFIG_BT_MESH_CRPL - SETTINGS_VM_CRPL : 0)
+#define SETTINGS_INDEX_BASE     20
+#define SETTINGS_RPL_BASE       (SETTINGS_INDEX_BASE + 3)
+#define SETTINGS_MOD_BASE       (SETTINGS_RPL_BASE + SETTINGS_VM_CRPL + \
+                                 CONFIG_BT_MESH_SUBNET_COUNT + \
+                                 CONFIG_BT_MESH_APP_KEY_COUNT + 2)
+#define SETTINGS_LOG_ONLY_BASE  (SETTINGS_MOD_BASE + 6 * MAX_MODEL_NUMS)
+#define SETTINGS_INDEX_END      (SETTINGS_LOG_ONLY_BASE + SETTINGS_LOG_CRPL + \
+                                 2 * CONFIG_BT_MESH_SUBNET_COUNT)
+
+#if CONFIG_BT_MESH_STORE_LOG
+#if (SETTINGS_INDEX_END > CONFIG_BT_MESH_STORE_LOG_ID_MAX)
+#error "Settings records exceed CONFIG_BT_MESH_STORE_LOG_ID_MAX"
+#endif
+#else
+#if (SETTINGS_LOG_ONLY_BASE > CONFIG_BT_MESH_STORE_LOG_INDEX)
+#error "Settings VM items run into the store log pages, lower the key or model counts"
+#endif
+
+#if (CONFIG_BT_MESH_CRPL > SETTINGS_VM_CRPL)
+#error "CONFIG_BT_MESH_CRPL above 10 needs CONFIG_BT_MESH_STORE_LOG"
+#endif
+#endif /* CONFIG_BT_MESH_STORE_LOG */
+
 typedef enum _NODE_INFO_SETTING_INDEX {
     /* NODE_MAC_ADDR_INDEX = 0, */
-    NET_INDEX = 20,
+    NET_INDEX = SETTINGS_INDEX_BASE,
     IV_INDEX,
     SEQ_INDEX,
-    RPL_INDEX,
-    NET_KEY_INDEX = RPL_INDEX + CONFIG_BT_MESH_CRPL,
+    RPL_INDEX = SETTINGS_RPL_BASE,
+    NET_KEY_INDEX = RPL_INDEX + SETTINGS_VM_CRPL,
     APP_KEY_INDEX = NET_KEY_INDEX + CONFIG_BT_MESH_SUBNET_COUNT,
     HB_PUB_INDEX = APP_KEY_INDEX + CONFIG_BT_MESH_APP_KEY_COUNT,
     CFG_INDEX,
 
-    MOD_BIND_INDEX,
+    MOD_BIND_INDEX = SETTINGS_MOD_BASE,
     MOD_SUB_INDEX = MOD_BIND_INDEX + MAX_MODEL_NUMS,
     MOD_PUB_INDEX = MOD_SUB_INDEX + MAX_MODEL_NUMS,
     VND_MOD_BIND_INDEX = MOD_PUB_INDEX + MAX_MODEL_NUMS,
     VND_MOD_SUB_INDEX = VND_MOD_BIND_INDEX + MAX_MODEL_NUMS,
     VND_MOD_PUB_INDEX = VND_MOD_SUB_INDEX + MAX_MODEL_NUMS,
+
+    /* Log only records (CONFIG_BT_MESH_STORE_LOG) */
+    RPL_LOG_INDEX = SETTINGS_LOG_ONLY_BASE,
+    NET_KEY_DERIVED_INDEX = RPL_LOG_INDEX + SETTINGS_LOG_CRPL,
 } NODE_INFO_SETTING_INDEX;
 
+#define RPL_ID(slot) \
+    ((slot) < SETTINGS_VM_CRPL ? RPL_INDEX + (slot) : \
+     RPL_LOG_INDEX + (slot) - SETTINGS_VM_CRPL)
+
+#if CONFIG_BT_MESH_STORE_DERIVED_KEYS && !CONFIG_BT_MESH_STORE_LOG
+#error "CONFIG_BT_MESH_STORE_DERIVED_KEYS needs CONFIG_BT_MESH_STORE_LOG"
+#endif
+
 /* Tracking of what storage changes are pending for App and Net Keys. We
  * track this in a separate array here instead of within the respective
  * bt_mesh_app_key and bt_mesh_subnet structs themselves, since once a key
@@ -68,6 +119,16 @@ static struct key_update {
           clear: 1;      /* 1 if key needs clearing, 0 if storing */
 } key_updates[CONFIG_BT_MESH_APP_KEY_COUNT + CONFIG_BT_MESH_SUBNET_COUNT];
 
+/* All store and clear requests only mark what is dirty (bt_mesh.flags,
+ * rpl->store, key_updates[], mod->flags) and arm this work; the flash is
+ * written in one pass when it fires.
+ */
+static struct k_delayed_work pending_store;
+
+static struct bt_mesh_store_stats store_stats;
+
+static struct bt_mesh_boot_stats boot_stats;
+
 struct net_val {
     u16_t primary_addr;
     u8_t  dev_key[16];
@@ -119,6 +180,18 @@ struct net_key_val {
     u8_t val[2][16];
 } __packed;
 
+/* Keys derived from a NetKey, tagged with a CRC of that NetKey so that a
+ * stale entry is never paired with a newer key.
+ */
+struct net_key_derived_val {
+    u16_t key_crc;
+    struct bt_mesh_net_keys_derived derived;
+} __packed;
+
+/* Two records per bt_mesh.sub[] slot, the NetKey Index is 12 bits wide */
+#define NET_KEY_DERIVED_ID(sub, idx) \
+    (NET_KEY_DERIVED_INDEX + ((sub) - bt_mesh.sub) * 2 + (idx))
+
 /* AppKey storage information */
 struct app_key_val {
     u16_t net_idx;
@@ -161,8 +234,12 @@ struct __mod_pub {
     struct mod_pub_val pub;
 };
 
-static void store_pending(void);
+static void store_pending(struct k_work *work);
 extern void node_info_store(int index, void *buf, u16 len);
+extern void node_info_commit(void);
+extern void node_info_load_begin(void);
+extern void node_info_load_end(void);
+extern u32 node_info_write_count(void);
 extern void node_info_clear(int index, u16 len);
 extern bool node_info_load(int index, void *buf, u16 len);
 
@@ -237,6 +314,14 @@ static void net_set(void)
     }
 
     memcpy(bt_mesh.dev_key, net.dev_key, sizeof(bt_mesh.dev_key));
+    err = bt_mesh_aes_key_expand(bt_mesh.dev_key, &bt_mesh.dev_key_sched);
+    if (err) {
+        bt_mesh_comp_unprovision();
+        (void)memset(bt_mesh.dev_key, 0, sizeof(bt_mesh.dev_key));
+        BT_ERR("<net_set> DevKey expansion failed (err %d)", err);
+        return;
+    }
+
     bt_mesh_comp_provision(net.primary_addr);
 
     BT_DBG("Provisioned with primary address 0x%04x", net.primary_addr);
@@ -294,52 +379,25 @@ static void seq_set(void)
     BT_DBG("Sequence Number 0x%06x", bt_mesh.seq);
 }
 
-static struct bt_mesh_rpl *rpl_find(u16_t src)
-{
-    int i;
-
-    for (i = 0; i < ARRAY_SIZE(bt_mesh.rpl); i++) {
-        if (bt_mesh.rpl[i].src == src) {
-            return &bt_mesh.rpl[i];
-        }
-    }
-
-    return NULL;
-}
-
-static struct bt_mesh_rpl *rpl_alloc(u16_t src)
-{
-    int i;
-
-    for (i = 0; i < ARRAY_SIZE(bt_mesh.rpl); i++) {
-        if (!bt_mesh.rpl[i].src) {
-            bt_mesh.rpl[i].src = src;
-            return &bt_mesh.rpl[i];
-        }
-    }
-
-    return NULL;
-}
-
 static void rpl_set(void)
 {
     struct bt_mesh_rpl *entry;
     struct __rpl_val __rpl;
     int err;
-    u8 index;
+    u16 index;
 
     BT_INFO("\n < --%s-- >", __FUNCTION__);
 
     for (index = 0; index < CONFIG_BT_MESH_CRPL; index++) {
-        err = node_info_load(RPL_INDEX + index, &__rpl, sizeof(__rpl));
+        err = node_info_load(RPL_ID(index), &__rpl, sizeof(__rpl));
         if (err) {
             BT_ERR("<rpl_set> memory load fail for index:0x%x", index);
             continue;
         }
 
-        entry = rpl_find(__rpl.src);
+        entry = bt_mesh_rpl_find(__rpl.src);
         if (!entry) {
-            entry = rpl_alloc(__rpl.src);
+            entry = bt_mesh_rpl_alloc(__rpl.src);
             if (!entry) {
                 BT_ERR("Unable to allocate RPL entry for 0x%04x", __rpl.src);
                 return;
@@ -438,6 +496,8 @@ static void app_key_set(void)
 
         bt_mesh_app_id(app->keys[0].val, &app->keys[0].id);
         bt_mesh_app_id(app->keys[1].val, &app->keys[1].id);
+        bt_mesh_aes_key_expand(app->keys[0].val, &app->keys[0].sched);
+        bt_mesh_aes_key_expand(app->keys[1].val, &app->keys[1].sched);
 
         BT_DBG("AppKeyIndex 0x%03x recovered from storage", app_idx);
     }
@@ -511,7 +571,7 @@ static void mod_set_bind(bool vnd, u8 model_count)
     u8_t elem_idx, mod_idx;
     struct __mod_bind _mod_bind;
 
-    u8 load_index = vnd ? VND_MOD_BIND_INDEX : MOD_BIND_INDEX;
+    u16 load_index = vnd ? VND_MOD_BIND_INDEX : MOD_BIND_INDEX;
 
     BT_INFO("< --%s-- >", __FUNCTION__);
 
@@ -544,7 +604,7 @@ static void mod_set_sub(bool vnd, u8 model_count)
 
     BT_INFO("< --%s-- >", __FUNCTION__);
 
-    u8 load_index = vnd ? VND_MOD_SUB_INDEX : MOD_SUB_INDEX;
+    u16 load_index = vnd ? VND_MOD_SUB_INDEX : MOD_SUB_INDEX;
 
     for (u8 i = 0; i < model_count; i++) {
         err = node_info_load(load_index + i, &_mod_sub, sizeof(_mod_sub));
@@ -559,6 +619,7 @@ static void mod_set_sub(bool vnd, u8 model_count)
 
         mod = bt_mesh_model_get(vnd, elem_idx, mod_idx);
         memcpy((u8 *)mod->groups, (u8 *)_mod_sub.groups, sizeof(mod->groups));
+        bt_mesh_model_sub_changed();
 
         BT_INFO("Decoded %u subscribed group addresses for model",
                 sizeof(mod->groups) / sizeof(mod->groups[0]));
@@ -574,7 +635,7 @@ static void mod_set_pub(bool vnd, u8 model_count)
     u8_t elem_idx, mod_idx;
     struct __mod_pub _mod_pub;
 
-    u8 load_index = vnd ? VND_MOD_PUB_INDEX : MOD_PUB_INDEX;
+    u16 load_index = vnd ? VND_MOD_PUB_INDEX : MOD_PUB_INDEX;
 
     BT_INFO("< --%s-- >", __FUNCTION__);
 
@@ -661,18 +722,41 @@ static void mesh_set(void)
     }
 }
 
+static int subnet_keys_init(struct bt_mesh_subnet *sub, u8_t idx)
+{
+    struct bt_mesh_subnet_keys *keys = &sub->keys[idx];
+#if CONFIG_BT_MESH_STORE_DERIVED_KEYS
+    struct net_key_derived_val val;
+    int err;
+
+    err = node_info_load(NET_KEY_DERIVED_ID(sub, idx), &val, sizeof(val));
+    if (!err && val.key_crc == CRC16(keys->net, 16)) {
+        err = bt_mesh_net_keys_restore(keys, keys->net, &val.derived);
+        (void)memset(&val, 0, sizeof(val));
+        if (!err) {
+            boot_stats.keys_restored++;
+            return 0;
+        }
+    }
+#endif /* CONFIG_BT_MESH_STORE_DERIVED_KEYS */
+
+    boot_stats.keys_derived++;
+
+    return bt_mesh_net_keys_create(keys, keys->net);
+}
+
 static int subnet_init(struct bt_mesh_subnet *sub)
 {
     int err;
 
-    err = bt_mesh_net_keys_create(&sub->keys[0], sub->keys[0].net);
+    err = subnet_keys_init(sub, 0);
     if (err) {
         BT_ERR("Unable to generate keys for subnet");
         return -EIO;
     }
 
     if (sub->kr_phase != BT_MESH_KR_NORMAL) {
-        err = bt_mesh_net_keys_create(&sub->keys[1], sub->keys[1].net);
+        err = subnet_keys_init(sub, 1);
         if (err) {
             BT_ERR("Unable to generate keys for subnet");
             (void)memset(&sub->keys[0], 0, sizeof(sub->keys[0]));
@@ -709,6 +793,7 @@ static int mesh_commit(void)
 {
     struct bt_mesh_hb_pub *hb_pub;
     struct bt_mesh_cfg_srv *cfg;
+    u32_t start;
     int i;
 
     BT_INFO("--func=%s", __FUNCTION__);
@@ -723,6 +808,8 @@ static int mesh_commit(void)
         bt_mesh_proxy_prov_disable(true);
     }
 
+    start = k_uptime_get_32();
+
     for (i = 0; i < ARRAY_SIZE(bt_mesh.sub); i++) {
         struct bt_mesh_subnet *sub = &bt_mesh.sub[i];
         int err;
@@ -737,6 +824,8 @@ static int mesh_commit(void)
         }
     }
 
+    boot_stats.keys_ms = k_uptime_get_32() - start;
+
     if (bt_mesh.ivu_duration < BT_MESH_IVU_MIN_HOURS) {
         // ....to do
     }
@@ -774,14 +863,16 @@ static int mesh_commit(void)
 
 static void schedule_store(int flag)
 {
-    s32_t timeout;
+    s32_t timeout, remaining;
 
     atomic_set_bit(bt_mesh.flags, flag);
 
+    store_stats.requests++;
+
     if (atomic_test_bit(bt_mesh.flags, BT_MESH_NET_PENDING) ||
         atomic_test_bit(bt_mesh.flags, BT_MESH_IV_PENDING) ||
         atomic_test_bit(bt_mesh.flags, BT_MESH_SEQ_PENDING)) {
-        timeout = K_NO_WAIT;
+        timeout = CONFIG_BT_MESH_STORE_COALESCE_MS;
     } else if (atomic_test_bit(bt_mesh.flags, BT_MESH_RPL_PENDING) &&
                (CONFIG_BT_MESH_RPL_STORE_TIMEOUT <
                 CONFIG_BT_MESH_STORE_TIMEOUT)) {
@@ -792,11 +883,17 @@ static void schedule_store(int flag)
 
     BT_INFO("--func=%s", __FUNCTION__);
     BT_INFO("flag=0x%x", flag);
-    BT_DBG("Waiting %d seconds", timeout / MSEC_PER_SEC);
 
-    /* OS_ENTER_CRITICAL(); */
-    store_pending();
-    /* OS_EXIT_CRITICAL(); */
+    remaining = k_delayed_work_remaining_get(&pending_store);
+    if (remaining && remaining <= timeout) {
+        BT_DBG("Not rescheduling due to existing earlier deadline");
+        store_stats.coalesced++;
+        return;
+    }
+
+    BT_DBG("Waiting %d ms", timeout);
+
+    k_delayed_work_submit(&pending_store, timeout);
 }
 
 static void clear_iv(void)
@@ -876,7 +973,7 @@ void bt_mesh_store_seq(void)
     schedule_store(BT_MESH_SEQ_PENDING);
 }
 
-static void store_rpl(struct bt_mesh_rpl *entry, u8 index)
+static void store_rpl(struct bt_mesh_rpl *entry, u16 index)
 {
     struct __rpl_val __rpl;
 
@@ -887,7 +984,7 @@ static void store_rpl(struct bt_mesh_rpl *entry, u8 index)
     __rpl.rpl.old_iv = entry->old_iv;
     __rpl.src = entry->src;
 
-    node_info_store(RPL_INDEX + index, &__rpl, sizeof(__rpl));
+    node_info_store(RPL_ID(index), &__rpl, sizeof(__rpl));
 }
 
 static void clear_rpl(void)
@@ -904,10 +1001,12 @@ static void clear_rpl(void)
             continue;
         }
 
-        node_info_clear(RPL_INDEX + i, sizeof(struct __rpl_val));
+        node_info_clear(RPL_ID(i), sizeof(struct __rpl_val));
 
         (void)memset(rpl, 0, sizeof(*rpl));
     }
+
+    bt_mesh_rpl_index_rebuild();
 }
 
 static void store_pending_rpl(void)
@@ -990,12 +1089,58 @@ static void clear_app_key(u16_t app_idx)
 
 static void clear_net_key(u16_t net_idx)
 {
+#if CONFIG_BT_MESH_STORE_DERIVED_KEYS
+    int i;
+#endif
+
     BT_INFO("--func=%s", __FUNCTION__);
     BT_DBG("NetKeyIndex 0x%03x", net_idx);
 
     node_info_clear(NET_KEY_INDEX + net_idx, sizeof(struct net_key_val));
+
+#if CONFIG_BT_MESH_STORE_DERIVED_KEYS
+    /* The subnet is either still in its slot or already freed, a slot
+     * taken by another subnet since then holds that one's keys.
+     */
+    for (i = 0; i < ARRAY_SIZE(bt_mesh.sub); i++) {
+        struct bt_mesh_subnet *sub = &bt_mesh.sub[i];
+
+        if (sub->net_idx != net_idx && sub->net_idx != BT_MESH_KEY_UNUSED) {
+            continue;
+        }
+
+        node_info_clear(NET_KEY_DERIVED_ID(sub, 0),
+                        sizeof(struct net_key_derived_val));
+        node_info_clear(NET_KEY_DERIVED_ID(sub, 1),
+                        sizeof(struct net_key_derived_val));
+    }
+#endif
 }
 
+#if CONFIG_BT_MESH_STORE_DERIVED_KEYS
+static void store_net_key_derived(struct bt_mesh_subnet *sub, u8_t idx)
+{
+    struct net_key_derived_val val;
+    int index = NET_KEY_DERIVED_ID(sub, idx);
+
+    /* Keys only in use during Key Refresh are not worth the flash */
+    if (idx && sub->kr_phase == BT_MESH_KR_NORMAL) {
+        node_info_clear(index, sizeof(val));
+        return;
+    }
+
+    if (bt_mesh_net_keys_derive(sub->keys[idx].net, &val.derived)) {
+        node_info_clear(index, sizeof(val));
+        return;
+    }
+
+    val.key_crc = CRC16(sub->keys[idx].net, 16);
+    node_info_store(index, &val, sizeof(val));
+
+    (void)memset(&val, 0, sizeof(val));
+}
+#endif /* CONFIG_BT_MESH_STORE_DERIVED_KEYS */
+
 static void store_net_key(struct bt_mesh_subnet *sub)
 {
     struct net_key_val key;
@@ -1011,6 +1156,11 @@ static void store_net_key(struct bt_mesh_subnet *sub)
 
     BT_INFO("sub->net_idx=0x%x", sub->net_idx);
     node_info_store(NET_KEY_INDEX + sub->net_idx, &key, sizeof(key));
+
+#if CONFIG_BT_MESH_STORE_DERIVED_KEYS
+    store_net_key_derived(sub, 0);
+    store_net_key_derived(sub, 1);
+#endif
 }
 
 static void store_app_key(struct bt_mesh_app_key *app)
@@ -1079,7 +1229,7 @@ static void store_pending_mod_bind(struct bt_mesh_model *mod, bool vnd)
 {
     int i, count;
     struct __mod_bind _mod_bind;
-    u8 store_index;
+    u16 store_index;
 
     BT_INFO("--func=%s", __FUNCTION__);
     for (i = 0, count = 0; i < ARRAY_SIZE(mod->keys); i++) {
@@ -1101,7 +1251,7 @@ static void store_pending_mod_sub(struct bt_mesh_model *mod, bool vnd)
 {
     int i, count;
     struct __mod_sub _mod_sub;
-    u8 store_index;
+    u16 store_index;
 
     BT_INFO("--func=%s", __FUNCTION__);
     for (i = 0, count = 0; i < ARRAY_SIZE(mod->groups); i++) {
@@ -1123,7 +1273,7 @@ static void store_pending_mod_sub(struct bt_mesh_model *mod, bool vnd)
 static void store_pending_mod_pub(struct bt_mesh_model *mod, bool vnd)
 {
     struct __mod_pub _mod_pub;
-    u8 store_index;
+    u16 store_index;
 
     BT_INFO("--func=%s", __FUNCTION__);
     store_index = get_model_store_index(vnd, mod->elem_idx, mod->mod_idx);
@@ -1167,8 +1317,12 @@ static void store_pending_mod(struct bt_mesh_model *mod,
     }
 }
 
-static void store_pending(void)
+static void store_pending(struct k_work *work)
 {
+    u32_t start = k_uptime_get_32();
+    u32_t writes = node_info_write_count();
+    u32_t elapsed;
+
     BT_INFO("--func=%s", __FUNCTION__);
 
     if (atomic_test_and_clear_bit(bt_mesh.flags, BT_MESH_RPL_PENDING)) {
@@ -1218,6 +1372,16 @@ static void store_pending(void)
     if (atomic_test_and_clear_bit(bt_mesh.flags, BT_MESH_MOD_PENDING)) {
         bt_mesh_model_foreach(store_pending_mod, NULL);
     }
+
+    node_info_commit();
+
+    elapsed = k_uptime_get_32() - start;
+
+    store_stats.passes++;
+    store_stats.writes += node_info_write_count() - writes;
+    if (elapsed > store_stats.stall_max) {
+        store_stats.stall_max = elapsed;
+    }
 }
 
 void bt_mesh_store_rpl(struct bt_mesh_rpl *entry)
@@ -1401,10 +1565,65 @@ void bt_mesh_store_mod_pub(struct bt_mesh_model *mod)
 
 void bt_mesh_settings_init(void)
 {
+    k_delayed_work_init(&pending_store, store_pending);
+}
+
+/* Write out everything still dirty right away. Must be called before the
+ * node loses power or resets on purpose, or up to
+ * CONFIG_BT_MESH_STORE_TIMEOUT seconds of changes are lost.
+ */
+void bt_mesh_settings_flush(void)
+{
+    k_delayed_work_cancel(&pending_store);
+
+    store_stats.flushes++;
+
+    store_pending(NULL);
+}
+
+void bt_mesh_store_stats_get(struct bt_mesh_store_stats *stats)
+{
+    *stats = store_stats;
+}
+
+void bt_mesh_store_stats_reset(void)
+{
+    (void)memset(&store_stats, 0, sizeof(store_stats));
+}
+
+void bt_mesh_boot_stats_get(struct bt_mesh_boot_stats *stats)
+{
+    *stats = boot_stats;
 }
 
 void settings_load(void)
 {
+    u32_t start = k_uptime_get_32();
+    u32_t t;
+
+    boot_stats.start_at = start;
+
+    node_info_load_begin();
+
+    t = k_uptime_get_32();
+    boot_stats.scan_ms = t - start;
+
     mesh_set();
+
+    boot_stats.load_ms = k_uptime_get_32() - t;
+
+    node_info_load_end();
+
+    t = k_uptime_get_32();
+
     mesh_commit();
+
+    boot_stats.commit_ms = k_uptime_get_32() - t;
+    boot_stats.ready_at = k_uptime_get_32();
+
+    BT_INFO("restore %u ms: scan %u load %u commit %u (keys %u), keys %u/%u restored",
+            boot_stats.ready_at - start, boot_stats.scan_ms,
+            boot_stats.load_ms, boot_stats.commit_ms, boot_stats.keys_ms,
+            boot_stats.keys_restored,
+            boot_stats.keys_restored + boot_stats.keys_derived);
 }
@@ -22,3 +22,35 @@ void bt_mesh_clear_app_key(struct bt_mesh_app_key *key);
 void bt_mesh_clear_rpl(void);
 
 void bt_mesh_settings_init(void);
+void bt_mesh_settings_flush(void);
+
+/* Deferred storage counters, for tuning CONFIG_BT_MESH_STORE_TIMEOUT and
+ * CONFIG_BT_MESH_RPL_STORE_TIMEOUT against flash wear.
+ */
+struct bt_mesh_store_stats {
+    u32_t requests;     /* Store/clear requests from the stack */
+    u32_t coalesced;    /* Requests merged into an already scheduled pass */
+    u32_t passes;       /* Flash passes run */
+    u32_t flushes;      /* Passes forced by bt_mesh_settings_flush() */
+    u32_t writes;       /* Flash record writes (stores and clears) */
+    u32_t stall_max;    /* Longest single pass, in ms */
+};
+
+void bt_mesh_store_stats_get(struct bt_mesh_store_stats *stats);
+void bt_mesh_store_stats_reset(void);
+
+/* Time spent restoring the node at boot (settings_load()). ready_at is the
+ * uptime at which the node can relay and send again after a reset.
+ */
+struct bt_mesh_boot_stats {
+    u32_t start_at;         /* Uptime when settings_load() started, ms */
+    u32_t ready_at;         /* Uptime when it returned, ms */
+    u32_t scan_ms;          /* Reading and indexing the stored records */
+    u32_t load_ms;          /* Applying the records (mesh_set()) */
+    u32_t commit_ms;        /* mesh_commit(), including keys_ms */
+    u32_t keys_ms;          /* NetKey material, derived or restored */
+    u8_t  keys_restored;    /* NetKeys restored from stored derived keys */
+    u8_t  keys_derived;     /* NetKeys that went through k2/k3/k1 */
+};
+
+void bt_mesh_boot_stats_get(struct bt_mesh_boot_stats *stats);
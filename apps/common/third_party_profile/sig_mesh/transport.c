@@ -17,6 +17,7 @@
 #include "foundation.h"
 #include "settings.h"
 #include "transport.h"
+#include "provisioner.h"
 
 #define LOG_TAG             "[MESH-transport]"
 #define LOG_INFO_ENABLE
@@ -72,24 +73,33 @@ BUILD_ASSERT(CONFIG_BT_MESH_ADV_BUF_COUNT >= (CONFIG_BT_MESH_TX_SEG_MAX + 3));
  */
 #define SEG_RETRANSMIT_TIMEOUT(tx) (K_MSEC(400) + 50 * (tx)->ttl)
 
+/* Floor for the adaptive timer, the minimum the specification allows */
+#define SEG_RETRANSMIT_TIMEOUT_MIN(tx) (K_MSEC(200) + 50 * (tx)->ttl)
+
 /* How long to wait for available buffers before giving up */
 #define BUF_TIMEOUT                 K_NO_WAIT
 
-static struct seg_tx {
+struct seg_tx {
     struct bt_mesh_subnet   *sub;
     struct net_buf          *seg[CONFIG_BT_MESH_TX_SEG_MAX];
     u64_t                    seq_auth;
     u16_t                    dst;
     u8_t                     seg_n: 5,      /* Last segment index */
-                             new_key: 1;    /* New/old key */
+                             new_key: 1,    /* New/old key */
+                             resent: 1;     /* No RTT sample once resent */
     u8_t                     nack_count;    /* Number of unacked segs */
     u8_t                     ttl;
+    u8_t                     backoff;       /* Retransmit timer exponent */
+    u16_t                    tx_count;      /* Segment transmissions */
+    u16_t                    sdu_len;
+    u32_t                    started;       /* Uptime of first segment sent */
+    u32_t                    sent;          /* Uptime of last segment sent */
     const struct bt_mesh_send_cb *cb;
     void                    *cb_data;
     struct k_delayed_work    retransmit;    /* Retransmit timer */
-} seg_tx[CONFIG_BT_MESH_TX_SEG_MSG_COUNT];
+};
 
-static struct seg_rx {
+struct seg_rx {
     struct bt_mesh_subnet   *sub;
     u64_t                    seq_auth;
     u8_t                     seg_n: 5,
@@ -101,17 +111,43 @@ static struct seg_rx {
     u16_t                    src;
     u16_t                    dst;
     u32_t                    block;
+    u32_t                    first;         /* Uptime of first segment */
     u32_t                    last;
     struct k_delayed_work    ack;
-    struct net_buf_simple    buf;
-} seg_rx[CONFIG_BT_MESH_RX_SEG_MSG_COUNT] = {
-    [0 ...(CONFIG_BT_MESH_RX_SEG_MSG_COUNT - 1)] = {
-        .buf.size = CONFIG_BT_MESH_RX_SDU_MAX,
-    },
+    struct net_buf_simple    buf;           /* Carved from seg_rx_arena */
+};
+
+/* Incoming SDUs don't get a fixed CONFIG_BT_MESH_RX_SDU_MAX buffer each,
+ * instead every RX context takes just the (SegN + 1) segments it needs
+ * out of one shared arena while it's in use. Many small transfers from
+ * different sources can then be reassembled in parallel.
+ */
+#if NET_BUF_USE_MALLOC
+static struct seg_tx *seg_tx;
+static struct seg_rx *seg_rx;
+static u8_t *seg_rx_arena;
+#else
+static struct seg_tx seg_tx[CONFIG_BT_MESH_TX_SEG_MSG_COUNT];
+static struct seg_rx seg_rx[CONFIG_BT_MESH_RX_SEG_MSG_COUNT];
+static u8_t __noinit seg_rx_arena[CONFIG_BT_MESH_RX_SEG_ARENA_SIZE];
+#endif /* NET_BUF_USE_MALLOC */
+
+/* Smoothed round trip time per unicast destination, measured from the
+ * last segment sent to the Segment Acknowledgment coming back.
+ */
+#if CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE
+struct seg_rtt {
+    u16_t dst;
+    u16_t srtt;                             /* unit: ms */
+    u16_t rttvar;                           /* unit: ms */
 };
 
-static u8_t __noinit seg_rx_buf_data[(CONFIG_BT_MESH_RX_SEG_MSG_COUNT *
-                                      CONFIG_BT_MESH_RX_SDU_MAX)];
+static struct seg_rtt seg_rtt[CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE];
+static u8_t seg_rtt_next;
+#endif /* CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE */
+
+static struct bt_mesh_seg_tx_stats seg_tx_stats;
+static struct bt_mesh_seg_rx_stats seg_rx_stats;
 
 static u16_t hb_sub_dst = BT_MESH_ADDR_UNASSIGNED;
 
@@ -165,7 +201,7 @@ bool bt_mesh_tx_in_progress(void)
 {
     int i;
 
-    for (i = 0; i < ARRAY_SIZE(seg_tx); i++) {
+    for (i = 0; i < CONFIG_BT_MESH_TX_SEG_MSG_COUNT; i++) {
         if (seg_tx[i].nack_count) {
             return true;
         }
@@ -174,6 +210,26 @@ bool bt_mesh_tx_in_progress(void)
     return false;
 }
 
+void bt_mesh_seg_tx_stats_get(struct bt_mesh_seg_tx_stats *stats)
+{
+    *stats = seg_tx_stats;
+}
+
+void bt_mesh_seg_tx_stats_reset(void)
+{
+    (void)memset(&seg_tx_stats, 0, sizeof(seg_tx_stats));
+}
+
+void bt_mesh_seg_rx_stats_get(struct bt_mesh_seg_rx_stats *stats)
+{
+    *stats = seg_rx_stats;
+}
+
+void bt_mesh_seg_rx_stats_reset(void)
+{
+    (void)memset(&seg_rx_stats, 0, sizeof(seg_rx_stats));
+}
+
 static void seg_tx_reset(struct seg_tx *tx)
 {
     int i;
@@ -201,6 +257,10 @@ static void seg_tx_reset(struct seg_tx *tx)
 
     tx->nack_count = 0;
 
+    if (IS_ENABLED(CONFIG_BT_MESH_CFG_CLI)) {
+        bt_mesh_cfg_cli_seg_tx_free();
+    }
+
     if (bt_mesh.pending_update) {
         BT_DBG("Proceding with pending IV Update");
         bt_mesh.pending_update = 0;
@@ -213,8 +273,78 @@ static void seg_tx_reset(struct seg_tx *tx)
     }
 }
 
+#if CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE
+static struct seg_rtt *seg_rtt_find(u16_t dst)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(seg_rtt); i++) {
+        if (seg_rtt[i].dst == dst) {
+            return &seg_rtt[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void seg_rtt_update(u16_t dst, u32_t rtt)
+{
+    struct seg_rtt *entry;
+    u16_t delta;
+
+    rtt = min(rtt, 0xffff);
+
+    entry = seg_rtt_find(dst);
+    if (!entry) {
+        /* Round robin replacement, good enough for a handful of peers */
+        entry = &seg_rtt[seg_rtt_next];
+        seg_rtt_next = (seg_rtt_next + 1) % ARRAY_SIZE(seg_rtt);
+
+        entry->dst = dst;
+        entry->srtt = rtt;
+        entry->rttvar = rtt / 2;
+        return;
+    }
+
+    delta = (entry->srtt > rtt) ? (entry->srtt - rtt) : (rtt - entry->srtt);
+
+    entry->rttvar = (3 * entry->rttvar + delta) / 4;
+    entry->srtt = (7 * entry->srtt + rtt) / 8;
+}
+#endif /* CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE */
+
+static s32_t seg_retransmit_timeout(struct seg_tx *tx)
+{
+    s32_t to = SEG_RETRANSMIT_TIMEOUT(tx);
+
+#if CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE
+    struct seg_rtt *entry = seg_rtt_find(tx->dst);
+
+    if (entry && BT_MESH_ADDR_IS_UNICAST(tx->dst)) {
+        /* Never go below the specification minimum, and don't let one
+         * slow sample stretch the timer past twice the fixed value.
+         */
+        to = entry->srtt + 4 * entry->rttvar;
+        to = max(to, SEG_RETRANSMIT_TIMEOUT_MIN(tx));
+        to = min(to, 2 * SEG_RETRANSMIT_TIMEOUT(tx));
+    }
+#endif /* CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE */
+
+    return to << tx->backoff;
+}
+
 static inline void seg_tx_complete(struct seg_tx *tx, int err)
 {
+    if (err) {
+        seg_tx_stats.sdu_failed++;
+        seg_tx_stats.seg_failed += tx->tx_count;
+    } else {
+        seg_tx_stats.sdu_acked++;
+        seg_tx_stats.seg_acked += tx->tx_count;
+        seg_tx_stats.sdu_bytes += tx->sdu_len;
+        seg_tx_stats.sdu_ms += k_uptime_get_32() - tx->started;
+    }
+
     if (tx->cb && tx->cb->end) {
         tx->cb->end(err, tx->cb_data);
     }
@@ -241,7 +371,7 @@ static void seg_send_start(u16_t duration, int err, void *user_data)
      */
     if (err) {
         k_delayed_work_submit(&tx->retransmit,
-                              SEG_RETRANSMIT_TIMEOUT(tx));
+                              seg_retransmit_timeout(tx));
     }
 }
 
@@ -249,8 +379,10 @@ static u32 seg_sent(int err, void *user_data)
 {
     struct seg_tx *tx = user_data;
 
+    tx->sent = k_uptime_get_32();
+
     k_delayed_work_submit(&tx->retransmit,
-                          SEG_RETRANSMIT_TIMEOUT(tx));
+                          seg_retransmit_timeout(tx));
 
     return 0;
 }
@@ -296,13 +428,44 @@ static void seg_tx_send_unacked(struct seg_tx *tx)
             seg_tx_complete(tx, -EIO);
             return;
         }
+
+        tx->resent = 1;
+        tx->tx_count++;
+    }
+}
+
+static bool seg_tx_adv_busy(struct seg_tx *tx)
+{
+    int i;
+
+    for (i = 0; i <= tx->seg_n; i++) {
+        if (tx->seg[i] && BT_MESH_ADV(tx->seg[i])->busy) {
+            return true;
+        }
     }
+
+    return false;
 }
 
 static void seg_retransmit(struct k_work *work)
 {
     struct seg_tx *tx = CONTAINER_OF(work, struct seg_tx, retransmit);
 
+    /* Segments from the previous round are still waiting for the
+     * bearer, queueing more copies would only make the congestion
+     * worse. Back off without spending a retransmit attempt.
+     */
+    if (seg_tx_adv_busy(tx)) {
+        if (tx->backoff < CONFIG_BT_MESH_SEG_BACKOFF_MAX) {
+            tx->backoff++;
+        }
+
+        seg_tx_stats.backoff++;
+        BT_DBG("Adv queue busy, backoff %u", tx->backoff);
+        k_delayed_work_submit(&tx->retransmit, seg_retransmit_timeout(tx));
+        return;
+    }
+
     seg_tx_send_unacked(tx);
 }
 
@@ -329,7 +492,7 @@ static int send_seg(struct bt_mesh_net_tx *net_tx, struct net_buf_simple *sdu,
         return -EMSGSIZE;
     }
 
-    for (tx = NULL, i = 0; i < ARRAY_SIZE(seg_tx); i++) {
+    for (tx = NULL, i = 0; i < CONFIG_BT_MESH_TX_SEG_MSG_COUNT; i++) {
         if (!seg_tx[i].nack_count) {
             tx = &seg_tx[i];
             break;
@@ -356,6 +519,12 @@ static int send_seg(struct bt_mesh_net_tx *net_tx, struct net_buf_simple *sdu,
     tx->new_key = net_tx->sub->kr_flag;
     tx->cb = cb;
     tx->cb_data = cb_data;
+    tx->resent = 0;
+    tx->backoff = 0;
+    tx->tx_count = 0;
+    tx->sdu_len = sdu->len;
+    tx->started = k_uptime_get_32();
+    tx->sent = tx->started;
 
     if (net_tx->ctx->send_ttl == BT_MESH_TTL_DEFAULT) {
         tx->ttl = bt_mesh_default_ttl_get();
@@ -428,6 +597,8 @@ static int send_seg(struct bt_mesh_net_tx *net_tx, struct net_buf_simple *sdu,
             seg_tx_reset(tx);
             return err;
         }
+
+        tx->tx_count++;
     }
 
     if (IS_ENABLED(CONFIG_BT_MESH_LOW_POWER) &&
@@ -469,10 +640,25 @@ int bt_mesh_get_if_app_key_add(void)
     return false;
 }
 
+/* DevKey messages are secured with the key of the node that is being
+ * configured. That is our own key for our elements, and on a plain node
+ * for every peer, since only the provisioner talks to it with the DevKey.
+ * A provisioner takes the key of a remote node from the database and
+ * gets NULL when it has no usable key, never its own one.
+ */
+static struct tc_aes_key_sched_struct *dev_key_get(u16_t addr)
+{
+    if (!IS_ENABLED(CONFIG_BT_MESH_PROVISIONER) || bt_mesh_elem_find(addr)) {
+        return &bt_mesh.dev_key_sched;
+    }
+
+    return bt_mesh_cdb_dev_key_get(addr);
+}
+
 int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, struct net_buf_simple *msg,
                        const struct bt_mesh_send_cb *cb, void *cb_data)
 {
-    const u8_t *key;
+    struct tc_aes_key_sched_struct *key;
     u8_t *ad;
     int err;
 
@@ -490,7 +676,12 @@ int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, struct net_buf_simple *msg,
     BT_DBG("len %u: %s", msg->len, bt_hex(msg->data, msg->len));
 
     if (tx->ctx->app_idx == BT_MESH_KEY_DEV) {
-        key = bt_mesh.dev_key;
+        key = dev_key_get(tx->ctx->addr);
+        if (!key) {
+            BT_ERR("No DevKey for 0x%04x", tx->ctx->addr);
+            return -ENOENT;
+        }
+
         tx->aid = 0;
     } else {
         struct bt_mesh_app_key *app_key;
@@ -502,10 +693,10 @@ int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, struct net_buf_simple *msg,
 
         if (tx->sub->kr_phase == BT_MESH_KR_PHASE_2 &&
             app_key->updated) {
-            key = app_key->keys[1].val;
+            key = &app_key->keys[1].sched;
             tx->aid = app_key->keys[1].id;
         } else {
-            key = app_key->keys[0].val;
+            key = &app_key->keys[0].sched;
             tx->aid = app_key->keys[0].id;
         }
     }
@@ -534,6 +725,12 @@ int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, struct net_buf_simple *msg,
         err = send_seg(tx, msg, cb, cb_data);
     } else {
         err = send_unseg(tx, msg, cb, cb_data);
+
+        if (!err && IS_ENABLED(CONFIG_BT_MESH_LOW_POWER) &&
+            BT_MESH_FEATURES_IS_SUPPORT(BT_MESH_FEAT_LOW_POWER) &&
+            bt_mesh_lpn_established()) {
+            bt_mesh_lpn_msg_sent();
+        }
     }
 
     return err;
@@ -558,54 +755,225 @@ int bt_mesh_trans_resend(struct bt_mesh_net_tx *tx, struct net_buf_simple *msg,
     return err;
 }
 
-static bool is_replay(struct bt_mesh_net_rx *rx)
+#if (CONFIG_BT_MESH_RPL_HASH_SIZE & (CONFIG_BT_MESH_RPL_HASH_SIZE - 1))
+#error "CONFIG_BT_MESH_RPL_HASH_SIZE must be a power of two"
+#endif
+
+/* Probing relies on at least one bucket always being empty */
+#if (CONFIG_BT_MESH_RPL_HASH_SIZE <= CONFIG_BT_MESH_CRPL)
+#error "CONFIG_BT_MESH_RPL_HASH_SIZE must be larger than CONFIG_BT_MESH_CRPL"
+#endif
+
+#define RPL_HASH_MASK               (CONFIG_BT_MESH_RPL_HASH_SIZE - 1)
+
+#if (CONFIG_BT_MESH_CRPL < 0xff)
+typedef u8_t rpl_slot_t;
+#else
+typedef u16_t rpl_slot_t;
+#endif
+
+/* Open-addressed (linear probing) index over bt_mesh.rpl[] keyed by
+ * source address. A bucket holds the RPL slot number plus one, so zero
+ * marks an empty bucket. The slot layout itself is unchanged since the
+ * settings code persists entries by slot number.
+ */
+static rpl_slot_t rpl_hash[CONFIG_BT_MESH_RPL_HASH_SIZE];
+
+/* No free slot exists below this one */
+static u16_t rpl_free_hint;
+
+#if CONFIG_BT_MESH_RPL_LRU_EVICT
+static u32_t rpl_lru_stamp;
+
+#define RPL_LRU_TOUCH(rpl)          ((rpl)->lru = ++rpl_lru_stamp)
+#else
+#define RPL_LRU_TOUCH(rpl)
+#endif /* CONFIG_BT_MESH_RPL_LRU_EVICT */
+
+static inline u16_t rpl_hash_bucket(u16_t src)
 {
-    int i;
+    return (src ^ (src >> 6) ^ (src >> 11)) & RPL_HASH_MASK;
+}
 
-    /* Don't bother checking messages from ourselves */
-    if (rx->net_if == BT_MESH_NET_IF_LOCAL) {
-        return false;
+static void rpl_hash_insert(u16_t src, u16_t slot)
+{
+    u16_t i = rpl_hash_bucket(src);
+
+    while (rpl_hash[i]) {
+        i = (i + 1) & RPL_HASH_MASK;
+    }
+
+    rpl_hash[i] = slot + 1;
+}
+
+struct bt_mesh_rpl *bt_mesh_rpl_find(u16_t src)
+{
+    u16_t i = rpl_hash_bucket(src);
+
+    while (rpl_hash[i]) {
+        struct bt_mesh_rpl *rpl = &bt_mesh.rpl[rpl_hash[i] - 1];
+
+        if (rpl->src == src) {
+            return rpl;
+        }
+
+        i = (i + 1) & RPL_HASH_MASK;
     }
 
+    return NULL;
+}
+
+#if CONFIG_BT_MESH_RPL_LRU_EVICT
+__attribute__((weak))
+bool bt_mesh_rpl_evictable(u16_t src)
+{
+    return true;
+}
+
+static void rpl_hash_remove(u16_t src)
+{
+    u16_t i = rpl_hash_bucket(src);
+    u16_t j, home;
+
+    while (rpl_hash[i] && bt_mesh.rpl[rpl_hash[i] - 1].src != src) {
+        i = (i + 1) & RPL_HASH_MASK;
+    }
+
+    if (!rpl_hash[i]) {
+        return;
+    }
+
+    /* Backward shift deletion: pull up every following entry of the
+     * probe run whose home bucket does not lie in (i, j].
+     */
+    for (j = (i + 1) & RPL_HASH_MASK; rpl_hash[j];
+         j = (j + 1) & RPL_HASH_MASK) {
+        home = rpl_hash_bucket(bt_mesh.rpl[rpl_hash[j] - 1].src);
+
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j)) {
+            continue;
+        }
+
+        rpl_hash[i] = rpl_hash[j];
+        i = j;
+    }
+
+    rpl_hash[i] = 0;
+}
+
+static struct bt_mesh_rpl *rpl_lru_victim(void)
+{
+    struct bt_mesh_rpl *victim = NULL;
+    int i;
+
     for (i = 0; i < ARRAY_SIZE(bt_mesh.rpl); i++) {
         struct bt_mesh_rpl *rpl = &bt_mesh.rpl[i];
 
-        /* Empty slot */
+        if (!bt_mesh_rpl_evictable(rpl->src)) {
+            continue;
+        }
+
+        if (!victim || (s32_t)(rpl->lru - victim->lru) < 0) {
+            victim = rpl;
+        }
+    }
+
+    return victim;
+}
+#endif /* CONFIG_BT_MESH_RPL_LRU_EVICT */
+
+struct bt_mesh_rpl *bt_mesh_rpl_alloc(u16_t src)
+{
+    struct bt_mesh_rpl *rpl;
+
+    for (; rpl_free_hint < ARRAY_SIZE(bt_mesh.rpl); rpl_free_hint++) {
+        rpl = &bt_mesh.rpl[rpl_free_hint];
+
         if (!rpl->src) {
-            rpl->src = rx->ctx.addr;
-            rpl->seq = rx->seq;
-            rpl->old_iv = rx->old_iv;
+            rpl->src = src;
+            rpl_hash_insert(src, rpl_free_hint++);
+            RPL_LRU_TOUCH(rpl);
+            return rpl;
+        }
+    }
 
-            if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
-                bt_mesh_store_rpl(rpl);
-            }
+#if CONFIG_BT_MESH_RPL_LRU_EVICT
+    rpl = rpl_lru_victim();
+    if (rpl) {
+        BT_WARN("RPL full, evicting 0x%04x", rpl->src);
+
+        rpl_hash_remove(rpl->src);
+        (void)memset(rpl, 0, sizeof(*rpl));
+        rpl->src = src;
+        rpl_hash_insert(src, rpl - bt_mesh.rpl);
+        RPL_LRU_TOUCH(rpl);
+        return rpl;
+    }
+#endif /* CONFIG_BT_MESH_RPL_LRU_EVICT */
+
+    return NULL;
+}
 
-            return false;
+void bt_mesh_rpl_index_rebuild(void)
+{
+    int i;
+
+    (void)memset(rpl_hash, 0, sizeof(rpl_hash));
+    rpl_free_hint = ARRAY_SIZE(bt_mesh.rpl);
+
+    for (i = ARRAY_SIZE(bt_mesh.rpl) - 1; i >= 0; i--) {
+        if (bt_mesh.rpl[i].src) {
+            rpl_hash_insert(bt_mesh.rpl[i].src, i);
+        } else {
+            rpl_free_hint = i;
         }
+    }
+}
 
-        /* Existing slot for given address */
-        if (rpl->src == rx->ctx.addr) {
-            if (rx->old_iv && !rpl->old_iv) {
-                return true;
-            }
+static bool is_replay(struct bt_mesh_net_rx *rx)
+{
+    struct bt_mesh_rpl *rpl;
 
-            if ((!rx->old_iv && rpl->old_iv) ||
-                rpl->seq < rx->seq) {
-                rpl->seq = rx->seq;
-                rpl->old_iv = rx->old_iv;
+    /* Don't bother checking messages from ourselves */
+    if (rx->net_if == BT_MESH_NET_IF_LOCAL) {
+        return false;
+    }
 
-                if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
-                    bt_mesh_store_rpl(rpl);
-                }
+    rpl = bt_mesh_rpl_find(rx->ctx.addr);
+    if (!rpl) {
+        rpl = bt_mesh_rpl_alloc(rx->ctx.addr);
+        if (!rpl) {
+            BT_ERR("RPL is full!");
+            return true;
+        }
 
-                return false;
-            } else {
-                return true;
-            }
+        rpl->seq = rx->seq;
+        rpl->old_iv = rx->old_iv;
+
+        if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+            bt_mesh_store_rpl(rpl);
         }
+
+        return false;
+    }
+
+    if (rx->old_iv && !rpl->old_iv) {
+        return true;
+    }
+
+    if ((!rx->old_iv && rpl->old_iv) ||
+        rpl->seq < rx->seq) {
+        rpl->seq = rx->seq;
+        rpl->old_iv = rx->old_iv;
+        RPL_LRU_TOUCH(rpl);
+
+        if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+            bt_mesh_store_rpl(rpl);
+        }
+
+        return false;
     }
 
-    BT_ERR("RPL is full!");
     return true;
 }
 
@@ -642,7 +1010,14 @@ static int sdu_recv(struct bt_mesh_net_rx *rx, u32_t seq, u8_t hdr,
     buf->len -= APP_MIC_LEN(aszmic);
 
     if (!AKF(&hdr)) {
-        err = bt_mesh_app_decrypt(bt_mesh.dev_key, true, aszmic, buf,
+        struct tc_aes_key_sched_struct *key = dev_key_get(rx->ctx.addr);
+
+        if (!key) {
+            BT_WARN("No DevKey for 0x%04x", rx->ctx.addr);
+            return -ENOENT;
+        }
+
+        err = bt_mesh_app_decrypt(key, true, aszmic, buf,
                                   &sdu, ad, rx->ctx.addr,
                                   rx->ctx.recv_dst, seq,
                                   BT_MESH_NET_IVI_RX(rx));
@@ -677,7 +1052,7 @@ static int sdu_recv(struct bt_mesh_net_rx *rx, u32_t seq, u8_t hdr,
         }
 
         net_buf_simple_reset(&sdu);
-        err = bt_mesh_app_decrypt(keys->val, false, aszmic, buf,
+        err = bt_mesh_app_decrypt(&keys->sched, false, aszmic, buf,
                                   &sdu, ad, rx->ctx.addr,
                                   rx->ctx.recv_dst, seq,
                                   BT_MESH_NET_IVI_RX(rx));
@@ -704,7 +1079,7 @@ static struct seg_tx *seg_tx_lookup(u16_t seq_zero, u8_t obo, u16_t addr)
     struct seg_tx *tx;
     int i;
 
-    for (i = 0; i < ARRAY_SIZE(seg_tx); i++) {
+    for (i = 0; i < CONFIG_BT_MESH_TX_SEG_MSG_COUNT; i++) {
         tx = &seg_tx[i];
 
         if ((tx->seq_auth & 0x1fff) != seq_zero) {
@@ -736,7 +1111,7 @@ static int trans_ack(struct bt_mesh_net_rx *rx, u8_t hdr,
     unsigned int bit;
     u32_t ack;
     u16_t seq_zero;
-    u8_t obo;
+    u8_t obo, acked = 0;
 
     if (buf->len < 6) {
         BT_ERR("Too short ack message");
@@ -784,12 +1159,33 @@ static int trans_ack(struct bt_mesh_net_rx *rx, u8_t hdr,
             net_buf_unref(tx->seg[bit - 1]);
             tx->seg[bit - 1] = NULL;
             tx->nack_count--;
+            acked++;
         }
 
         ack &= ~BIT(bit - 1);
     }
 
+    if (!acked) {
+        /* Duplicate ack, let the retransmit timer run its course */
+        return 0;
+    }
+
+    /* Karn's rule: a sample is ambiguous once segments were resent */
+#if CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE
+    if (!tx->resent && BT_MESH_ADDR_IS_UNICAST(tx->dst)) {
+        seg_rtt_update(tx->dst, k_uptime_get_32() - tx->sent);
+        seg_tx_stats.rtt_samples++;
+    }
+#endif /* CONFIG_BT_MESH_SEG_RTT_CACHE_SIZE */
+
+    tx->backoff = 0;
+
     if (tx->nack_count) {
+        /* The receiver told us exactly what's missing, no need to wait
+         * for the retransmit timer.
+         */
+        seg_tx_stats.partial_ack++;
+        k_delayed_work_cancel(&tx->retransmit);
         seg_tx_send_unacked(tx);
     } else {
         BT_DBG("SDU TX complete");
@@ -1074,6 +1470,7 @@ static void seg_ack(struct k_work *work)
 
     if (k_uptime_get_32() - rx->last > K_SECONDS(60)) {
         BT_WARN("Incomplete timer expired");
+        seg_rx_stats.incomplete++;
         seg_rx_reset(rx, false);
 
         return;
@@ -1104,7 +1501,7 @@ static struct seg_rx *seg_rx_find(struct bt_mesh_net_rx *net_rx,
 {
     int i;
 
-    for (i = 0; i < ARRAY_SIZE(seg_rx); i++) {
+    for (i = 0; i < CONFIG_BT_MESH_RX_SEG_MSG_COUNT; i++) {
         struct seg_rx *rx = &seg_rx[i];
 
         if (rx->src != net_rx->ctx.addr ||
@@ -1157,40 +1554,107 @@ static bool seg_rx_is_valid(struct seg_rx *rx, struct bt_mesh_net_rx *net_rx,
     return true;
 }
 
-static struct seg_rx *seg_rx_alloc(struct bt_mesh_net_rx *net_rx,
-                                   const u8_t *hdr, const u64_t *seq_auth,
-                                   u8_t seg_n)
+/* First fit over the gaps left between the buffers of in use contexts */
+static u8_t *seg_rx_arena_alloc(u16_t len)
 {
-    int i;
-
-    for (i = 0; i < ARRAY_SIZE(seg_rx); i++) {
-        struct seg_rx *rx = &seg_rx[i];
+    u16_t start, end;
+    int i, j;
+
+    for (i = -1; i < CONFIG_BT_MESH_RX_SEG_MSG_COUNT; i++) {
+        if (i < 0) {
+            start = 0;
+        } else if (seg_rx[i].in_use) {
+            start = (seg_rx[i].buf.__buf - seg_rx_arena) + seg_rx[i].buf.size;
+        } else {
+            continue;
+        }
 
-        if (rx->in_use) {
+        end = start + len;
+        if (end > CONFIG_BT_MESH_RX_SEG_ARENA_SIZE) {
             continue;
         }
 
-        rx->in_use = 1;
-        net_buf_simple_reset(&rx->buf);
-        rx->sub = net_rx->sub;
-        rx->ctl = net_rx->ctl;
-        rx->seq_auth = *seq_auth;
-        rx->seg_n = seg_n;
-        rx->hdr = *hdr;
-        rx->ttl = net_rx->ctx.send_ttl;
-        rx->src = net_rx->ctx.addr;
-        rx->dst = net_rx->ctx.recv_dst;
-        rx->block = 0;
+        for (j = 0; j < CONFIG_BT_MESH_RX_SEG_MSG_COUNT; j++) {
+            u16_t used_start;
 
-        BT_DBG("New RX context. Block Complete 0x%08x",
-               BLOCK_COMPLETE(seg_n));
+            if (!seg_rx[j].in_use) {
+                continue;
+            }
 
-        return rx;
+            used_start = seg_rx[j].buf.__buf - seg_rx_arena;
+            if (start < used_start + seg_rx[j].buf.size && used_start < end) {
+                break;
+            }
+        }
+
+        if (j == CONFIG_BT_MESH_RX_SEG_MSG_COUNT) {
+            return seg_rx_arena + start;
+        }
     }
 
     return NULL;
 }
 
+static struct seg_rx *seg_rx_alloc(struct bt_mesh_net_rx *net_rx,
+                                   const u8_t *hdr, const u64_t *seq_auth,
+                                   u8_t seg_n)
+{
+    struct seg_rx *rx = NULL;
+    u16_t len;
+    u8_t *data;
+    int i, src_count = 0;
+
+    for (i = 0; i < CONFIG_BT_MESH_RX_SEG_MSG_COUNT; i++) {
+        if (!seg_rx[i].in_use) {
+            if (!rx) {
+                rx = &seg_rx[i];
+            }
+        } else if (seg_rx[i].src == net_rx->ctx.addr) {
+            src_count++;
+        }
+    }
+
+    /* Keep a single busy source from occupying every context */
+    if (src_count >= CONFIG_BT_MESH_RX_SEG_SRC_MAX) {
+        BT_WARN("Too many incoming segmented messages from 0x%04x",
+                net_rx->ctx.addr);
+        return NULL;
+    }
+
+    if (!rx) {
+        return NULL;
+    }
+
+    len = min((seg_n + 1) * seg_len(net_rx->ctl), CONFIG_BT_MESH_RX_SDU_MAX);
+
+    data = seg_rx_arena_alloc(len);
+    if (!data) {
+        BT_WARN("No room in reassembly arena for %u bytes", len);
+        return NULL;
+    }
+
+    rx->buf.__buf = data;
+    rx->buf.size = len;
+
+    rx->in_use = 1;
+    net_buf_simple_reset(&rx->buf);
+    rx->sub = net_rx->sub;
+    rx->ctl = net_rx->ctl;
+    rx->seq_auth = *seq_auth;
+    rx->seg_n = seg_n;
+    rx->hdr = *hdr;
+    rx->ttl = net_rx->ctx.send_ttl;
+    rx->src = net_rx->ctx.addr;
+    rx->dst = net_rx->ctx.recv_dst;
+    rx->block = 0;
+    rx->first = k_uptime_get_32();
+
+    BT_DBG("New RX context. Block Complete 0x%08x",
+           BLOCK_COMPLETE(seg_n));
+
+    return rx;
+}
+
 static int trans_seg(struct net_buf_simple *buf, struct bt_mesh_net_rx *net_rx,
                      enum bt_mesh_friend_pdu_type *pdu_type, u64_t *seq_auth)
 {
@@ -1293,6 +1757,7 @@ static int trans_seg(struct net_buf_simple *buf, struct bt_mesh_net_rx *net_rx,
          * this one.
          */
         BT_WARN("No free slots for new incoming segmented messages");
+        seg_rx_stats.no_ctx++;
         return -ENOMEM;
     }
 
@@ -1314,7 +1779,7 @@ found_rx:
         BT_DBG("Target len %u * %u + %u = %u", seg_n, seg_len(rx->ctl),
                buf->len, rx->buf.len);
 
-        if (rx->buf.len > CONFIG_BT_MESH_RX_SDU_MAX) {
+        if (rx->buf.len > rx->buf.size) {
             BT_ERR("Too large SDU len");
             send_ack(net_rx->sub, net_rx->ctx.recv_dst,
                      net_rx->ctx.addr, net_rx->ctx.send_ttl,
@@ -1362,6 +1827,10 @@ found_rx:
 
     *pdu_type = BT_MESH_FRIEND_PDU_COMPLETE;
 
+    seg_rx_stats.sdu_complete++;
+    seg_rx_stats.sdu_bytes += rx->buf.len;
+    seg_rx_stats.sdu_ms += rx->last - rx->first;
+
     k_delayed_work_cancel(&rx->ack);
     send_ack(net_rx->sub, net_rx->ctx.recv_dst, net_rx->ctx.addr,
              net_rx->ctx.send_ttl, seq_auth, rx->block, rx->obo);
@@ -1469,14 +1938,14 @@ void bt_mesh_rx_reset(void)
 
     BT_DBG("");
 
-    for (i = 0; i < ARRAY_SIZE(seg_rx); i++) {
+    for (i = 0; i < CONFIG_BT_MESH_RX_SEG_MSG_COUNT; i++) {
         seg_rx_reset(&seg_rx[i], true);
     }
 
     if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
         bt_mesh_clear_rpl();
     } else {
-        (void)memset(bt_mesh.rpl, 0, sizeof(bt_mesh.rpl));
+        bt_mesh_rpl_clear();
     }
 }
 
@@ -1486,24 +1955,59 @@ void bt_mesh_tx_reset(void)
 
     BT_DBG("");
 
-    for (i = 0; i < ARRAY_SIZE(seg_tx); i++) {
+    for (i = 0; i < CONFIG_BT_MESH_TX_SEG_MSG_COUNT; i++) {
         seg_tx_reset(&seg_tx[i]);
     }
 }
 
+#if NET_BUF_USE_MALLOC
+
+#include "system/malloc.h"
+
+static void bt_mesh_trans_buf_alloc(void)
+{
+    u32 buf_size;
+    u32 seg_tx_p, seg_rx_p, arena_p;
+
+    buf_size = ALIGN_4BYTE(sizeof(struct seg_tx) * CONFIG_BT_MESH_TX_SEG_MSG_COUNT);
+    BT_DBG("seg_tx size=0x%x", buf_size);
+    seg_rx_p = buf_size;
+    buf_size += ALIGN_4BYTE(sizeof(struct seg_rx) * CONFIG_BT_MESH_RX_SEG_MSG_COUNT);
+    BT_DBG("seg_rx size=0x%x", ALIGN_4BYTE(sizeof(struct seg_rx) * CONFIG_BT_MESH_RX_SEG_MSG_COUNT));
+    arena_p = buf_size;
+    buf_size += ALIGN_4BYTE(CONFIG_BT_MESH_RX_SEG_ARENA_SIZE);
+    BT_DBG("seg_rx_arena size=0x%x", ALIGN_4BYTE(CONFIG_BT_MESH_RX_SEG_ARENA_SIZE));
+
+    seg_tx_p = (u32)malloc(buf_size);
+    ASSERT(seg_tx_p);
+    memset((u8 *)seg_tx_p, 0, buf_size);
+
+    seg_rx_p += seg_tx_p;
+    arena_p += seg_tx_p;
+
+    seg_tx = (struct seg_tx *)seg_tx_p;
+    seg_rx = (struct seg_rx *)seg_rx_p;
+    seg_rx_arena = (u8_t *)arena_p;
+
+    BT_DBG("total buf_size=0x%x", buf_size);
+}
+
+#endif /* NET_BUF_USE_MALLOC */
+
 void bt_mesh_trans_init(void)
 {
     int i;
 
-    for (i = 0; i < ARRAY_SIZE(seg_tx); i++) {
+#if NET_BUF_USE_MALLOC
+    bt_mesh_trans_buf_alloc();
+#endif /* NET_BUF_USE_MALLOC */
+
+    for (i = 0; i < CONFIG_BT_MESH_TX_SEG_MSG_COUNT; i++) {
         k_delayed_work_init(&seg_tx[i].retransmit, seg_retransmit);
     }
 
-    for (i = 0; i < ARRAY_SIZE(seg_rx); i++) {
+    for (i = 0; i < CONFIG_BT_MESH_RX_SEG_MSG_COUNT; i++) {
         k_delayed_work_init(&seg_rx[i].ack, seg_ack);
-        seg_rx[i].buf.__buf = (seg_rx_buf_data +
-                               (i * CONFIG_BT_MESH_RX_SDU_MAX));
-        seg_rx[i].buf.data = seg_rx[i].buf.__buf;
     }
 }
 
@@ -1511,4 +2015,5 @@ void bt_mesh_rpl_clear(void)
 {
     BT_DBG("");
     (void)memset(bt_mesh.rpl, 0, sizeof(bt_mesh.rpl));
+    bt_mesh_rpl_index_rebuild();
 }
@@ -79,6 +79,37 @@ struct bt_mesh_app_key *bt_mesh_app_key_find(u16_t app_idx);
 
 bool bt_mesh_tx_in_progress(void);
 
+/* Segment transmissions per acknowledged SDU is seg_acked / sdu_acked,
+ * the mean transfer time sdu_ms / sdu_acked and the goodput of a single
+ * transfer sdu_bytes * 1000 / sdu_ms bytes per second.
+ */
+struct bt_mesh_seg_tx_stats {
+    u32_t sdu_acked;    /* SDUs fully acknowledged */
+    u32_t sdu_failed;   /* SDUs timed out, canceled or failed to send */
+    u32_t seg_acked;    /* Segment transmissions spent on acked SDUs */
+    u32_t seg_failed;   /* Segment transmissions spent on failed SDUs */
+    u32_t partial_ack;  /* Partial acks answered with an immediate resend */
+    u32_t backoff;      /* Retransmit rounds deferred by a busy bearer */
+    u32_t rtt_samples;  /* Round trip times fed to the estimator */
+    u32_t sdu_bytes;    /* Upper transport bytes of acked SDUs */
+    u32_t sdu_ms;       /* First segment sent to last one acked */
+};
+
+void bt_mesh_seg_tx_stats_get(struct bt_mesh_seg_tx_stats *stats);
+void bt_mesh_seg_tx_stats_reset(void);
+
+/* Reassembly on the receiving side, timed from the first segment heard */
+struct bt_mesh_seg_rx_stats {
+    u32_t sdu_complete; /* SDUs reassembled */
+    u32_t sdu_bytes;    /* Upper transport bytes of reassembled SDUs */
+    u32_t sdu_ms;       /* First segment to last segment received */
+    u32_t incomplete;   /* SDUs dropped by the incomplete timer */
+    u32_t no_ctx;       /* New SDUs refused for lack of a context */
+};
+
+void bt_mesh_seg_rx_stats_get(struct bt_mesh_seg_rx_stats *stats);
+void bt_mesh_seg_rx_stats_reset(void);
+
 void bt_mesh_rx_reset(void);
 void bt_mesh_tx_reset(void);
 
@@ -94,3 +125,13 @@ int bt_mesh_trans_recv(struct net_buf_simple *buf, struct bt_mesh_net_rx *rx);
 void bt_mesh_trans_init(void);
 
 void bt_mesh_rpl_clear(void);
+
+struct bt_mesh_rpl *bt_mesh_rpl_find(u16_t src);
+struct bt_mesh_rpl *bt_mesh_rpl_alloc(u16_t src);
+void bt_mesh_rpl_index_rebuild(void);
+
+/* With CONFIG_BT_MESH_RPL_LRU_EVICT a full RPL evicts its least recently
+ * used entry for which this returns true. Weak, every source by default;
+ * override to protect the provisioner's critical nodes.
+ */
+bool bt_mesh_rpl_evictable(u16_t src);
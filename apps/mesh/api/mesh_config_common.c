@@ -51,6 +51,17 @@ const u8 config_bt_mesh_friend_queue_size = 2;
 _WEAK_
 const u8 config_bt_mesh_adv_buf_count = 5;
 
+/**
+ * @brief Config segmented message contexts
+ */
+/*-----------------------------------------------------------*/
+_WEAK_
+const u8 config_bt_mesh_tx_seg_msg_count = 1;
+_WEAK_
+const u8 config_bt_mesh_rx_seg_msg_count = 2;
+_WEAK_
+const u16 config_bt_mesh_rx_seg_arena_size = 2 * 72; // unit: byte
+
 /**
  * @brief Config PB-ADV param
  */
@@ -37,6 +37,7 @@
 extern const u8 *bt_get_mac_addr();
 extern void lib_make_ble_address(u8 *ble_address, u8 *edr_address);
 extern void ble_module_enable(u8 en);
+extern void bt_mesh_settings_flush(void);
 extern void bt_pll_para(u32 osc, u32 sys, u8 low_power, u8 xosc);
 extern void input_key_handler(u8 key_status, u8 key_number);
 extern void bt_ble_init(void);
@@ -62,6 +63,9 @@ static void app_set_soft_poweroff(void)
     log_info("set_soft_poweroff\n");
     is_app_active = 1;
 
+    //写入尚未落盘的mesh配置(RPL/SEQ等)
+    bt_mesh_settings_flush();
+
     //必须先主动断开蓝牙链路,否则要等链路超时断开
     ble_module_enable(0);
 